@@ -1,6 +1,9 @@
 ﻿#ifndef CONFIGURATION_H
 #define CONFIGURATION_H
+#include <cstdint>
+
 #include "Logging/Exception.h"
+#include "Logging/Trace.h"
 
 /**
  * Configuration for Drautos.
@@ -19,7 +22,9 @@ public:
     };
 
 private:
+#ifdef _WIN32
     inline static HANDLE hMappedFile = nullptr;
+#endif
     inline static Configuration* pInstance = nullptr;
 
 public:
@@ -27,10 +32,17 @@ public:
 
     Configuration& operator=(const Configuration&) = delete;
 
+    /**
+     * Gets the configuration that was written by the launcher.
+     * @remarks Outside of Windows, this is a default configuration that tools
+     * may modify.
+     */
     static Configuration& GetInstance()
     {
         if (!pInstance)
         {
+            const TraceScope scope("Configuration::GetInstance");
+#ifdef _WIN32
             // Open shared memory that was written by C#
             hMappedFile =
                 OpenFileMapping(FILE_MAP_READ, false, "DrautosConfiguration");
@@ -51,6 +63,12 @@ public:
             }
 
             Exception::SetIsUsingConsole(pInstance->EnableConsole);
+#else
+            // The launcher only exists on Windows, so tools configure a local
+            // instance instead
+            static Configuration instance{};
+            pInstance = &instance;
+#endif
         }
 
         return *pInstance;
@@ -83,8 +101,11 @@ public:
     bool IncreaseSnapshotLimit;
 
 private:
+    Configuration() = default;
+
     ~Configuration()
     {
+#ifdef _WIN32
         if (pInstance)
         {
             UnmapViewOfFile(pInstance);
@@ -96,6 +117,7 @@ private:
             CloseHandle(hMappedFile);
             hMappedFile = nullptr;
         }
+#endif
     }
 };
 
@@ -2,6 +2,7 @@
 #define DRAUTOS_H
 
 #include "Hooking/FunctionHookManager.h"
+#include "Hooking/Hooks/ExitProcessHook.h"
 #include "Hooking/Hooks/Patch1Hook.h"
 #include "Hooking/Hooks/Patch1InitialHook.h"
 #include "Hooking/Hooks/SnapshotLimitHook.h"
@@ -9,30 +10,106 @@
 #include "Hooking/Hooks/UnlockDlcHook.h"
 #include "Hooking/Hooks/UnmaskCompressedHook.h"
 #include "Host.h"
+#include "IO/AssetAccessTrace.h"
+#include "Logging/Trace.h"
 #include "Patching/PatchManager.h"
-#include "Patching/Patches/AnselPatch.h"
-#include "Patching/Patches/TwitchPrimePatch.h"
+#include "Patching/PatchRegistry.h"
+#include "Threading/InitializationGate.h"
 
+/**
+ * Entry point of the mod loader.
+ * @remarks Run is called from DllMain while the loader lock is held, so it only
+ * does the work that must be finished before the game starts running. The
+ * signature scans, patches and remaining hooks are applied on a background
+ * thread. Patch1InitialHook is attached straight away and waits for that
+ * thread before the game initializes its application, which is the earliest
+ * point that any patched code runs.
+ */
 class Drautos
 {
 public:
     static void Run()
     {
+        const TraceScope scope("Drautos::Run");
+        auto& gate = InitializationGate::GetInstance();
+        gate.Begin();
+
         Host::Initialize();
-        ApplyPatches();
-        ApplyHooks();
+        gate.SetIsReporting(Configuration::GetInstance().EnableConsole);
+
+        if constexpr (AssetAccessTrace::IS_ENABLED)
+        {
+            static AssetAccessTrace accessTrace;
+            AssetAccessTrace::SetActive(&accessTrace);
+        }
+
+        RegisterHooks();
+        auto& hookManager = Hooks::FunctionHookManager::GetInstance();
+        hookManager.ApplyHooks(Hooks::IFunctionHook::EARLY);
+
+        gate.Start([] {
+            try
+            {
+                ApplyPatches();
+                Hooks::FunctionHookManager::GetInstance().ApplyHooks(
+                    Hooks::IFunctionHook::DEFERRED);
+
+                if constexpr (Hooks::HookStatistics::IS_ENABLED)
+                {
+                    Hooks::HookStatistics::Calibrate();
+                }
+
+                if constexpr (Trace::IS_ENABLED)
+                {
+                    Trace::GetInstance().WriteJson(Trace::GetDefaultPath());
+                }
+
+                if constexpr (AssetAccessTrace::IS_ENABLED)
+                {
+                    AssetAccessTrace::SaveActiveLater(
+                        AssetAccessTrace::GetDefaultPath());
+                }
+            }
+            catch (...)
+            {
+                Exception::Fatal();
+            }
+        });
+    }
+
+    /**
+     * Prints the hook statistics to the console when the mod is unloaded, if
+     * they are enabled in this build, and tells the thread that saves the
+     * access trace to save it now.
+     * @remarks This runs under the loader lock, so it does not wait for the
+     * trace to be saved. When the game exits normally, ExitProcessHook has
+     * already saved it.
+     */
+    static void Shutdown()
+    {
+        if constexpr (AssetAccessTrace::IS_ENABLED)
+        {
+            AssetAccessTrace::Finish(std::chrono::milliseconds::zero());
+        }
+
+        if constexpr (Hooks::HookStatistics::IS_ENABLED)
+        {
+            if (Configuration::GetInstance().EnableConsole)
+            {
+                Hooks::HookStatistics::GetInstance().Print(stdout);
+            }
+        }
     }
 
 private:
     static void ApplyPatches()
     {
         auto& patchManager = Patches::PatchManager::GetInstance();
-        patchManager.Register<Patches::AnselPatch>();
-        patchManager.Register<Patches::TwitchPrimePatch>();
+        Patches::PatchRegistry::RegisterAll(patchManager);
         patchManager.ApplyPatches();
     }
 
-    static void ApplyHooks()
+    static void RegisterHooks()
     {
         auto& hookManager = Hooks::FunctionHookManager::GetInstance();
         hookManager.Register<Hooks::UnmaskCompressedHook>();
@@ -41,7 +118,7 @@ private:
         hookManager.Register<Hooks::SnapshotLimitHook>();
         hookManager.Register<Hooks::UnlockDlcHook>();
         hookManager.Register<Hooks::SteamRestartHook>();
-        hookManager.ApplyHooks();
+        hookManager.Register<Hooks::ExitProcessHook>();
     }
 };
 
@@ -1,5 +1,6 @@
 ﻿#ifndef EXTERNFUNCTIONHOOK_H
 #define EXTERNFUNCTIONHOOK_H
+#include "HookStatistics.h"
 #include "IFunctionHook.h"
 
 #include <cstdint>
@@ -22,6 +23,7 @@ class ExternFunctionHook : public IFunctionHook
 {
 private:
     inline static ExternFunctionHook* instance_;
+    inline static size_t statisticsIndex_;
 
     /**
      * Static wrapper for @code Detour @endcode as the non-static function
@@ -31,6 +33,7 @@ private:
      */
     static TReturn DetourFunction(TParams... params)
     {
+        const HookTimer timer(statisticsIndex_);
         return instance_->Detour(params...);
     }
 
@@ -43,6 +46,20 @@ protected:
      */
     Original_t original_;
 
+    /**
+     * Records hook-specific events in the statistics of this hook, such as how
+     * many entries the detour modified.
+     * @param count The number of events.
+     * @remarks Does nothing unless hook statistics are enabled.
+     */
+    static void RecordEvents(const uint64_t count)
+    {
+        if constexpr (HookStatistics::IS_ENABLED)
+        {
+            HookStatistics::GetInstance().RecordEvents(statisticsIndex_, count);
+        }
+    }
+
     /**
      * Logic to execute when detouring the target function.
      * @param params The parameters that are passed to the target function.
@@ -65,6 +82,11 @@ public:
 
         instance_ = this;
 
+        if constexpr (HookStatistics::IS_ENABLED)
+        {
+            statisticsIndex_ = HookStatistics::GetInstance().Register(this);
+        }
+
         const auto module = GetModuleHandleA(TargetModule);
         const auto function = GetProcAddress(module, TargetFunction);
         const auto address = reinterpret_cast<uint64_t>(function);
@@ -84,7 +106,7 @@ public:
      */
     void* GetDetourFunctionPointer() override
     {
-        return DetourFunction;
+        return reinterpret_cast<void*>(DetourFunction);
     }
 };
 } // namespace Hooks
@@ -4,6 +4,7 @@
 #include <cstdint>
 #include <exception>
 
+#include "HookStatistics.h"
 #include "IFunctionHook.h"
 
 #include "../Host.h"
@@ -19,7 +20,9 @@ namespace Hooks
  * @tparam TReturn Type of the return value of the target function.
  * @tparam TParams Types of the parameters of the target function.
  * @remarks Each implementation of this class can only be instantiated once due
- *          to the static nature of hooks.
+ *          to the static nature of hooks. Implementations that override
+ *          GetTargetSignature only use the RVAs if the signature matches
+ *          there, and may pass 0 for builds that they have no RVA for.
  */
 template <uint64_t TargetRvaDebug, uint64_t TargetRvaRelease, typename TReturn,
           typename... TParams>
@@ -27,6 +30,7 @@ class FunctionHook : public IFunctionHook
 {
 private:
     inline static FunctionHook* instance_;
+    inline static size_t statisticsIndex_;
 
     /**
      * Static wrapper for @code Detour @endcode as the non-static function
@@ -36,6 +40,7 @@ private:
      */
     static TReturn DetourFunction(TParams... params)
     {
+        const HookTimer timer(statisticsIndex_);
         return instance_->Detour(params...);
     }
 
@@ -48,6 +53,20 @@ protected:
      */
     Original_t original_;
 
+    /**
+     * Records hook-specific events in the statistics of this hook, such as how
+     * many entries the detour modified.
+     * @param count The number of events.
+     * @remarks Does nothing unless hook statistics are enabled.
+     */
+    static void RecordEvents(const uint64_t count)
+    {
+        if constexpr (HookStatistics::IS_ENABLED)
+        {
+            HookStatistics::GetInstance().RecordEvents(statisticsIndex_, count);
+        }
+    }
+
     /**
      * Logic to execute when detouring the target function.
      * @param params The parameters that are passed to the target function.
@@ -69,6 +88,11 @@ public:
         }
 
         instance_ = this;
+
+        if constexpr (HookStatistics::IS_ENABLED)
+        {
+            statisticsIndex_ = HookStatistics::GetInstance().Register(this);
+        }
         original_ = reinterpret_cast<Original_t>(
             REBASE(TargetRvaDebug, TargetRvaRelease));
     }
@@ -90,7 +114,7 @@ public:
      */
     void* GetDetourFunctionPointer() override
     {
-        return DetourFunction;
+        return reinterpret_cast<void*>(DetourFunction);
     }
 };
 } // namespace Hooks
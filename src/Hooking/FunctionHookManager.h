@@ -1,12 +1,22 @@
 ﻿#ifndef HOOKMANAGER_H
 #define HOOKMANAGER_H
 
+#include <algorithm>
+#include <array>
+#include <cstring>
 #include <detours/detours.h>
+#include <map>
 #include <processthreadsapi.h>
+#include <string>
+#include <typeinfo>
 #include <vector>
 
+#include "HookSignatureCache.h"
 #include "IFunctionHook.h"
 
+#include "../Logging/Trace.h"
+#include "../Patching/SignatureResolver.h"
+
 namespace Hooks
 {
 /**
@@ -15,7 +25,28 @@ namespace Hooks
 class FunctionHookManager
 {
 private:
+    static constexpr size_t DETOUR_SIZE = 32;
+
+    /**
+     * Represents the first bytes of a hook target on a known build, before it
+     * was detoured.
+     */
+    struct LearnedTarget
+    {
+        uint32_t Rva;
+        std::array<uint8_t, HookSignatureCache::SIGNATURE_SIZE> Bytes;
+    };
+
     std::vector<IFunctionHook*> hooks_;
+    std::vector<IFunctionHook*> applicable_;
+
+    /**
+     * Early hooks whose signature did not match at their RVA, which are
+     * resolved and attached with the deferred hooks instead.
+     */
+    std::vector<IFunctionHook*> lateHooks_;
+    std::map<std::string, LearnedTarget> learned_;
+    bool isDecided_{false};
 
     FunctionHookManager() = default;
 
@@ -48,23 +79,296 @@ public:
     }
 
     /**
-     * Applies all registered function hooks to the game.
+     * Applies the registered function hooks of a startup stage to the game.
+     * @param stage The stage of the hooks to apply.
+     * @remarks The early stage is applied from DllMain, so its targets are
+     * only checked in memory. Reading the cache files and scanning the code
+     * sections are left to the deferred stage, which runs on the
+     * initialization thread.
      */
-    void ApplyHooks() const
+    void ApplyHooks(const IFunctionHook::Stage stage)
     {
+        const TraceScope scope("FunctionHookManager::ApplyHooks",
+                               stage == IFunctionHook::EARLY ? "early"
+                                                             : "deferred");
+        if (!isDecided_)
+        {
+            DecideHooks();
+        }
+
+        const auto attaching = stage == IFunctionHook::EARLY
+                                   ? ResolveEarlyTargets()
+                                   : ResolveDeferredTargets();
+
         DetourTransactionBegin();
         DetourUpdateThread(GetCurrentThread());
 
+        for (const auto hook : attaching)
+        {
+            ExcludeFromFingerprint(*hook->GetTargetFunctionPointerReference());
+            hook->OnAttaching();
+            DetourAttach(hook->GetTargetFunctionPointerReference(),
+                         hook->GetDetourFunctionPointer());
+        }
+
+        {
+            const TraceScope commitScope("DetourTransactionCommit");
+            DetourTransactionCommit();
+        }
+
+        if (stage == IFunctionHook::DEFERRED)
+        {
+            SaveLearnedSignatures();
+        }
+    }
+
+private:
+    static bool ShouldApply(IFunctionHook& hook)
+    {
+        const TraceScope scope("IFunctionHook::ShouldApply",
+                               typeid(hook).name());
+        return hook.ShouldApply();
+    }
+
+    /**
+     * Stops a target function that is about to be detoured from affecting the
+     * fingerprint used to cache signature locations, since the jump written
+     * by Detours depends on where Drautos was loaded.
+     * @param target The target function.
+     * @remarks Detours overwrites the instructions that fit in the first
+     * DETOUR_SIZE bytes of the target. Targets outside the host module, such
+     * as in other DLLs, are ignored.
+     */
+    static void ExcludeFromFingerprint(void* target)
+    {
+        const auto address = static_cast<uint8_t*>(target);
+        const auto moduleStart = reinterpret_cast<uint8_t*>(Host::hModule);
+        if (address >= moduleStart &&
+            address < moduleStart + Host::ModuleSize)
+        {
+            SignatureResolver::ExcludeFromFingerprint(address, DETOUR_SIZE);
+        }
+    }
+
+    /**
+     * Saves the signatures learned from the hook targets of a known build of
+     * the game, so that they can be found on builds that the hooks have no RVA
+     * for.
+     * @remarks This reads and writes a file, so it is only called from the
+     * deferred stage. It does nothing if the build is unknown.
+     */
+    void SaveLearnedSignatures()
+    {
+        if (learned_.empty())
+        {
+            return;
+        }
+
+        const TraceScope scope("FunctionHookManager::SaveLearnedSignatures");
+        const auto relocations =
+            PeImage(reinterpret_cast<uint8_t*>(Host::hModule),
+                    Host::ModuleSize, PeImage::MAPPED)
+                .GetRelocations();
+        HookSignatureCache cache(HookSignatureCache::GetDefaultPath());
+        cache.Load();
+        for (const auto& [name, target] : learned_)
+        {
+            cache.Store(name, HookSignatureCache::Learn(target.Bytes.data(),
+                                                        target.Rva,
+                                                        relocations));
+        }
+
+        cache.Save();
+        learned_.clear();
+    }
+
+    /**
+     * Decides which of the registered hooks apply, so that each hook is only
+     * asked once.
+     */
+    void DecideHooks()
+    {
+        isDecided_ = true;
         for (const auto hook : hooks_)
         {
-            if (hook->ShouldApply())
+            if (ShouldApply(*hook))
+            {
+                applicable_.push_back(hook);
+            }
+        }
+    }
+
+    /**
+     * Locates the target functions of the early hooks without reading files
+     * or scanning, since this runs under the loader lock.
+     * @return The hooks to attach in the early stage.
+     * @remarks A hook with a signature is only attached early if it matches at
+     * the RVA. Otherwise the hook is resolved and attached with the deferred
+     * hooks, missing the calls that the game makes until then rather than
+     * detouring the wrong function. Hooks without a signature trust their RVA,
+     * since learned signatures are kept on disk.
+     */
+    std::vector<IFunctionHook*> ResolveEarlyTargets()
+    {
+        const TraceScope scope("FunctionHookManager::ResolveEarlyTargets");
+        const auto regions =
+            MemorySignature::GetModuleRegions(PeSectionFilter{PeImage::CODE});
+        std::vector<IFunctionHook*> attaching;
+        for (const auto hook : applicable_)
+        {
+            if (hook->GetStage() != IFunctionHook::EARLY)
+            {
+                continue;
+            }
+
+            const auto signature = hook->GetTargetSignature();
+            if (signature.GetSize() == 0)
+            {
+                CaptureTarget(*hook, regions);
+            }
+            else if (!SignatureResolver::IsMatch(
+                         signature.CreateScanner(),
+                         static_cast<uint8_t*>(
+                             *hook->GetTargetFunctionPointerReference()),
+                         regions))
+            {
+                lateHooks_.push_back(hook);
+                continue;
+            }
+
+            attaching.push_back(hook);
+        }
+
+        return attaching;
+    }
+
+    /**
+     * Locates the target functions of the deferred hooks, and of the early
+     * hooks that did not match at their RVA.
+     * @return The hooks to attach in the deferred stage.
+     * @remarks A hook with a signature only trusts its RVA if the signature
+     * matches there. A hook without one trusts its RVA on the builds that the
+     * RVAs were written for, and the first bytes of its target are kept so
+     * that SaveLearnedSignatures can remember them. On unknown builds, a hook
+     * without a signature uses the one learned on a known build instead, if
+     * there is one. The targets that fail the check are all found in a single
+     * scan of the code sections, which is cached on disk so that later
+     * launches only need to verify them.
+     */
+    std::vector<IFunctionHook*> ResolveDeferredTargets()
+    {
+        const TraceScope scope("FunctionHookManager::ResolveDeferredTargets");
+        const PeSectionFilter filter{PeImage::CODE};
+        const auto regions = MemorySignature::GetModuleRegions(filter);
+        const auto isKnownBuild = Host::Type != Configuration::UNKNOWN;
+        HookSignatureCache learnedCache(HookSignatureCache::GetDefaultPath());
+        if (!isKnownBuild)
+        {
+            learnedCache.Load();
+        }
+
+        std::vector<IFunctionHook*> attaching = lateHooks_;
+        std::vector<IFunctionHook*> unresolved = lateHooks_;
+        std::vector<MemorySignature> signatures;
+        for (const auto hook : lateHooks_)
+        {
+            signatures.emplace_back(hook->GetTargetSignature());
+        }
+
+        lateHooks_.clear();
+        for (const auto hook : applicable_)
+        {
+            if (hook->GetStage() != IFunctionHook::DEFERRED)
+            {
+                continue;
+            }
+
+            attaching.push_back(hook);
+            auto signature = hook->GetTargetSignature();
+            if (signature.GetSize() == 0)
+            {
+                CaptureTarget(*hook, regions);
+                const auto learned =
+                    isKnownBuild ? nullptr
+                                 : learnedCache.Find(typeid(*hook).name());
+                if (!learned)
+                {
+                    continue;
+                }
+
+                signature = *learned;
+            }
+
+            if (!SignatureResolver::IsMatch(
+                    signature.CreateScanner(),
+                    static_cast<uint8_t*>(
+                        *hook->GetTargetFunctionPointerReference()),
+                    regions))
+            {
+                unresolved.push_back(hook);
+                signatures.emplace_back(signature);
+            }
+        }
+
+        if (unresolved.empty())
+        {
+            return attaching;
+        }
+
+        const std::vector filters(signatures.size(), filter);
+        const auto results = SignatureResolver::Resolve(signatures, filters);
+        for (size_t i = 0; i < unresolved.size(); i++)
+        {
+            if (results[i].size() != 1)
             {
-                DetourAttach(hook->GetTargetFunctionPointerReference(),
-                             hook->GetDetourFunctionPointer());
+                Exception::Fatal("Failed to resolve hook target: " +
+                                 std::string(typeid(*unresolved[i]).name()) +
+                                 " (" + std::to_string(results[i].size()) +
+                                 " matches)");
             }
+
+            *unresolved[i]->GetTargetFunctionPointerReference() =
+                results[i].front();
         }
 
-        DetourTransactionCommit();
+        return attaching;
+    }
+
+    /**
+     * Keeps the first bytes of the target of a hook without a signature, so
+     * that SaveLearnedSignatures can remember them.
+     * @param hook The hook, which must not be attached yet.
+     * @param regions The code regions of the host module.
+     * @remarks Nothing is kept on unknown builds, since the RVA of the hook
+     * may not point to its target there.
+     */
+    void CaptureTarget(IFunctionHook& hook,
+                       const std::vector<MemoryRegion>& regions)
+    {
+        const auto target =
+            static_cast<uint8_t*>(*hook.GetTargetFunctionPointerReference());
+        if (Host::Type == Configuration::UNKNOWN ||
+            !IsInRegions(target, HookSignatureCache::SIGNATURE_SIZE, regions))
+        {
+            return;
+        }
+
+        auto& capture = learned_[typeid(hook).name()];
+        capture.Rva = static_cast<uint32_t>(
+            target - reinterpret_cast<uint8_t*>(Host::hModule));
+        std::memcpy(capture.Bytes.data(), target, capture.Bytes.size());
+    }
+
+    /**
+     * Checks whether a range of memory lies within one of the given regions.
+     */
+    static bool IsInRegions(const uint8_t* address, const size_t size,
+                            const std::vector<MemoryRegion>& regions)
+    {
+        return std::any_of(regions.begin(), regions.end(), [&](const auto& r) {
+            return address >= r.Start &&
+                   r.End - address >= static_cast<ptrdiff_t>(size);
+        });
     }
 };
 } // namespace Hooks
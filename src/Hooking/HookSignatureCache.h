@@ -0,0 +1,191 @@
+#ifndef HOOKSIGNATURECACHE_H
+#define HOOKSIGNATURECACHE_H
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <filesystem>
+#include <map>
+#include <string>
+#include <vector>
+
+#include "../IO/CacheFile.h"
+#include "../Patching/Signature.h"
+
+/**
+ * Remembers the first bytes of each hook target on the builds of the game that
+ * the hook RVAs were written for, so that the targets can be found by
+ * signature on builds that they were not.
+ * @remarks Unlike the SignatureResolutionCache, the file is not tied to a
+ * single build, since its purpose is to outlive the build it was learned on.
+ * Bytes that the loader rebases are stored as wildcards. A learned signature
+ * only finds a target whose first bytes did not change in the new build, such
+ * as by a call to a function that moved, so hooks whose targets are likely to
+ * change should declare their own signature with wildcards instead. Failing to
+ * read or write the file is not an error, since hooks then fall back to their
+ * RVAs as they would without it.
+ */
+class HookSignatureCache
+{
+public:
+    /**
+     * The number of bytes learned from each target.
+     */
+    static constexpr size_t SIGNATURE_SIZE = 32;
+
+    using Signature = PackedSignature<SIGNATURE_SIZE>;
+
+private:
+    static constexpr uint32_t MAGIC = 0x53484444; // DDHS
+    static constexpr uint32_t VERSION = 1;
+
+    CacheFile file_;
+    std::map<std::string, Signature> entries_;
+    bool isDirty_{false};
+
+public:
+    /**
+     * Instantiates an empty cache.
+     * @param path Path to the cache file, or an empty path to disable
+     * persistence.
+     */
+    explicit HookSignatureCache(std::filesystem::path path)
+        : file_(std::move(path), MAGIC, VERSION)
+    {
+    }
+
+    /**
+     * Gets the default location of the cache file.
+     * @return %LOCALAPPDATA%/Flagrum/cache/DrautosHookSignatures.bin, or an
+     * empty path if the local application data folder is unknown.
+     */
+    static std::filesystem::path GetDefaultPath()
+    {
+        return CacheFile::GetDefaultPath("DrautosHookSignatures.bin");
+    }
+
+    /**
+     * Learns the signature of a hook target from its first bytes.
+     * @param target The first SIGNATURE_SIZE bytes of the target, copied
+     * before it was detoured.
+     * @param rva The RVA of the target.
+     * @param relocations The RVAs of the 8-byte addresses that the loader
+     * rebases, from PeImage::GetRelocations.
+     * @return The signature, with the rebased bytes as wildcards.
+     */
+    static Signature Learn(const uint8_t* target, const uint32_t rva,
+                           const std::vector<uint32_t>& relocations)
+    {
+        Signature signature;
+        std::memcpy(signature.Values.data(), target, SIGNATURE_SIZE);
+        signature.Masks.fill(0xFF);
+        for (const auto relocation : relocations)
+        {
+            if (relocation + 8 <= rva || relocation >= rva + SIGNATURE_SIZE)
+            {
+                continue;
+            }
+
+            const auto start = relocation > rva ? relocation - rva : 0;
+            const auto end = std::min<size_t>(relocation + 8 - rva,
+                                              SIGNATURE_SIZE);
+            for (auto i = start; i < end; i++)
+            {
+                signature.Values[i] = 0;
+                signature.Masks[i] = 0;
+            }
+        }
+
+        return signature;
+    }
+
+    /**
+     * Loads the learned signatures from the cache file.
+     * @return True if the file exists and is valid.
+     */
+    bool Load()
+    {
+        entries_.clear();
+        isDirty_ = false;
+
+        const auto readHeader = [](std::istream&) { return true; };
+        const auto readEntry = [this](std::istream& stream) {
+            std::string name;
+            Signature signature;
+            if (!CacheFile::ReadString(stream, name) ||
+                !CacheFile::Read(stream, signature.Values) ||
+                !CacheFile::Read(stream, signature.Masks))
+            {
+                return false;
+            }
+
+            entries_[std::move(name)] = signature;
+            return true;
+        };
+
+        if (!file_.Load(readHeader, readEntry))
+        {
+            entries_.clear();
+            return false;
+        }
+
+        return true;
+    }
+
+    /**
+     * Gets the learned signature of a hook target.
+     * @param hook The name of the hook type.
+     * @return The signature, or nullptr if none was learned.
+     */
+    [[nodiscard]] const Signature* Find(const std::string& hook) const
+    {
+        const auto entry = entries_.find(hook);
+        return entry == entries_.end() ? nullptr : &entry->second;
+    }
+
+    /**
+     * Stores the learned signature of a hook target.
+     * @param hook The name of the hook type.
+     * @param signature The signature, from Learn.
+     */
+    void Store(const std::string& hook, const Signature& signature)
+    {
+        const auto [entry, isInserted] = entries_.try_emplace(hook, signature);
+        if (isInserted || entry->second.Values != signature.Values ||
+            entry->second.Masks != signature.Masks)
+        {
+            entry->second = signature;
+            isDirty_ = true;
+        }
+    }
+
+    /**
+     * Writes the cache file if anything has changed since it was loaded.
+     * @return True if the file is up to date.
+     */
+    bool Save()
+    {
+        if (!isDirty_)
+        {
+            return true;
+        }
+
+        const auto writeHeader = [](std::ostream&) {};
+        const auto writeEntry = [](std::ostream& stream, const auto& entry) {
+            const auto& [name, signature] = entry;
+            CacheFile::WriteString(stream, name);
+            CacheFile::Write(stream, signature.Values);
+            CacheFile::Write(stream, signature.Masks);
+        };
+
+        if (!file_.Save(writeHeader, entries_, writeEntry))
+        {
+            return false;
+        }
+
+        isDirty_ = false;
+        return true;
+    }
+};
+
+#endif // HOOKSIGNATURECACHE_H
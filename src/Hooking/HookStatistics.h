@@ -0,0 +1,374 @@
+#ifndef HOOKSTATISTICS_H
+#define HOOKSTATISTICS_H
+
+#include <array>
+#include <atomic>
+#include <bit>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <typeinfo>
+#include <vector>
+
+#ifdef _MSC_VER
+#include <intrin.h>
+#else
+#include <x86intrin.h>
+#endif
+
+#include "IFunctionHook.h"
+
+#ifndef DRAUTOS_HOOK_STATISTICS
+#define DRAUTOS_HOOK_STATISTICS 0
+#endif
+
+namespace Hooks
+{
+/**
+ * Counts how often each hook runs and how long its detour takes.
+ * @remarks Statistics are enabled by building with the DRAUTOS_HOOK_STATISTICS
+ * CMake option, and otherwise compile to nothing. Each thread that runs a
+ * detour gets its own block of counters, padded so that no two hooks share a
+ * cache line, which only that thread writes to. Detours therefore never take a
+ * lock or contend on an atomic. Blocks are never freed, so counts from threads
+ * that have exited are kept, and detours that run during shutdown are safe.
+ */
+class HookStatistics
+{
+public:
+    /**
+     * Whether hooks record statistics in this build.
+     */
+    static constexpr bool IS_ENABLED = DRAUTOS_HOOK_STATISTICS != 0;
+
+    /**
+     * The maximum number of hooks that can record statistics.
+     */
+    static constexpr size_t MAX_HOOKS = 32;
+
+    /**
+     * The number of latency buckets. Bucket i counts calls that took fewer
+     * than 2^i cycles, and at least 2^(i-1), with the last bucket also
+     * counting every longer call.
+     */
+    static constexpr size_t BUCKETS = 40;
+
+    /**
+     * Represents the merged statistics of one hook.
+     */
+    struct Snapshot
+    {
+        std::string Name;
+        uint64_t Calls;
+        uint64_t Cycles;
+        uint64_t Events;
+        std::array<uint64_t, BUCKETS> Histogram;
+
+        /**
+         * Estimates a percentile of the latency of the hook.
+         * @param percentile The percentile, from 0 to 1.
+         * @return The upper bound of the bucket that contains the percentile,
+         * in cycles, or 0 if the hook has not been called.
+         */
+        [[nodiscard]] uint64_t GetPercentileCycles(
+            const double percentile) const
+        {
+            if (Calls == 0)
+            {
+                return 0;
+            }
+
+            const auto target = static_cast<uint64_t>(
+                percentile * static_cast<double>(Calls));
+            uint64_t count = 0;
+            for (size_t i = 0; i < BUCKETS; i++)
+            {
+                count += Histogram[i];
+                if (count > target)
+                {
+                    return 1ull << i;
+                }
+            }
+
+            return 1ull << (BUCKETS - 1);
+        }
+    };
+
+private:
+    /**
+     * Represents the counters of one hook on one thread.
+     */
+    struct alignas(64) Counters
+    {
+        std::atomic<uint64_t> Calls;
+        std::atomic<uint64_t> Cycles;
+        std::atomic<uint64_t> Events;
+        std::array<std::atomic<uint64_t>, BUCKETS> Histogram;
+    };
+
+    /**
+     * Represents the counters of every hook on one thread.
+     */
+    struct ThreadBlock
+    {
+        std::array<Counters, MAX_HOOKS> Hooks{};
+    };
+
+    std::mutex mutex_;
+    std::vector<ThreadBlock*> blocks_;
+    std::array<const IFunctionHook*, MAX_HOOKS> hooks_{};
+    std::atomic<size_t> count_{0};
+    inline static thread_local ThreadBlock* block_;
+
+    HookStatistics() = default;
+
+public:
+    /**
+     * Gets the shared instance.
+     * @remarks The instance is never destroyed, as detours may still run on
+     * other threads while the process exits.
+     */
+    static HookStatistics& GetInstance()
+    {
+        static const auto instance = new HookStatistics();
+        return *instance;
+    }
+
+    HookStatistics(const HookStatistics&) = delete;
+
+    HookStatistics& operator=(const HookStatistics&) = delete;
+
+    /**
+     * Registers a hook to record statistics for.
+     * @param hook The hook, which is used to name its statistics.
+     * @return The index that the hook records its statistics under, or
+     * MAX_HOOKS if too many hooks have been registered.
+     */
+    size_t Register(const IFunctionHook* hook)
+    {
+        std::lock_guard lock(mutex_);
+        const auto index = count_.load(std::memory_order_relaxed);
+        if (index >= MAX_HOOKS)
+        {
+            return MAX_HOOKS;
+        }
+
+        hooks_[index] = hook;
+        count_.store(index + 1, std::memory_order_release);
+        return index;
+    }
+
+    /**
+     * Records a call of a hook.
+     * @param index The index of the hook from Register.
+     * @param cycles The number of cycles that the detour took.
+     */
+    void RecordCall(const size_t index, const uint64_t cycles)
+    {
+        if (index >= MAX_HOOKS)
+        {
+            return;
+        }
+
+        auto& counters = GetThreadBlock().Hooks[index];
+        Increment(counters.Calls, 1);
+        Increment(counters.Cycles, cycles);
+        Increment(counters.Histogram[std::min<size_t>(std::bit_width(cycles),
+                                                      BUCKETS - 1)],
+                  1);
+    }
+
+    /**
+     * Records hook-specific events, such as how many entries a detour
+     * modified.
+     * @param index The index of the hook from Register.
+     * @param count The number of events.
+     */
+    void RecordEvents(const size_t index, const uint64_t count)
+    {
+        if (index < MAX_HOOKS)
+        {
+            Increment(GetThreadBlock().Hooks[index].Events, count);
+        }
+    }
+
+    /**
+     * Merges the statistics of every thread.
+     * @return The statistics of each registered hook.
+     * @remarks Counters are read while detours may still be updating them, so
+     * the fields of a snapshot may be off by the calls that are in progress.
+     */
+    [[nodiscard]] std::vector<Snapshot> TakeSnapshot()
+    {
+        std::lock_guard lock(mutex_);
+        const auto count = count_.load(std::memory_order_acquire);
+        std::vector<Snapshot> snapshots(count);
+
+        for (size_t i = 0; i < count; i++)
+        {
+            auto& snapshot = snapshots[i];
+            snapshot.Name = typeid(*hooks_[i]).name();
+            for (const auto block : blocks_)
+            {
+                const auto& counters = block->Hooks[i];
+                snapshot.Calls +=
+                    counters.Calls.load(std::memory_order_relaxed);
+                snapshot.Cycles +=
+                    counters.Cycles.load(std::memory_order_relaxed);
+                snapshot.Events +=
+                    counters.Events.load(std::memory_order_relaxed);
+                for (size_t b = 0; b < BUCKETS; b++)
+                {
+                    snapshot.Histogram[b] +=
+                        counters.Histogram[b].load(std::memory_order_relaxed);
+                }
+            }
+        }
+
+        return snapshots;
+    }
+
+    /**
+     * Prints a snapshot of every hook.
+     * @param stream The stream to print to.
+     */
+    void Print(FILE* stream)
+    {
+        const auto cyclesPerNanosecond = GetCyclesPerNanosecond();
+        std::fprintf(stream, "%-48s %12s %10s %10s %10s %12s\n", "Hook",
+                     "calls", "mean ns", "p50 ns", "p99 ns", "events");
+
+        for (const auto& snapshot : TakeSnapshot())
+        {
+            const auto mean =
+                snapshot.Calls > 0
+                    ? static_cast<double>(snapshot.Cycles) /
+                          static_cast<double>(snapshot.Calls)
+                    : 0.0;
+            std::fprintf(
+                stream, "%-48s %12llu %10.1f %10.1f %10.1f %12llu\n",
+                snapshot.Name.c_str(),
+                static_cast<unsigned long long>(snapshot.Calls),
+                mean / cyclesPerNanosecond,
+                snapshot.GetPercentileCycles(0.5) / cyclesPerNanosecond,
+                snapshot.GetPercentileCycles(0.99) / cyclesPerNanosecond,
+                static_cast<unsigned long long>(snapshot.Events));
+        }
+    }
+
+    /**
+     * Reads the time stamp counter.
+     */
+    static uint64_t ReadCycles()
+    {
+        return __rdtsc();
+    }
+
+    /**
+     * Measures how fast the time stamp counter runs, so that printing the
+     * statistics later does not have to.
+     * @remarks This takes about 10 ms, so it should be called from the
+     * background initialization thread. Print may run from DllMain while the
+     * process is detaching, where it must not sleep.
+     */
+    static void Calibrate()
+    {
+        GetCyclesPerNanosecond();
+    }
+
+    /**
+     * Measures how fast the time stamp counter runs.
+     * @return The number of cycles per nanosecond.
+     * @remarks The first call takes about 10 ms, unless Calibrate was called.
+     */
+    static double GetCyclesPerNanosecond()
+    {
+        static const auto rate = [] {
+            const auto start = std::chrono::steady_clock::now();
+            const auto startCycles = ReadCycles();
+            std::this_thread::sleep_for(std::chrono::milliseconds(10));
+            const std::chrono::duration<double, std::nano> elapsed =
+                std::chrono::steady_clock::now() - start;
+            return static_cast<double>(ReadCycles() - startCycles) /
+                   elapsed.count();
+        }();
+        return rate;
+    }
+
+private:
+    /**
+     * Adds to a counter that only the calling thread writes to, which does not
+     * need a locked instruction.
+     */
+    static void Increment(std::atomic<uint64_t>& counter, const uint64_t value)
+    {
+        counter.store(counter.load(std::memory_order_relaxed) + value,
+                      std::memory_order_relaxed);
+    }
+
+    ThreadBlock& GetThreadBlock()
+    {
+        if (!block_)
+        {
+            std::lock_guard lock(mutex_);
+            block_ = new ThreadBlock();
+            blocks_.push_back(block_);
+        }
+
+        return *block_;
+    }
+};
+
+/**
+ * Records the time from its construction to its destruction as a call of a
+ * hook.
+ * @tparam IsEnabled Whether the timer records anything, which defaults to
+ * whether hook statistics are enabled in this build.
+ */
+template <bool IsEnabled = HookStatistics::IS_ENABLED> class HookTimer
+{
+private:
+    size_t index_;
+    uint64_t start_;
+
+public:
+    /**
+     * Starts timing a call.
+     * @param index The index of the hook from HookStatistics::Register.
+     */
+    explicit HookTimer(const size_t index)
+        : index_(index), start_(HookStatistics::ReadCycles())
+    {
+    }
+
+    ~HookTimer()
+    {
+        HookStatistics::GetInstance().RecordCall(
+            index_, HookStatistics::ReadCycles() - start_);
+    }
+
+    HookTimer(const HookTimer&) = delete;
+
+    HookTimer& operator=(const HookTimer&) = delete;
+};
+
+/**
+ * A timer that records nothing, for builds without hook statistics.
+ */
+template <> class HookTimer<false>
+{
+public:
+    explicit HookTimer(size_t)
+    {
+    }
+
+    HookTimer(const HookTimer&) = delete;
+
+    HookTimer& operator=(const HookTimer&) = delete;
+};
+} // namespace Hooks
+
+#endif // HOOKSTATISTICS_H
@@ -0,0 +1,55 @@
+#ifndef EXITPROCESSHOOK_H
+#define EXITPROCESSHOOK_H
+
+#include <chrono>
+#include <cstdint>
+
+#include "../StaticExternFunctionHook.h"
+
+#include "../../IO/AssetAccessTrace.h"
+
+namespace Hooks
+{
+constexpr char EXIT_PROCESS_HOOK_MODULE[] = "kernel32.dll";
+constexpr char EXIT_PROCESS_HOOK_FUNCTION[] = "ExitProcess";
+
+/**
+ * Saves the asset access trace when the game exits before it has recorded for
+ * AssetAccessTrace::RECORDING_DURATION.
+ * @remarks ExitProcess is the last point at which the thread that saves the
+ *          trace is still running, as Windows stops it before DllMain is told
+ *          that the process is exiting. The hook is only applied in builds
+ *          that record access traces.
+ */
+class ExitProcessHook final
+    : public StaticExternFunctionHook<ExitProcessHook, EXIT_PROCESS_HOOK_MODULE,
+                                      EXIT_PROCESS_HOOK_FUNCTION, void,
+                                      uint32_t>
+{
+    friend StaticExternFunctionHook;
+
+    /**
+     * The longest time that exiting waits for the trace to be saved.
+     */
+    static constexpr std::chrono::milliseconds SAVE_TIMEOUT{5000};
+
+public:
+    bool ShouldApply() override
+    {
+        return AssetAccessTrace::IS_ENABLED;
+    }
+
+protected:
+    /**
+     * Saves the access trace, then exits the process.
+     * @param exitCode The exit code of the process.
+     */
+    static void Detour(const uint32_t exitCode)
+    {
+        AssetAccessTrace::Finish(SAVE_TIMEOUT);
+        original_(exitCode);
+    }
+};
+} // namespace Hooks
+
+#endif // EXITPROCESSHOOK_H
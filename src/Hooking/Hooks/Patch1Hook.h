@@ -1,12 +1,9 @@
 ﻿#ifndef PATCH1HOOK_H
 #define PATCH1HOOK_H
 
-#include <mutex>
-
-#include "../FunctionHook.h"
+#include "../OneShotFunctionHook.h"
 
 #include "../../Logging/Exception.h"
-#include "../../Replica/SQEX/Luminous/AssetManager.h"
 #include "../../Replica/SQEX/Luminous/AssetManager/LmAssetID.h"
 #include "../../Replica/SQEX/Luminous/AssetManager/LmFileList.h"
 
@@ -24,52 +21,39 @@ namespace Hooks
  * @remarks This is one of two hooks that adds a patch archive to the asset
  * manager. This one is hooked later in the game's initialization process, as
  * calling it earlier was causing visual anomalies once the game was loaded,
- * which seemed possibly related to shader passes.
+ * which seemed possibly related to shader passes. The target is called
+ * throughout the game, so the hook removes itself once it has run.
  */
-class Patch1Hook final : public FunctionHook<0x3a3e70, 0x36cb50, void*>
+class Patch1Hook final
+    : public OneShotFunctionHook<Patch1Hook, 0x3a3e70, 0x36cb50, void*>
 {
-private:
-    using AcquireAsset_t = void*(__fastcall*)(void* pAssetManager, LmAssetID*,
-                                              uint64_t, int64_t);
+    friend OneShotFunctionHook;
 
-    std::once_flag hasApplied_;
+private:
+    static constexpr auto PATCH_INDEX_URI =
+        "data://patch/patch1/patchindex.ebex@";
+    static constexpr auto PATCH_INDEX_HASH =
+        LmAssetID::ComputeNameHash(PATCH_INDEX_URI);
 
 protected:
     /**
-     * Gets the singleton instance of the font utilities class.
-     * @return The font utilities instance.
-     * @remarks This detour will add patch/patch1/patchindex.earc to the asset
-     * manager the first time it is called.
+     * Adds patch/patch1/patchindex.earc to the asset manager the first time
+     * the font utilities instance is requested.
      */
-    void* Detour() override
+    static void Action()
     {
-        std::call_once(hasApplied_, [] {
-
-            try
-            {
-                // Add patch1 to the asset manager
-                auto patchIndexId =
-                    LmAssetID::Create("data://patch/patch1/patchindex.ebex@");
-                SQEX::Luminous::AssetManager::LmFileList::AddPatchIndexEarc(
-                    &patchIndexId);
-
-                // This call is needed to finish this off, but it's not 100%
-                // clear what it does
-                const auto assetManager =
-                    SQEX::Luminous::AssetManager::LmGetAssetManager();
-                const auto assetManagerBaseAddress =
-                    *static_cast<uint64_t*>(assetManager);
-                const auto acquireAsset = *reinterpret_cast<AcquireAsset_t*>(
-                    assetManagerBaseAddress + 8);
-                acquireAsset(assetManager, &patchIndexId, 0, 2);
-            }
-            catch (...)
-            {
-                Exception::Fatal();
-            }
-        });
-
-        return original_();
+        try
+        {
+            // Add patch1 to the asset manager
+            auto patchIndexId =
+                LmAssetID::Create(PATCH_INDEX_URI, PATCH_INDEX_HASH);
+            SQEX::Luminous::AssetManager::LmFileList::AddPatchIndexEarcs(
+                {&patchIndexId, 1});
+        }
+        catch (...)
+        {
+            Exception::Fatal();
+        }
     }
 
 public:
@@ -1,13 +1,11 @@
 ﻿#ifndef PATCH1INITIALHOOK_H
 #define PATCH1INITIALHOOK_H
 
-#include <mutex>
+#include "../OneShotFunctionHook.h"
 
-#include "../FunctionHook.h"
-
-#include "../../Replica/SQEX/Luminous/AssetManager.h"
 #include "../../Replica/SQEX/Luminous/AssetManager/LmAssetID.h"
 #include "../../Replica/SQEX/Luminous/AssetManager/LmFileList.h"
+#include "../../Threading/InitializationGate.h"
 
 using LmAssetID = SQEX::Luminous::AssetManager::LmAssetID;
 
@@ -25,51 +23,40 @@ namespace Hooks
  * on.
  */
 class Patch1InitialHook final
-    : public FunctionHook<0x4FBA60, 0x4CE960, int64_t, void*>
+    : public OneShotFunctionHook<Patch1InitialHook, 0x4FBA60, 0x4CE960, int64_t,
+                                 void*>
 {
-private:
-    using AcquireAsset_t = void*(__fastcall*)(void* pAssetManager, LmAssetID*,
-                                              uint64_t, int64_t);
+    friend OneShotFunctionHook;
 
-    std::once_flag hasApplied_;
+private:
+    static constexpr auto PATCH_INDEX_URI =
+        "data://patch/patch1_initial/patchindex.ebex@";
+    static constexpr auto PATCH_INDEX_HASH =
+        LmAssetID::ComputeNameHash(PATCH_INDEX_URI);
 
 protected:
     /**
-     * Runs early initialization steps.
-     * @param pApplicationBase The game's main application class.
-     * @return The return value is unknown without further investigation.
-     * @remarks This detour will add patch/patch1_initial/patchindex.earc to the
-     * asset manager on first call.
+     * Adds patch/patch1_initial/patchindex.earc to the asset manager the first
+     * time the game runs its early initialization steps.
+     * @remarks This first waits for background initialization to finish, so
+     * that every patch and hook is in place before the game initializes.
      */
-    int64_t Detour(void* pApplicationBase) override
+    static void Action(void*)
     {
-        std::call_once(hasApplied_, [] {
-            try
-            {
-                // Add patch1_initial to the asset manager
-                auto patchIndexId = LmAssetID::Create(
-                    "data://patch/patch1_initial/patchindex.ebex@");
-                SQEX::Luminous::AssetManager::LmFileList::AddPatchIndexEarc(
-                    &patchIndexId);
+        InitializationGate::GetInstance().Wait();
 
-                // This call is needed to finish this off, but it's not 100%
-                // clear what it does
-                const auto assetManager =
-                    SQEX::Luminous::AssetManager::LmGetAssetManager();
-                const auto assetManagerBaseAddress =
-                    *static_cast<uint64_t*>(assetManager);
-                const auto acquireAsset = *reinterpret_cast<AcquireAsset_t*>(
-                    assetManagerBaseAddress + 8);
-                acquireAsset(assetManager, &patchIndexId, 0, 2);
-            }
-            catch (...)
-            {
-                Exception::Fatal(
-                    "Failed to add patch1_initial to asset manager");
-            }
-        });
-
-        return original_(pApplicationBase);
+        try
+        {
+            // Add patch1_initial to the asset manager
+            auto patchIndexId =
+                LmAssetID::Create(PATCH_INDEX_URI, PATCH_INDEX_HASH);
+            SQEX::Luminous::AssetManager::LmFileList::AddPatchIndexEarcs(
+                {&patchIndexId, 1});
+        }
+        catch (...)
+        {
+            Exception::Fatal("Failed to add patch1_initial to asset manager");
+        }
     }
 
 public:
@@ -77,6 +64,16 @@ public:
     {
         return true;
     }
+
+    /**
+     * @copydoc IFunctionHook::GetStage
+     * @remarks The detour is the initialization gate, so it must be attached
+     * before the game starts initializing.
+     */
+    Stage GetStage() override
+    {
+        return EARLY;
+    }
 };
 } // namespace Hooks
 
@@ -25,6 +25,15 @@ public:
         return true;
     }
 
+    /**
+     * @copydoc IFunctionHook::GetStage
+     * @remarks The Steam API is checked as soon as the game starts.
+     */
+    Stage GetStage() override
+    {
+        return EARLY;
+    }
+
 protected:
     /**
      * Determines whether the game should restart.
@@ -1,8 +1,13 @@
 ﻿#ifndef UNMASKCOMPRESSEDHOOK_H
 #define UNMASKCOMPRESSEDHOOK_H
-#include "../FunctionHook.h"
+#include "../StaticFunctionHook.h"
 
 #include "../../Host.h"
+#include "../../IO/AssetAccessTrace.h"
+#include "../../Replica/SQEX/Luminous/AssetManager/LmArcEntryFlags.h"
+#include "../../Replica/SQEX/Luminous/AssetManager/LmAssetID.h"
+
+using LmArcEntryFlags = SQEX::Luminous::AssetManager::LmArcEntryFlags;
 
 namespace Hooks
 {
@@ -18,14 +23,19 @@ namespace Hooks
  * @remarks The compressed flag is replaced with a different flag when Flagrum
  * builds mods. This is to prevent users from being able to rip mod assets from
  * other peoples' work by trying to extract them with other tools. This hook
- * undoes this masking so the game knows how to read them again.
+ * undoes this masking so the game knows how to read them again. This runs on
+ * every asset lookup, so it uses static dispatch. Each entry is only written
+ * the first time it is found, as it is no longer masked after that. It should
+ * be replaced by a pass with LmArcEntryFlags::UnmaskAll when the archive is
+ * mounted, once the function that mounts it is known. The lookup is recorded
+ * to the active AssetAccessTrace, if there is one. The number of entries that
+ * were unmasked is recorded as the events of its hook statistics.
  */
 class UnmaskCompressedHook final
-    : public FunctionHook<0xD0C7D0, 0xC1C520, void*, void*, void*>
+    : public StaticFunctionHook<UnmaskCompressedHook, 0xD0C7D0, 0xC1C520, void*,
+                                void*, void*>
 {
-private:
-    const int16_t COMPRESSED = 2;
-    const int16_t MASK_COMPRESSED = 256;
+    friend StaticFunctionHook;
 
 protected:
     bool ShouldApply() override
@@ -42,8 +52,15 @@ protected:
      * @remarks This detour removes the fake MASK_COMPRESSED flag from any
      * archive entries that have it, replacing it with the real COMPRESSED flag.
      */
-    void* Detour(void* pArchiveInterface, void* pAssetId) override
+    static void* Detour(void* pArchiveInterface, void* pAssetId)
     {
+        if (const auto accessTrace = AssetAccessTrace::GetActive())
+        {
+            using SQEX::Luminous::AssetManager::LmAssetID;
+            const auto pId = static_cast<const LmAssetID*>(pAssetId);
+            accessTrace->Record(LmAssetID::GetNameHash(pId));
+        }
+
         const auto asset = original_(pArchiveInterface, pAssetId);
 
         if (asset)
@@ -54,10 +71,10 @@ protected:
             const auto pFlags = reinterpret_cast<int16_t*>(
                 static_cast<char*>(assetEntry) + offset);
 
-            if ((*pFlags & MASK_COMPRESSED) != 0)
+            if ((*pFlags & LmArcEntryFlags::MASK_COMPRESSED) != 0)
             {
-                *pFlags &= ~MASK_COMPRESSED; // NOLINT(*-narrowing-conversions)
-                *pFlags |= COMPRESSED;       // NOLINT(*-narrowing-conversions)
+                *pFlags = LmArcEntryFlags::Unmask(*pFlags);
+                RecordEvents(1);
             }
         }
 
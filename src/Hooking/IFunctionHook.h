@@ -1,6 +1,10 @@
 ﻿#ifndef IFUNCTIONHOOK_H
 #define IFUNCTIONHOOK_H
 
+#include <cstdint>
+
+#include "../Patching/Signature.h"
+
 namespace Hooks
 {
 /**
@@ -9,6 +13,15 @@ namespace Hooks
 class IFunctionHook
 {
 public:
+    /**
+     * Represents when a hook is attached during startup.
+     */
+    enum Stage : uint8_t
+    {
+        EARLY,   /**< Attached before DllMain returns. */
+        DEFERRED /**< Attached by the background initialization thread. */
+    };
+
     virtual ~IFunctionHook() = default;
 
     /**
@@ -30,6 +43,45 @@ public:
      * @return Pointer to the detour function.
      */
     virtual void* GetDetourFunctionPointer() = 0;
+
+    /**
+     * Gets the signature of the first bytes of the target function.
+     * @return The signature, or an empty signature if the target should only
+     * be located by its RVA.
+     * @remarks If a signature is given, the RVA of the target is only trusted
+     * if the signature matches there. Otherwise the target is found by scanning
+     * the code sections, so the hook keeps working on builds of the game that
+     * it has no RVA for. Without one, the first bytes of the target are
+     * learned on the known builds and used as its signature on unknown ones,
+     * which only works while those bytes stay the same between builds. An
+     * early hook whose signature does not match at its RVA is only found once
+     * the deferred hooks are, and learned signatures are only used for
+     * deferred hooks, since neither can be done under the loader lock.
+     */
+    virtual SignatureView GetTargetSignature()
+    {
+        return {};
+    }
+
+    /**
+     * Gets when the hook is attached during startup.
+     * @return EARLY if the target can run before background initialization
+     * has finished, otherwise DEFERRED.
+     * @remarks Deferred hooks are attached while the game is running, so their
+     * targets must not run before the initialization gate is reached.
+     */
+    virtual Stage GetStage()
+    {
+        return DEFERRED;
+    }
+
+    /**
+     * Called just before the hook is attached, once its target function has
+     * been located.
+     */
+    virtual void OnAttaching()
+    {
+    }
 };
 } // namespace Hooks
 
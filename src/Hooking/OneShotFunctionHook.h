@@ -0,0 +1,214 @@
+#ifndef ONESHOTFUNCTIONHOOK_H
+#define ONESHOTFUNCTIONHOOK_H
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <cstring>
+#include <mutex>
+#include <string>
+#include <typeinfo>
+#include <vector>
+
+#include "StaticFunctionHook.h"
+
+#include "../Logging/Exception.h"
+#include "../Logging/Trace.h"
+#include "../Patching/MemoryProtection.h"
+
+namespace Hooks
+{
+/**
+ * Represents a hook that runs an action the first time its target function is
+ * called, and then removes itself so that later calls run the target function
+ * directly.
+ * @tparam THook The class that derives from this one, which must declare
+ *               @code static void Action(TParams... params) @endcode and
+ *               befriend this class if the action is not public.
+ * @tparam TargetRvaDebug Relative virtual address of the function to hook when
+ *                        injected into debug executable.
+ * @tparam TargetRvaRelease Relative virtual address of the function to hook
+ *                          when injected into release executable.
+ * @tparam TReturn Type of the return value of the target function.
+ * @tparam TParams Types of the parameters of the target function.
+ * @remarks Threads that call the target while the action is running wait for
+ *          it to finish. The hook is then removed by writing back the bytes
+ *          that Detours replaced, rather than with DetourDetach, as that would
+ *          free the trampoline while other threads may still be calling the
+ *          original function through it. The words after the jump are written
+ *          first and the word that holds the jump last, each with a single
+ *          aligned store, so other threads only ever run the jump or the
+ *          original code. On x64, Detours always writes a jmp rel32, so the
+ *          target must start within the first bytes of an aligned word. If
+ *          something else rewrites the target after the hook is attached, the
+ *          hook stays attached, and later calls only cost a check of the once
+ *          flag.
+ */
+template <typename THook, uint64_t TargetRvaDebug, uint64_t TargetRvaRelease,
+          typename TReturn, typename... TParams>
+class OneShotFunctionHook
+    : public StaticFunctionHook<
+          OneShotFunctionHook<THook, TargetRvaDebug, TargetRvaRelease, TReturn,
+                              TParams...>,
+          TargetRvaDebug, TargetRvaRelease, TReturn, TParams...>
+{
+private:
+    using Base = StaticFunctionHook<OneShotFunctionHook, TargetRvaDebug,
+                                    TargetRvaRelease, TReturn, TParams...>;
+    friend Base;
+
+    static constexpr size_t WORD_COUNT = 3;
+    static constexpr size_t WORD_SIZE = sizeof(uint64_t);
+    static constexpr uint8_t JUMP_OPCODE = 0xE9;
+    static constexpr size_t JUMP_SIZE = 5;
+
+    inline static std::once_flag hasRun_;
+    inline static std::atomic<bool> isDetached_;
+    inline static uint8_t* target_;
+    inline static std::array<uint64_t, WORD_COUNT> saved_;
+
+    /**
+     * Runs the action on the first call, and calls the target function.
+     * @param params The parameters that are passed to the target function.
+     * @return The return value of the target function.
+     */
+    static TReturn Detour(TParams... params)
+    {
+        std::call_once(hasRun_, [&] {
+            THook::Action(params...);
+            isDetached_.store(Detach(), std::memory_order_release);
+        });
+
+        return Base::original_(params...);
+    }
+
+public:
+    /**
+     * Saves the bytes at the start of the target function, so they can be
+     * written back once the action has run.
+     * @exception exception Thrown if the jump that Detours writes to the
+     * target would not fit in one aligned word, as the hook could then never
+     * remove itself.
+     */
+    void OnAttaching() override
+    {
+        target_ = static_cast<uint8_t*>(
+            *this->GetTargetFunctionPointerReference());
+        if (static_cast<size_t>(target_ - GetFirstWord()) + JUMP_SIZE >
+            WORD_SIZE)
+        {
+            Exception::Fatal("Cannot remove a one-shot hook from a misaligned "
+                             "target: " +
+                             std::string(typeid(THook).name()));
+        }
+
+        std::memcpy(saved_.data(), GetFirstWord(), sizeof(saved_));
+    }
+
+    /**
+     * Whether the action has run and the hook has been removed.
+     */
+    [[nodiscard]] static bool IsDetached()
+    {
+        return isDetached_.load(std::memory_order_acquire);
+    }
+
+private:
+    static uint8_t* GetFirstWord()
+    {
+        const auto address = reinterpret_cast<uintptr_t>(target_);
+        return reinterpret_cast<uint8_t*>(address - address % WORD_SIZE);
+    }
+
+    /**
+     * Writes back the bytes that were replaced when the hook was attached.
+     * @return True if the target function no longer jumps to the detour.
+     */
+    static bool Detach()
+    {
+        if (!target_)
+        {
+            return false;
+        }
+
+        const auto first = GetFirstWord();
+        std::array<uint64_t, WORD_COUNT> current{};
+        std::memcpy(current.data(), first, sizeof(current));
+        if (current == saved_)
+        {
+            return true;
+        }
+
+        if (target_[0] != JUMP_OPCODE)
+        {
+            // Something other than Detours has rewritten the target since
+            const TraceScope scope("OneShotFunctionHook::Detach",
+                                   "target was rewritten");
+            return false;
+        }
+
+        auto& protection = MemoryProtection::GetDefault();
+        const auto pageSize = protection.GetPageSize();
+        const auto alignDown = [&](uint8_t* address) {
+            const auto value = reinterpret_cast<uintptr_t>(address);
+            return reinterpret_cast<uint8_t*>(value - value % pageSize);
+        };
+
+        const auto start = alignDown(first);
+        const auto end = alignDown(first + sizeof(saved_) - 1) + pageSize;
+        std::vector<MemoryProtection::Region> changed;
+        auto isWritable = true;
+        for (const auto& region : protection.Query(start, end))
+        {
+            const auto changeStart = std::max(start, region.Start);
+            const auto changeEnd = std::min(end, region.End);
+            const auto writable = protection.GetWritable(region.Protection);
+            if (changeStart >= changeEnd || writable == region.Protection)
+            {
+                continue;
+            }
+
+            if (!protection.Protect(changeStart, changeEnd - changeStart,
+                                    writable))
+            {
+                isWritable = false;
+                break;
+            }
+
+            changed.push_back({changeStart, changeEnd, region.Protection});
+        }
+
+        if (isWritable)
+        {
+            const auto words = reinterpret_cast<uint64_t*>(first);
+            for (auto i = WORD_COUNT; i-- > 0;)
+            {
+                if (current[i] != saved_[i])
+                {
+                    std::atomic_ref(words[i]).store(saved_[i],
+                                                    std::memory_order_release);
+                }
+            }
+        }
+
+        for (const auto& region : changed)
+        {
+            protection.Protect(region.Start, region.End - region.Start,
+                               region.Protection);
+        }
+
+        if (!isWritable)
+        {
+            const TraceScope scope("OneShotFunctionHook::Detach",
+                                   "target could not be made writable");
+            return false;
+        }
+
+        protection.FlushInstructionCache(first, sizeof(saved_));
+        return true;
+    }
+};
+} // namespace Hooks
+
+#endif // ONESHOTFUNCTIONHOOK_H
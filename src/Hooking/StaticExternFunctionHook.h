@@ -0,0 +1,138 @@
+#ifndef STATICEXTERNFUNCTIONHOOK_H
+#define STATICEXTERNFUNCTIONHOOK_H
+
+#include <cstdint>
+#include <string>
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <dlfcn.h>
+#endif
+
+#include "HookStatistics.h"
+#include "IFunctionHook.h"
+
+#include "../Logging/Exception.h"
+
+namespace Hooks
+{
+/**
+ * Represents a detour that hooks an existing function from an external
+ * module to alter its logic, without any virtual calls when the detour runs.
+ * @tparam THook The class that derives from this one, which must declare
+ *               @code static TReturn Detour(TParams... params) @endcode and
+ *               befriend this class if the detour is not public.
+ * @tparam TargetModule Name of the module that contains the target function.
+ * @tparam TargetFunction Name of the function that is to be hooked.
+ * @tparam TReturn Return type of the target function.
+ * @tparam TParams Parameter types of the target function.
+ * @remarks This is the ExternFunctionHook counterpart of StaticFunctionHook.
+ *          Each implementation of this class can only be instantiated once.
+ */
+template <typename THook, const char* TargetModule, const char* TargetFunction,
+          typename TReturn, typename... TParams>
+class StaticExternFunctionHook : public IFunctionHook
+{
+private:
+    inline static bool isInstantiated_;
+    inline static size_t statisticsIndex_;
+
+    /**
+     * The function that Detours redirects the target function to.
+     * @param params The parameters that are passed to the target function.
+     * @return The return value of @code THook::Detour @endcode.
+     */
+    static TReturn DetourFunction(TParams... params)
+    {
+        const HookTimer timer(statisticsIndex_);
+        return THook::Detour(params...);
+    }
+
+protected:
+    using Original_t = TReturn (*)(TParams...);
+
+    /**
+     * Pointer to the target function. Should be invoked to call the target
+     * function from the detour if the original logic should still be executed.
+     */
+    inline static Original_t original_;
+
+    /**
+     * Records hook-specific events in the statistics of this hook, such as how
+     * many entries the detour modified.
+     * @param count The number of events.
+     * @remarks Does nothing unless hook statistics are enabled.
+     */
+    static void RecordEvents(const uint64_t count)
+    {
+        if constexpr (HookStatistics::IS_ENABLED)
+        {
+            HookStatistics::GetInstance().RecordEvents(statisticsIndex_, count);
+        }
+    }
+
+public:
+    /**
+     * Instantiates the function hook.
+     * @exception exception Thrown if this hook has already been instantiated
+     * once, or if the target module is not loaded or does not export the
+     * target function.
+     * @remarks Outside of Windows, the target is looked up among the shared
+     * libraries that are already loaded, so that the tools can hook one.
+     */
+    StaticExternFunctionHook()
+    {
+        if (isInstantiated_)
+        {
+            Exception::Fatal("Cannot instantiate the same hook twice.");
+        }
+
+        isInstantiated_ = true;
+
+        if constexpr (HookStatistics::IS_ENABLED)
+        {
+            statisticsIndex_ = HookStatistics::GetInstance().Register(this);
+        }
+
+#ifdef _WIN32
+        const auto module = GetModuleHandleA(TargetModule);
+        const auto function =
+            module ? GetProcAddress(module, TargetFunction) : nullptr;
+#else
+        const auto module = dlopen(TargetModule, RTLD_LAZY | RTLD_NOLOAD);
+        const auto function = module ? dlsym(module, TargetFunction) : nullptr;
+#endif
+        if (!function)
+        {
+            Exception::Fatal("Failed to find hook target: " +
+                             std::string(TargetModule) + "!" + TargetFunction);
+        }
+
+        original_ = reinterpret_cast<Original_t>(function);
+    }
+
+    StaticExternFunctionHook(const StaticExternFunctionHook&) = delete;
+
+    StaticExternFunctionHook& operator=(const StaticExternFunctionHook&) =
+        delete;
+
+    /**
+     * @copydoc IFunctionHook::GetTargetFunctionPointerReference
+     */
+    void** GetTargetFunctionPointerReference() override
+    {
+        return &reinterpret_cast<void*&>(original_);
+    }
+
+    /**
+     * @copydoc IFunctionHook::GetDetourFunctionPointer
+     */
+    void* GetDetourFunctionPointer() override
+    {
+        return reinterpret_cast<void*>(DetourFunction);
+    }
+};
+} // namespace Hooks
+
+#endif // STATICEXTERNFUNCTIONHOOK_H
@@ -0,0 +1,119 @@
+#ifndef STATICFUNCTIONHOOK_H
+#define STATICFUNCTIONHOOK_H
+
+#include <cstdint>
+
+#include "HookStatistics.h"
+#include "IFunctionHook.h"
+
+#include "../Host.h"
+
+namespace Hooks
+{
+/**
+ * Represents a detour that hooks an existing function to add extra logic to
+ * it, without any virtual calls when the detour runs.
+ * @tparam THook The class that derives from this one, which must declare
+ *               @code static TReturn Detour(TParams... params) @endcode and
+ *               befriend this class if the detour is not public.
+ * @tparam TargetRvaDebug Relative virtual address of the function to hook when
+ *                        injected into debug executable.
+ * @tparam TargetRvaRelease Relative virtual address of the function to hook
+ *                          when injected into release executable.
+ * @tparam TReturn Type of the return value of the target function.
+ * @tparam TParams Types of the parameters of the target function.
+ * @remarks Unlike FunctionHook, the detour is called directly from the thunk
+ *          that Detours jumps to, so it can be inlined into it, and the
+ *          original function is held in a static rather than loaded through
+ *          the hook instance. This should be preferred for targets that are
+ *          called frequently. Each implementation of this class can only be
+ *          instantiated once.
+ */
+template <typename THook, uint64_t TargetRvaDebug, uint64_t TargetRvaRelease,
+          typename TReturn, typename... TParams>
+class StaticFunctionHook : public IFunctionHook
+{
+private:
+    inline static bool isInstantiated_;
+    inline static size_t statisticsIndex_;
+
+    /**
+     * The function that Detours redirects the target function to.
+     * @param params The parameters that are passed to the target function.
+     * @return The return value of @code THook::Detour @endcode.
+     */
+    static TReturn DetourFunction(TParams... params)
+    {
+        const HookTimer timer(statisticsIndex_);
+        return THook::Detour(params...);
+    }
+
+protected:
+    using Original_t = TReturn (*)(TParams...);
+
+    /**
+     * Pointer to the target function. Should be invoked to call the target
+     * function from the detour if the original logic should still be executed.
+     */
+    inline static Original_t original_;
+
+    /**
+     * Records hook-specific events in the statistics of this hook, such as how
+     * many entries the detour modified.
+     * @param count The number of events.
+     * @remarks Does nothing unless hook statistics are enabled.
+     */
+    static void RecordEvents(const uint64_t count)
+    {
+        if constexpr (HookStatistics::IS_ENABLED)
+        {
+            HookStatistics::GetInstance().RecordEvents(statisticsIndex_, count);
+        }
+    }
+
+public:
+    /**
+     * Instantiates the function hook.
+     * @exception exception Thrown if this hook has already been instantiated
+     * once.
+     */
+    StaticFunctionHook()
+    {
+        if (isInstantiated_)
+        {
+            Exception::Fatal("Cannot instantiate the same hook twice.");
+        }
+
+        isInstantiated_ = true;
+
+        if constexpr (HookStatistics::IS_ENABLED)
+        {
+            statisticsIndex_ = HookStatistics::GetInstance().Register(this);
+        }
+        original_ = reinterpret_cast<Original_t>(
+            REBASE(TargetRvaDebug, TargetRvaRelease));
+    }
+
+    StaticFunctionHook(const StaticFunctionHook&) = delete;
+
+    StaticFunctionHook& operator=(const StaticFunctionHook&) = delete;
+
+    /**
+     * @copydoc IFunctionHook::GetTargetFunctionPointerReference
+     */
+    void** GetTargetFunctionPointerReference() override
+    {
+        return &reinterpret_cast<void*&>(original_);
+    }
+
+    /**
+     * @copydoc IFunctionHook::GetDetourFunctionPointer
+     */
+    void* GetDetourFunctionPointer() override
+    {
+        return reinterpret_cast<void*>(DetourFunction);
+    }
+};
+} // namespace Hooks
+
+#endif // STATICFUNCTIONHOOK_H
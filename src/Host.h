@@ -2,10 +2,14 @@
 #define HOST_H
 
 #include "Configuration.h"
+#include "Logging/Trace.h"
 
 #include <cstdint>
+
+#ifdef _WIN32
 #include <psapi.h>
 #include <windows.h>
+#endif
 
 /**
  * Discerns between two relative virtual addresses based on the host process
@@ -33,10 +37,16 @@
 class Host
 {
 public:
+#ifdef _WIN32
+    using ModuleHandle = HINSTANCE;
+#else
+    using ModuleHandle = void*;
+#endif
+
     /**
      * Handle to the host process module.
      */
-    inline static HINSTANCE hModule;
+    inline static ModuleHandle hModule;
 
     /**
      * Base address of the host process.
@@ -55,11 +65,13 @@ public:
 
     Host() = delete;
 
+#ifdef _WIN32
     /**
      * Initializes this class.
      */
     static void Initialize()
     {
+        const TraceScope scope("Host::Initialize");
         hModule = GetModuleHandle("ffxv_s.exe");
         BaseAddress = reinterpret_cast<uint64_t>(hModule);
         Type = Configuration::GetInstance().HostType;
@@ -74,6 +86,23 @@ public:
 
         ModuleSize = moduleInfo.SizeOfImage;
     }
+#endif
+
+    /**
+     * Initializes this class with an image that was not loaded by Windows,
+     * such as an executable mapped by a tool.
+     * @param module Start of the image, laid out at its RVAs.
+     * @param size Size of the image, in bytes.
+     * @param type The type of game executable that the image is.
+     */
+    static void Initialize(void* module, const uint32_t size,
+                           const Configuration::GameExecutableType type)
+    {
+        hModule = static_cast<ModuleHandle>(module);
+        BaseAddress = reinterpret_cast<uint64_t>(module);
+        ModuleSize = size;
+        Type = type;
+    }
 };
 
 #endif // HOST_H
@@ -0,0 +1,399 @@
+#ifndef ARCHIVEPREFETCHER_H
+#define ARCHIVEPREFETCHER_H
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <span>
+#include <thread>
+#include <unordered_set>
+#include <vector>
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
+
+#include "AssetAccessTrace.h"
+#include "EarcArchive.h"
+
+/**
+ * Replays an asset access trace against mapped archives, asking the operating
+ * system to read each asset in before the game looks it up.
+ * @remarks The trace is resolved to ranges of the archives up front. A worker
+ * thread then keeps the ranges of the next lookahead assets after the furthest
+ * one the game has asked for in flight, so the prefetcher follows the game
+ * rather than racing to the end of the trace and evicting what it read. The
+ * ranges are only advised, with madvise or PrefetchVirtualMemory, so the
+ * worker never blocks on the disk itself. A lookup is a hit if its asset was
+ * advised before the game first asked for it.
+ */
+class ArchivePrefetcher
+{
+public:
+    /**
+     * The default number of assets to keep in flight ahead of the game.
+     */
+    static constexpr size_t DEFAULT_LOOKAHEAD = 64;
+
+    /**
+     * Represents how well the trace predicted the game's lookups.
+     */
+    struct Statistics
+    {
+        /**
+         * The number of assets in the trace that were found in an archive.
+         */
+        size_t Planned;
+
+        /**
+         * The number of assets that were advised.
+         */
+        size_t Prefetched;
+
+        /**
+         * The number of bytes that were advised.
+         */
+        uint64_t PrefetchedBytes;
+
+        /**
+         * The number of planned assets that the game has asked for.
+         */
+        size_t Requests;
+
+        /**
+         * The number of requests whose asset was advised beforehand.
+         */
+        size_t Hits;
+
+        /**
+         * The number of lookups of assets that were not planned.
+         */
+        size_t Unplanned;
+
+        /**
+         * Gets the fraction of requests that were hits.
+         */
+        [[nodiscard]] double GetHitRate() const
+        {
+            return Requests == 0 ? 0
+                                 : static_cast<double>(Hits) /
+                                       static_cast<double>(Requests);
+        }
+    };
+
+private:
+    enum State : uint8_t
+    {
+        PENDING,
+        PREFETCHED,
+        REQUESTED
+    };
+
+    /**
+     * Represents an asset to prefetch, in the order of the trace.
+     */
+    struct Step
+    {
+        uint64_t NameHash;
+        std::span<const uint8_t> Data;
+    };
+
+    /**
+     * Represents an entry in the index of steps, sorted by name hash.
+     */
+    struct IndexEntry
+    {
+        uint64_t Hash;
+        uint32_t Index;
+
+        bool operator<(const IndexEntry& other) const
+        {
+            return Hash < other.Hash;
+        }
+    };
+
+    std::vector<Step> steps_;
+    std::vector<IndexEntry> index_;
+    std::unique_ptr<std::atomic<uint8_t>[]> states_;
+    size_t lookahead_;
+    size_t nextStep_{0};
+
+    std::atomic<size_t> cursor_{0};
+    std::atomic<size_t> prefetched_{0};
+    std::atomic<uint64_t> prefetchedBytes_{0};
+    std::atomic<size_t> requests_{0};
+    std::atomic<size_t> hits_{0};
+    std::atomic<size_t> unplanned_{0};
+
+    std::thread worker_;
+    std::mutex mutex_;
+    std::condition_variable wake_;
+    bool isStopping_{false};
+
+    inline static std::atomic<ArchivePrefetcher*> active_;
+
+public:
+    /**
+     * Resolves a trace against archives.
+     * @param archives The archives to read from, which must outlive this
+     * instance. Where several contain an asset, the last one is read, as later
+     * archives take priority.
+     * @param trace The accesses of an earlier run, in order. Assets that are
+     * in none of the archives, and later accesses of the same asset, are
+     * skipped.
+     * @param lookahead The number of assets to keep in flight ahead of the
+     * game.
+     */
+    ArchivePrefetcher(const std::span<EarcArchive* const> archives,
+                      const std::span<const AssetAccessTrace::Access> trace,
+                      const size_t lookahead = DEFAULT_LOOKAHEAD)
+        : lookahead_(std::max<size_t>(lookahead, 1))
+    {
+        using SQEX::Luminous::AssetManager::LmAssetID;
+        std::unordered_set<uint64_t> planned;
+        for (const auto& access : trace)
+        {
+            const auto key = access.NameHash & LmAssetID::NAME_HASH_MASK;
+            if (!planned.insert(key).second)
+            {
+                continue;
+            }
+
+            for (auto archive = archives.rbegin(); archive != archives.rend();
+                 ++archive)
+            {
+                if (const auto entry = (*archive)->FindNameHash(key))
+                {
+                    index_.push_back(
+                        {key, static_cast<uint32_t>(steps_.size())});
+                    steps_.push_back({key, (*archive)->GetData(*entry)});
+                    break;
+                }
+            }
+        }
+
+        std::sort(index_.begin(), index_.end());
+        states_ = std::make_unique<std::atomic<uint8_t>[]>(steps_.size());
+    }
+
+    ~ArchivePrefetcher()
+    {
+        Stop();
+    }
+
+    ArchivePrefetcher(const ArchivePrefetcher&) = delete;
+
+    ArchivePrefetcher& operator=(const ArchivePrefetcher&) = delete;
+
+    /**
+     * Gets the prefetcher that asset lookups are reported to, if any.
+     * @return The active prefetcher, or nullptr if lookups are not reported.
+     */
+    static ArchivePrefetcher* GetActive()
+    {
+        return active_.load(std::memory_order_acquire);
+    }
+
+    /**
+     * Sets the prefetcher that asset lookups are reported to.
+     * @param prefetcher The prefetcher, which must outlive every lookup that
+     * reports to it, or nullptr to stop reporting.
+     * @remarks The mod does not report its lookups to a prefetcher yet, as it
+     * does not know which archives the game has mounted.
+     */
+    static void SetActive(ArchivePrefetcher* prefetcher)
+    {
+        active_.store(prefetcher, std::memory_order_release);
+    }
+
+    /**
+     * Asks the operating system to read a range of a mapped file into memory
+     * without waiting for it.
+     * @param data The range.
+     */
+    static void Prefetch(const std::span<const uint8_t> data)
+    {
+        if (data.empty())
+        {
+            return;
+        }
+
+#ifdef _WIN32
+        WIN32_MEMORY_RANGE_ENTRY range{const_cast<uint8_t*>(data.data()),
+                                       data.size()};
+        PrefetchVirtualMemory(GetCurrentProcess(), 1, &range, 0);
+#else
+        // madvise needs the range to start on a page boundary
+        static const auto pageSize =
+            static_cast<uintptr_t>(sysconf(_SC_PAGESIZE));
+        const auto start =
+            reinterpret_cast<uintptr_t>(data.data()) & ~(pageSize - 1);
+        const auto end =
+            reinterpret_cast<uintptr_t>(data.data()) + data.size();
+        madvise(reinterpret_cast<void*>(start), end - start, MADV_WILLNEED);
+#endif
+    }
+
+    /**
+     * Starts prefetching on a worker thread.
+     */
+    void Start()
+    {
+        if (!worker_.joinable())
+        {
+            isStopping_ = false;
+            worker_ = std::thread([this] { RunWorker(); });
+        }
+    }
+
+    /**
+     * Stops the worker thread, if it is running.
+     */
+    void Stop()
+    {
+        if (!worker_.joinable())
+        {
+            return;
+        }
+
+        {
+            std::lock_guard lock(mutex_);
+            isStopping_ = true;
+        }
+
+        wake_.notify_one();
+        worker_.join();
+    }
+
+    /**
+     * Advises the assets that are due, up to the lookahead past the furthest
+     * asset the game has asked for.
+     * @return The number of assets that were advised before the game asked for
+     * them.
+     * @remarks The worker thread calls this whenever the game moves forward.
+     * It may be called directly instead of starting the worker, but not at the
+     * same time as the worker runs.
+     */
+    size_t PrefetchAhead()
+    {
+        const auto cursor = cursor_.load(std::memory_order_acquire);
+        const auto end = std::min(steps_.size(), cursor + lookahead_);
+        size_t count = 0;
+        for (; nextStep_ < end; nextStep_++)
+        {
+            auto& state = states_[nextStep_];
+            if (state.load(std::memory_order_relaxed) != PENDING)
+            {
+                continue;
+            }
+
+            // Only the advice that was given before the request is a hit
+            const auto data = steps_[nextStep_].Data;
+            Prefetch(data);
+            auto expected = static_cast<uint8_t>(PENDING);
+            if (state.compare_exchange_strong(expected, PREFETCHED,
+                                              std::memory_order_acq_rel))
+            {
+                prefetchedBytes_.fetch_add(data.size(),
+                                           std::memory_order_relaxed);
+                count++;
+            }
+        }
+
+        prefetched_.fetch_add(count, std::memory_order_relaxed);
+        return count;
+    }
+
+    /**
+     * Reports that the game looked up an asset.
+     * @param nameHash The name hash of the asset.
+     * @return True if this was the first request for the asset and it had
+     * already been advised.
+     */
+    bool OnRequest(const uint64_t nameHash)
+    {
+        using SQEX::Luminous::AssetManager::LmAssetID;
+        const auto key = nameHash & LmAssetID::NAME_HASH_MASK;
+        const auto match =
+            std::lower_bound(index_.begin(), index_.end(), IndexEntry{key, 0});
+        if (match == index_.end() || match->Hash != key)
+        {
+            unplanned_.fetch_add(1, std::memory_order_relaxed);
+            return false;
+        }
+
+        auto& state = states_[match->Index];
+        const auto previous =
+            state.exchange(REQUESTED, std::memory_order_acq_rel);
+        if (previous == REQUESTED)
+        {
+            return false;
+        }
+
+        requests_.fetch_add(1, std::memory_order_relaxed);
+        if (previous == PREFETCHED)
+        {
+            hits_.fetch_add(1, std::memory_order_relaxed);
+        }
+
+        // Move the cursor forward, waking the worker under its lock so that it
+        // cannot miss the change between checking and waiting
+        const size_t next = match->Index + 1;
+        auto cursor = cursor_.load(std::memory_order_relaxed);
+        while (cursor < next &&
+               !cursor_.compare_exchange_weak(cursor, next,
+                                              std::memory_order_release))
+        {
+        }
+
+        if (cursor < next)
+        {
+            {
+                std::lock_guard lock(mutex_);
+            }
+
+            wake_.notify_one();
+        }
+
+        return previous == PREFETCHED;
+    }
+
+    /**
+     * Gets how well the trace has predicted the game's lookups so far.
+     */
+    [[nodiscard]] Statistics GetStatistics() const
+    {
+        return {steps_.size(),
+                prefetched_.load(std::memory_order_relaxed),
+                prefetchedBytes_.load(std::memory_order_relaxed),
+                requests_.load(std::memory_order_relaxed),
+                hits_.load(std::memory_order_relaxed),
+                unplanned_.load(std::memory_order_relaxed)};
+    }
+
+private:
+    void RunWorker()
+    {
+        std::unique_lock lock(mutex_);
+        while (!isStopping_ && nextStep_ < steps_.size())
+        {
+            lock.unlock();
+            PrefetchAhead();
+            lock.lock();
+
+            wake_.wait(lock, [this] {
+                return isStopping_ ||
+                       nextStep_ < std::min(steps_.size(),
+                                            cursor_.load() + lookahead_);
+            });
+        }
+    }
+};
+
+#endif // ARCHIVEPREFETCHER_H
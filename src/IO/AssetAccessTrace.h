@@ -0,0 +1,433 @@
+#ifndef ASSETACCESSTRACE_H
+#define ASSETACCESSTRACE_H
+
+#include <algorithm>
+#include <atomic>
+#include <bit>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "../Replica/SQEX/Luminous/AssetManager/LmAssetID.h"
+
+#ifndef DRAUTOS_ACCESS_TRACE
+#define DRAUTOS_ACCESS_TRACE 0
+#endif
+
+/**
+ * Records the order that assets are first looked up in, so that later runs can
+ * read them ahead of time.
+ * @remarks Records are written to a buffer that is allocated up front, and
+ * records that do not fit are dropped rather than allocating during a lookup.
+ * Only the first lookup of each asset is recorded, which a filter of one bit
+ * per name hash decides without locking. Assets whose bit was already set by
+ * a different asset are not recorded, which is rare while the filter holds
+ * far fewer assets than FILTER_BITS. Traces are saved as a header followed by
+ * a 12-byte record for each lookup. The mod records one for each run when it
+ * is built with the DRAUTOS_ACCESS_TRACE CMake option, for RECORDING_DURATION
+ * after startup or until the game exits, whichever is first, and then saves it
+ * from a thread of its own.
+ */
+class AssetAccessTrace
+{
+public:
+    /**
+     * Whether the mod records asset lookups in this build.
+     */
+    static constexpr bool IS_ENABLED = DRAUTOS_ACCESS_TRACE != 0;
+
+    /**
+     * The tag at the start of every trace file, "DATR" in little-endian.
+     */
+    static constexpr uint32_t MAGIC = 0x52544144;
+
+    /**
+     * The version of the trace file format.
+     */
+    static constexpr uint32_t VERSION = 1;
+
+    /**
+     * The size of the trace file header.
+     */
+    static constexpr size_t HEADER_SIZE = 16;
+
+    /**
+     * The size of each record in a trace file.
+     */
+    static constexpr size_t RECORD_SIZE = 12;
+
+    /**
+     * The default maximum number of records.
+     */
+    static constexpr size_t DEFAULT_CAPACITY = 1 << 20;
+
+    /**
+     * The number of bits in the filter of assets that were already recorded.
+     */
+    static constexpr size_t FILTER_BITS = 1 << 23;
+
+    /**
+     * How long the mod records lookups for, which covers starting the game
+     * and loading into the world.
+     */
+    static constexpr std::chrono::seconds RECORDING_DURATION{120};
+
+    /**
+     * Represents the first lookup of an asset.
+     */
+    struct Access
+    {
+        /**
+         * The name hash of the asset, as LmAssetID::GetNameHash computes.
+         */
+        uint64_t NameHash;
+
+        /**
+         * The time of the lookup, in milliseconds since recording started.
+         */
+        uint32_t Milliseconds;
+
+        bool operator==(const Access& other) const = default;
+    };
+
+private:
+    /**
+     * The value that Stop moves the next record index to, so that every later
+     * lookup falls past the capacity.
+     */
+    static constexpr size_t STOPPED = SIZE_MAX / 2;
+
+    std::unique_ptr<Access[]> records_;
+    size_t capacity_;
+    std::atomic<size_t> next_{0};
+    std::atomic<size_t> written_{0};
+    size_t stoppedCount_{0};
+    std::unique_ptr<std::atomic<uint64_t>[]> filter_;
+    std::chrono::steady_clock::time_point origin_;
+
+    inline static std::atomic<AssetAccessTrace*> active_;
+
+    inline static std::mutex savingMutex_;
+    inline static std::condition_variable savingCondition_;
+    inline static bool isSaving_{false};
+    inline static bool isFinishing_{false};
+    inline static bool isSaved_{false};
+
+public:
+    /**
+     * Allocates a trace.
+     * @param capacity The maximum number of records.
+     */
+    explicit AssetAccessTrace(const size_t capacity = DEFAULT_CAPACITY)
+        : records_(std::make_unique<Access[]>(capacity)), capacity_(capacity),
+          filter_(std::make_unique<std::atomic<uint64_t>[]>(FILTER_BITS / 64)),
+          origin_(std::chrono::steady_clock::now())
+    {
+    }
+
+    AssetAccessTrace(const AssetAccessTrace&) = delete;
+
+    AssetAccessTrace& operator=(const AssetAccessTrace&) = delete;
+
+    /**
+     * Gets the trace that asset lookups are recorded to, if any.
+     * @return The active trace, or nullptr if lookups are not being recorded.
+     */
+    static AssetAccessTrace* GetActive()
+    {
+        return active_.load(std::memory_order_acquire);
+    }
+
+    /**
+     * Sets the trace that asset lookups are recorded to.
+     * @param trace The trace, which must outlive every lookup that records to
+     * it, or nullptr to stop recording.
+     */
+    static void SetActive(AssetAccessTrace* trace)
+    {
+        active_.store(trace, std::memory_order_release);
+    }
+
+    /**
+     * Stops recording to the active trace and saves it once RECORDING_DURATION
+     * has passed, or as soon as Finish is called, on a thread of its own.
+     * @param path Path to the file to write.
+     * @remarks Nothing waits for the thread, so this can be called from the
+     * initialization gate. It should only be called once.
+     */
+    static void SaveActiveLater(std::filesystem::path path)
+    {
+        {
+            const std::lock_guard lock(savingMutex_);
+            isSaving_ = true;
+        }
+
+        std::thread([path = std::move(path)] {
+            {
+                std::unique_lock lock(savingMutex_);
+                savingCondition_.wait_for(lock, RECORDING_DURATION,
+                                          [] { return isFinishing_; });
+            }
+
+            if (const auto trace = GetActive())
+            {
+                SetActive(nullptr);
+                trace->Stop();
+                trace->Save(path);
+            }
+
+            {
+                const std::lock_guard lock(savingMutex_);
+                isSaved_ = true;
+            }
+
+            savingCondition_.notify_all();
+        }).detach();
+    }
+
+    /**
+     * Makes SaveActiveLater stop recording and save the trace now, and waits
+     * for the trace to be saved.
+     * @param timeout The longest time to wait, which should be zero while the
+     * loader lock is held, as the file must not be written under it.
+     * @return True if the trace has been saved.
+     * @remarks When the process exits, Windows stops every other thread before
+     * DllMain is told, so this must be called before then for the trace to be
+     * saved.
+     */
+    static bool Finish(const std::chrono::milliseconds timeout)
+    {
+        std::unique_lock lock(savingMutex_);
+        if (!isSaving_)
+        {
+            return false;
+        }
+
+        isFinishing_ = true;
+        savingCondition_.notify_all();
+        return savingCondition_.wait_for(lock, timeout,
+                                         [] { return isSaved_; });
+    }
+
+    /**
+     * Gets the default location of the trace file.
+     * @return %LOCALAPPDATA%/Flagrum/logs/DrautosAccessTrace.bin, or an empty
+     * path if the local application data folder is unknown.
+     */
+    static std::filesystem::path GetDefaultPath()
+    {
+        const auto localAppData = std::getenv("LOCALAPPDATA");
+        if (!localAppData || !*localAppData)
+        {
+            return {};
+        }
+
+        return std::filesystem::path(localAppData) / "Flagrum" / "logs" /
+               "DrautosAccessTrace.bin";
+    }
+
+    /**
+     * Records a lookup of an asset, unless it was already recorded.
+     * @param nameHash The name hash of the asset.
+     */
+    void Record(const uint64_t nameHash)
+    {
+        using SQEX::Luminous::AssetManager::LmAssetID;
+        const auto key = nameHash & LmAssetID::NAME_HASH_MASK;
+
+        // Mix the hash, as paths that only differ near their end differ in
+        // few of its bits
+        const auto bit = (key * 0x9E3779B97F4A7C15) >>
+                         (64 - std::countr_zero(FILTER_BITS));
+        auto& word = filter_[bit / 64];
+        const auto mask = uint64_t{1} << (bit % 64);
+        if ((word.load(std::memory_order_relaxed) & mask) != 0 ||
+            (word.fetch_or(mask, std::memory_order_relaxed) & mask) != 0)
+        {
+            return;
+        }
+
+        const auto index = next_.fetch_add(1, std::memory_order_relaxed);
+        if (index < capacity_)
+        {
+            const auto elapsed = std::chrono::steady_clock::now() - origin_;
+            records_[index] = {
+                key, static_cast<uint32_t>(
+                         std::chrono::duration_cast<std::chrono::milliseconds>(
+                             elapsed)
+                             .count())};
+            written_.fetch_add(1, std::memory_order_release);
+        }
+    }
+
+    /**
+     * Stops recording, and waits for the lookups that were already writing a
+     * record to finish.
+     * @remarks The trace should be removed with SetActive first. Lookups that
+     * reach the trace afterwards are ignored, so it can then be read and saved
+     * while the game keeps running.
+     */
+    void Stop()
+    {
+        const auto count = next_.exchange(STOPPED, std::memory_order_acq_rel);
+        if (count >= STOPPED)
+        {
+            return;
+        }
+
+        stoppedCount_ = count;
+        const auto end = std::min(count, capacity_);
+        while (written_.load(std::memory_order_acquire) < end)
+        {
+            std::this_thread::yield();
+        }
+    }
+
+    /**
+     * Gets the number of records.
+     */
+    [[nodiscard]] size_t GetSize() const
+    {
+        return std::min(GetCount(), capacity_);
+    }
+
+    /**
+     * Gets the number of records that were dropped because the buffer was
+     * full.
+     */
+    [[nodiscard]] size_t GetDroppedCount() const
+    {
+        const auto count = GetCount();
+        return count > capacity_ ? count - capacity_ : 0;
+    }
+
+    /**
+     * Gets a copy of every record, in the order they were recorded.
+     * @remarks This should only be called once no lookups are recording, or
+     * after Stop, as records that are still being written may be copied
+     * partially.
+     */
+    [[nodiscard]] std::vector<Access> GetAccesses() const
+    {
+        return {records_.get(), records_.get() + GetSize()};
+    }
+
+    /**
+     * Writes every record to a trace file.
+     * @param path Path to the file to write.
+     * @return True if the file was written.
+     * @remarks This should only be called once no lookups are recording, or
+     * after Stop.
+     */
+    bool Save(const std::filesystem::path& path) const
+    {
+        return Save(path, GetAccesses());
+    }
+
+    /**
+     * Writes records to a trace file.
+     * @param path Path to the file to write.
+     * @param records The records, in the order they were recorded.
+     * @return True if the file was written.
+     */
+    static bool Save(const std::filesystem::path& path,
+                     const std::vector<Access>& records)
+    {
+        if (path.empty())
+        {
+            return false;
+        }
+
+        std::error_code error;
+        std::filesystem::create_directories(path.parent_path(), error);
+
+        std::vector<char> buffer(HEADER_SIZE + records.size() * RECORD_SIZE);
+        const uint64_t count = records.size();
+        std::memcpy(&buffer[0], &MAGIC, 4);
+        std::memcpy(&buffer[4], &VERSION, 4);
+        std::memcpy(&buffer[8], &count, 8);
+        for (size_t i = 0; i < records.size(); i++)
+        {
+            const auto pRecord = &buffer[HEADER_SIZE + i * RECORD_SIZE];
+            std::memcpy(pRecord, &records[i].NameHash, 8);
+            std::memcpy(pRecord + 8, &records[i].Milliseconds, 4);
+        }
+
+        std::ofstream stream(path, std::ios::binary);
+        stream.write(buffer.data(),
+                     static_cast<std::streamsize>(buffer.size()));
+        return static_cast<bool>(stream);
+    }
+
+    /**
+     * Reads the records from a trace file.
+     * @param path Path to the file to read.
+     * @return The records, in the order they were recorded.
+     * @exception std::runtime_error Thrown if the file could not be read or is
+     * not a valid trace.
+     */
+    static std::vector<Access> Load(const std::filesystem::path& path)
+    {
+        std::ifstream stream(path, std::ios::binary);
+        char header[HEADER_SIZE];
+        if (!stream.read(header, HEADER_SIZE))
+        {
+            throw std::runtime_error("Failed to read " + path.string());
+        }
+
+        uint32_t magic;
+        uint32_t version;
+        uint64_t count;
+        std::memcpy(&magic, &header[0], 4);
+        std::memcpy(&version, &header[4], 4);
+        std::memcpy(&count, &header[8], 8);
+        if (magic != MAGIC || version != VERSION)
+        {
+            throw std::runtime_error(path.string() +
+                                     " is not an asset access trace");
+        }
+
+        std::error_code error;
+        const auto size = std::filesystem::file_size(path, error);
+        if (error || count > (size - HEADER_SIZE) / RECORD_SIZE)
+        {
+            throw std::runtime_error(path.string() + " is truncated");
+        }
+
+        std::vector<char> buffer(count * RECORD_SIZE);
+        stream.read(buffer.data(),
+                    static_cast<std::streamsize>(buffer.size()));
+        std::vector<Access> records(count);
+        for (size_t i = 0; i < records.size(); i++)
+        {
+            const auto pRecord = &buffer[i * RECORD_SIZE];
+            std::memcpy(&records[i].NameHash, pRecord, 8);
+            std::memcpy(&records[i].Milliseconds, pRecord + 8, 4);
+        }
+
+        return records;
+    }
+
+private:
+    /**
+     * Gets the number of lookups that tried to record, up to when recording
+     * stopped.
+     */
+    [[nodiscard]] size_t GetCount() const
+    {
+        const auto count = next_.load(std::memory_order_acquire);
+        return count >= STOPPED ? stoppedCount_ : count;
+    }
+};
+
+#endif // ASSETACCESSTRACE_H
@@ -0,0 +1,312 @@
+#ifndef ASSETOVERRIDETABLE_H
+#define ASSETOVERRIDETABLE_H
+
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <cstdint>
+#include <filesystem>
+#include <stdexcept>
+#include <string_view>
+#include <vector>
+
+#include "EarcArchive.h"
+
+#include "../Replica/SQEX/Luminous/AssetManager/LmAssetID.h"
+
+/**
+ * Maps the name hashes of assets to loose files and mod archive entries that
+ * replace them.
+ * @remarks The table is split into buckets of one cache line, each holding
+ * SLOTS_PER_BUCKET slots that pack a name hash with the index of its target.
+ * An asset is placed in the bucket its hash maps to, or the next bucket with a
+ * free slot, and the table grows before it is half full, so nearly every
+ * bucket has a free slot and most lookups that miss read a single cache line.
+ * A table is built on one thread and only read once it is complete. Nothing
+ * in the mod builds or consults a table yet: hooking it into the game's asset
+ * lookup is deferred until the layout of the ArcAssociation that the lookup
+ * returns is known, as serving an override needs it. Until then, the table is
+ * only exercised by DrautosBenchmark.
+ */
+class AssetOverrideTable
+{
+public:
+    /**
+     * The number of slots in each bucket, which fill one cache line.
+     */
+    static constexpr size_t SLOTS_PER_BUCKET = 8;
+
+    /**
+     * The maximum number of overrides in one table.
+     */
+    static constexpr size_t MAX_OVERRIDES = (1 << 20) - 1;
+
+    /**
+     * Represents the data that replaces an asset.
+     */
+    struct Target
+    {
+        /**
+         * The loose file or mod archive that holds the data.
+         */
+        std::filesystem::path Path;
+
+        /**
+         * The offset of the data within the file, which is 0 for loose files.
+         */
+        uint64_t Offset;
+
+        /**
+         * The size of the data as it is stored.
+         */
+        uint64_t Size;
+
+        /**
+         * The size of the data once decompressed.
+         */
+        uint64_t DecompressedSize;
+
+        /**
+         * Whether the data is stored as compressed archive chunks.
+         */
+        bool IsCompressed;
+    };
+
+    /**
+     * Represents how well the table is laid out.
+     */
+    struct Statistics
+    {
+        size_t Count;
+        size_t BucketCount;
+
+        /**
+         * The mean number of buckets read by a lookup that misses.
+         */
+        double MeanMissProbes;
+
+        /**
+         * The most buckets read by any lookup that misses.
+         */
+        size_t MaxMissProbes;
+    };
+
+private:
+    static constexpr size_t MIN_BUCKETS = 16;
+    static constexpr uint64_t KEY_MASK =
+        SQEX::Luminous::AssetManager::LmAssetID::NAME_HASH_MASK;
+    static constexpr int INDEX_SHIFT = 44;
+
+    /**
+     * Represents the slots of one bucket. Each slot holds a name hash in its
+     * low bits and the index of its target plus one in its high bits, so an
+     * empty slot is 0.
+     */
+    struct alignas(64) Bucket
+    {
+        std::array<uint64_t, SLOTS_PER_BUCKET> Slots;
+    };
+
+    std::vector<Bucket> buckets_;
+    std::vector<Target> targets_;
+    int bucketShift_;
+
+public:
+    AssetOverrideTable()
+        : buckets_(MIN_BUCKETS), bucketShift_(GetShift(MIN_BUCKETS))
+    {
+    }
+
+    AssetOverrideTable(const AssetOverrideTable&) = delete;
+
+    AssetOverrideTable& operator=(const AssetOverrideTable&) = delete;
+
+    /**
+     * Adds an override, replacing any earlier one for the same asset.
+     * @param nameHash The name hash of the asset, as LmAssetID::GetNameHash
+     * computes.
+     * @param target The data that replaces the asset.
+     * @exception std::length_error Thrown if the table already holds
+     * MAX_OVERRIDES overrides.
+     */
+    void Add(const uint64_t nameHash, Target target)
+    {
+        const auto key = nameHash & KEY_MASK;
+        if (const auto pSlot = FindSlot(key))
+        {
+            targets_[(*pSlot >> INDEX_SHIFT) - 1] = std::move(target);
+            return;
+        }
+
+        if (targets_.size() >= MAX_OVERRIDES)
+        {
+            throw std::length_error("Too many asset overrides");
+        }
+
+        if ((targets_.size() + 1) * 2 > buckets_.size() * SLOTS_PER_BUCKET)
+        {
+            Grow();
+        }
+
+        targets_.push_back(std::move(target));
+        Insert(key | static_cast<uint64_t>(targets_.size()) << INDEX_SHIFT);
+    }
+
+    /**
+     * Adds a loose file that replaces an asset.
+     * @param uri The URI of the asset.
+     * @param path Path to the file.
+     * @exception std::filesystem::filesystem_error Thrown if the size of the
+     * file could not be read.
+     */
+    void AddLooseFile(const std::string_view uri,
+                      const std::filesystem::path& path)
+    {
+        const auto size = std::filesystem::file_size(path);
+        Add(SQEX::Luminous::AssetManager::LmAssetID::ComputeNameHash(uri),
+            {path, 0, size, size, false});
+    }
+
+    /**
+     * Adds every file in a mod archive, replacing the assets with the same
+     * URIs.
+     * @param archive The archive.
+     * @param path Path to the archive, which lookups are directed to.
+     * @return The number of files that were added.
+     */
+    size_t AddArchive(const EarcArchive& archive,
+                      const std::filesystem::path& path)
+    {
+        const auto entries = archive.GetEntries();
+        for (const auto& entry : entries)
+        {
+            Add(entry.FullHash, {path, entry.DataOffset, entry.ProcessedSize,
+                                 entry.Size, entry.IsCompressed()});
+        }
+
+        return entries.size();
+    }
+
+    /**
+     * Finds the override for an asset.
+     * @param nameHash The name hash of the asset.
+     * @return The data that replaces the asset, or nullptr if it is not
+     * overridden.
+     */
+    [[nodiscard]] const Target* Find(const uint64_t nameHash) const
+    {
+        const auto pSlot = FindSlot(nameHash & KEY_MASK);
+        return pSlot ? &targets_[(*pSlot >> INDEX_SHIFT) - 1] : nullptr;
+    }
+
+    /**
+     * Gets the number of overrides.
+     */
+    [[nodiscard]] size_t GetSize() const
+    {
+        return targets_.size();
+    }
+
+    /**
+     * Measures how many buckets lookups read.
+     */
+    [[nodiscard]] Statistics GetStatistics() const
+    {
+        // A miss reads from its bucket up to the first one with a free slot
+        Statistics statistics{targets_.size(), buckets_.size(), 0, 0};
+        const auto mask = buckets_.size() - 1;
+        size_t totalProbes = 0;
+        for (size_t start = 0; start < buckets_.size(); start++)
+        {
+            size_t probes = 1;
+            for (auto i = start; IsFull(buckets_[i]); i = (i + 1) & mask)
+            {
+                probes++;
+            }
+
+            totalProbes += probes;
+            statistics.MaxMissProbes =
+                std::max(statistics.MaxMissProbes, probes);
+        }
+
+        statistics.MeanMissProbes = static_cast<double>(totalProbes) /
+                                    static_cast<double>(buckets_.size());
+        return statistics;
+    }
+
+private:
+    static int GetShift(const size_t bucketCount)
+    {
+        return 64 - std::countr_zero(bucketCount);
+    }
+
+    /**
+     * Maps a name hash to its bucket, mixing its bits first, as paths that
+     * only differ near their end differ in few bits of their hash.
+     */
+    [[nodiscard]] size_t GetBucket(const uint64_t key) const
+    {
+        return static_cast<size_t>((key * 0x9E3779B97F4A7C15) >> bucketShift_);
+    }
+
+    static bool IsFull(const Bucket& bucket)
+    {
+        return bucket.Slots.back() != 0;
+    }
+
+    [[nodiscard]] const uint64_t* FindSlot(const uint64_t key) const
+    {
+        const auto mask = buckets_.size() - 1;
+        for (auto i = GetBucket(key);; i = (i + 1) & mask)
+        {
+            // Slots fill from the front, so the first empty one ends the search
+            for (const auto& slot : buckets_[i].Slots)
+            {
+                if (slot == 0)
+                {
+                    return nullptr;
+                }
+
+                if ((slot & KEY_MASK) == key)
+                {
+                    return &slot;
+                }
+            }
+        }
+    }
+
+    void Insert(const uint64_t slotValue)
+    {
+        const auto mask = buckets_.size() - 1;
+        for (auto i = GetBucket(slotValue & KEY_MASK);; i = (i + 1) & mask)
+        {
+            for (auto& slot : buckets_[i].Slots)
+            {
+                if (slot == 0)
+                {
+                    slot = slotValue;
+                    return;
+                }
+            }
+        }
+    }
+
+    void Grow()
+    {
+        const auto previous = std::move(buckets_);
+        buckets_ = std::vector<Bucket>(previous.size() * 2);
+        bucketShift_ = GetShift(buckets_.size());
+        for (const auto& bucket : previous)
+        {
+            for (const auto slot : bucket.Slots)
+            {
+                if (slot != 0)
+                {
+                    Insert(slot);
+                }
+            }
+        }
+    }
+};
+
+#endif // ASSETOVERRIDETABLE_H
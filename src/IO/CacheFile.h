@@ -0,0 +1,202 @@
+#ifndef CACHEFILE_H
+#define CACHEFILE_H
+
+#include <cstdint>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <string>
+#include <string_view>
+
+/**
+ * Reads and writes a versioned binary file of entries that Drautos keeps in
+ * the Flagrum cache folder.
+ * @remarks The file starts with a magic number and a version, followed by an
+ * optional header that belongs to the owner of the file, the number of entries
+ * and the entries themselves. Failing to read or write the file is never an
+ * error, since everything that is cached can be found again.
+ */
+class CacheFile
+{
+private:
+    static constexpr uint32_t MAX_STRING_SIZE = 1024;
+
+    std::filesystem::path path_;
+    uint32_t magic_;
+    uint32_t version_;
+
+public:
+    /**
+     * Instantiates a cache file.
+     * @param path Path to the file, or an empty path to disable persistence.
+     * @param magic The magic number that identifies the kind of file.
+     * @param version The version of the entry encoding.
+     */
+    CacheFile(std::filesystem::path path, const uint32_t magic,
+              const uint32_t version)
+        : path_(std::move(path)), magic_(magic), version_(version)
+    {
+    }
+
+    /**
+     * Gets the location of a file in the Flagrum cache folder.
+     * @param fileName The name of the file.
+     * @return %LOCALAPPDATA%/Flagrum/cache/fileName, or an empty path if the
+     * local application data folder is unknown.
+     */
+    static std::filesystem::path GetDefaultPath(const std::string_view fileName)
+    {
+        const auto localAppData = std::getenv("LOCALAPPDATA");
+        if (!localAppData || !*localAppData)
+        {
+            return {};
+        }
+
+        return std::filesystem::path(localAppData) / "Flagrum" / "cache" /
+               fileName;
+    }
+
+    /**
+     * Reads the file.
+     * @param readHeader Reads the header of the owner and returns whether it
+     * is the one expected.
+     * @param readEntry Reads a single entry and returns whether it is valid.
+     * @return True if the file exists and every entry in it was read.
+     * @remarks The entries read before a failure are not undone.
+     */
+    template <typename TReadHeader, typename TReadEntry>
+    bool Load(TReadHeader&& readHeader, TReadEntry&& readEntry) const
+    {
+        if (path_.empty())
+        {
+            return false;
+        }
+
+        std::ifstream stream(path_, std::ios::binary);
+        if (!stream)
+        {
+            return false;
+        }
+
+        uint32_t magic;
+        uint32_t version;
+        uint32_t count;
+        if (!Read(stream, magic) || magic != magic_ ||
+            !Read(stream, version) || version != version_ ||
+            !readHeader(stream) || !Read(stream, count))
+        {
+            return false;
+        }
+
+        for (uint32_t i = 0; i < count; i++)
+        {
+            if (!readEntry(stream) || !stream)
+            {
+                return false;
+            }
+        }
+
+        return true;
+    }
+
+    /**
+     * Writes the file.
+     * @param writeHeader Writes the header of the owner.
+     * @param entries The entries to write.
+     * @param writeEntry Writes a single entry.
+     * @return True if the file was written.
+     * @remarks The file is written to a temporary file first and then renamed
+     * over the original, so a crash part way through never leaves a truncated
+     * file behind.
+     */
+    template <typename TWriteHeader, typename TEntries, typename TWriteEntry>
+    bool Save(TWriteHeader&& writeHeader, const TEntries& entries,
+              TWriteEntry&& writeEntry) const
+    {
+        if (path_.empty())
+        {
+            return false;
+        }
+
+        std::error_code error;
+        std::filesystem::create_directories(path_.parent_path(), error);
+
+        auto temporaryPath = path_;
+        temporaryPath += ".tmp";
+
+        {
+            std::ofstream stream(temporaryPath,
+                                 std::ios::binary | std::ios::trunc);
+            if (!stream)
+            {
+                return false;
+            }
+
+            Write(stream, magic_);
+            Write(stream, version_);
+            writeHeader(stream);
+            Write(stream, static_cast<uint32_t>(entries.size()));
+
+            for (const auto& entry : entries)
+            {
+                writeEntry(stream, entry);
+            }
+
+            stream.flush();
+            if (!stream)
+            {
+                stream.close();
+                std::filesystem::remove(temporaryPath, error);
+                return false;
+            }
+        }
+
+        std::filesystem::rename(temporaryPath, path_, error);
+        if (error)
+        {
+            std::filesystem::remove(temporaryPath, error);
+            return false;
+        }
+
+        return true;
+    }
+
+    template <typename T> static bool Read(std::istream& stream, T& value)
+    {
+        stream.read(reinterpret_cast<char*>(&value), sizeof(T));
+        return static_cast<bool>(stream);
+    }
+
+    template <typename T> static void Write(std::ostream& stream, const T& value)
+    {
+        stream.write(reinterpret_cast<const char*>(&value), sizeof(T));
+    }
+
+    /**
+     * Reads a string written by WriteString.
+     * @return False if the string could not be read or is implausibly long.
+     */
+    static bool ReadString(std::istream& stream, std::string& value)
+    {
+        uint32_t size;
+        if (!Read(stream, size) || size > MAX_STRING_SIZE)
+        {
+            return false;
+        }
+
+        value.resize(size);
+        stream.read(value.data(), size);
+        return static_cast<bool>(stream);
+    }
+
+    /**
+     * Writes a string prefixed by its size.
+     */
+    static void WriteString(std::ostream& stream, const std::string& value)
+    {
+        Write(stream, static_cast<uint32_t>(value.size()));
+        stream.write(value.data(), static_cast<std::streamsize>(value.size()));
+    }
+};
+
+#endif // CACHEFILE_H
@@ -0,0 +1,505 @@
+#ifndef EARCARCHIVE_H
+#define EARCARCHIVE_H
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <filesystem>
+#include <iterator>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <span>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "MappedFile.h"
+
+#include "../Replica/SQEX/Luminous/AssetManager/LmArcEntryFlags.h"
+#include "../Replica/SQEX/Luminous/AssetManager/LmAssetID.h"
+
+/**
+ * Reads an EARC archive in place, without copying its entries or payloads.
+ * @remarks The archive is either memory-mapped or read from a buffer that the
+ * caller keeps alive. Entries are decoded from the file headers on each
+ * access, so opening an archive only validates it. Real archives sort their
+ * file headers by full hash, as the game binary searches them, so Find does the
+ * same. Archives written out of order get a sorted side index instead, and
+ * FindUri builds an index by name hash on its first call, as name hashes are
+ * not in the same order as full hashes.
+ */
+class EarcArchive
+{
+public:
+    /**
+     * The tag at the start of every archive, "CRAF" in little-endian.
+     */
+    static constexpr uint32_t MAGIC = 0x46415243;
+
+    /**
+     * The size of the archive header.
+     */
+    static constexpr size_t HEADER_SIZE = 0x40;
+
+    /**
+     * The size of each file header in the entry table.
+     */
+    static constexpr size_t ENTRY_SIZE = 0x28;
+
+    /**
+     * The bit of the version that marks archives whose file headers are
+     * obfuscated.
+     */
+    static constexpr uint32_t PROTECTED_VERSION = 0x80000000;
+
+    /**
+     * Represents the fields of the archive header.
+     */
+    struct Header
+    {
+        uint32_t Tag;
+        uint32_t Version;
+        uint32_t FileCount;
+        uint32_t BlockSize;
+        uint32_t FileHeadersOffset;
+        uint32_t UriListOffset;
+        uint32_t PathListOffset;
+        uint32_t DataOffset;
+        uint32_t Flags;
+        uint32_t ChunkSize;
+        uint64_t Hash;
+    };
+
+    /**
+     * Represents the fields of one file header.
+     */
+    struct Entry
+    {
+        /**
+         * The asset ID of the file, as in LmAssetID::fullHash_.
+         */
+        uint64_t FullHash;
+
+        /**
+         * The size of the file once decompressed.
+         */
+        uint32_t Size;
+
+        /**
+         * The size of the file as it is stored in the archive.
+         */
+        uint32_t ProcessedSize;
+
+        uint32_t Flags;
+        uint32_t UriOffset;
+        uint64_t DataOffset;
+        uint32_t RelativePathOffset;
+        uint8_t LocalizationType;
+        uint8_t Locale;
+        uint16_t Key;
+
+        /**
+         * Whether the file is stored compressed, including files whose flag
+         * Flagrum has masked.
+         */
+        [[nodiscard]] bool IsCompressed() const
+        {
+            using SQEX::Luminous::AssetManager::LmArcEntryFlags;
+            const auto flags = static_cast<int16_t>(Flags);
+            return (LmArcEntryFlags::Unmask(flags) &
+                    LmArcEntryFlags::COMPRESSED) != 0;
+        }
+    };
+
+    /**
+     * A view of the entry table that decodes entries as they are read.
+     */
+    class EntryTable
+    {
+    private:
+        const uint8_t* data_;
+        size_t count_;
+
+    public:
+        /**
+         * Iterates over the entries in the order they are stored.
+         */
+        class Iterator
+        {
+        private:
+            const uint8_t* pEntry_;
+
+        public:
+            using iterator_category = std::input_iterator_tag;
+            using value_type = Entry;
+            using difference_type = std::ptrdiff_t;
+
+            explicit Iterator(const uint8_t* pEntry) : pEntry_(pEntry)
+            {
+            }
+
+            Entry operator*() const
+            {
+                return DecodeEntry(pEntry_);
+            }
+
+            Iterator& operator++()
+            {
+                pEntry_ += ENTRY_SIZE;
+                return *this;
+            }
+
+            bool operator==(const Iterator& other) const = default;
+        };
+
+        EntryTable(const uint8_t* data, const size_t count)
+            : data_(data), count_(count)
+        {
+        }
+
+        [[nodiscard]] size_t size() const
+        {
+            return count_;
+        }
+
+        Entry operator[](const size_t index) const
+        {
+            return DecodeEntry(data_ + index * ENTRY_SIZE);
+        }
+
+        [[nodiscard]] Iterator begin() const
+        {
+            return Iterator(data_);
+        }
+
+        [[nodiscard]] Iterator end() const
+        {
+            return Iterator(data_ + count_ * ENTRY_SIZE);
+        }
+    };
+
+private:
+    /**
+     * Represents an entry in a side index, sorted by hash.
+     */
+    struct IndexEntry
+    {
+        uint64_t Hash;
+        uint32_t Index;
+
+        bool operator<(const IndexEntry& other) const
+        {
+            return Hash < other.Hash;
+        }
+    };
+
+    std::unique_ptr<MappedFile> file_;
+    std::span<const uint8_t> data_;
+    Header header_{};
+    std::vector<IndexEntry> hashIndex_;
+    std::vector<IndexEntry> nameIndex_;
+    std::once_flag hasNameIndex_;
+
+public:
+    /**
+     * Maps an archive into memory and opens it.
+     * @param path Path to the archive.
+     * @exception std::runtime_error Thrown if the archive could not be mapped
+     * or is not a valid archive.
+     */
+    explicit EarcArchive(const std::filesystem::path& path)
+        : file_(std::make_unique<MappedFile>(path))
+    {
+        Open({file_->GetData(), file_->GetSize()});
+    }
+
+    /**
+     * Opens an archive that is already in memory.
+     * @param data The archive, which must outlive this instance.
+     * @exception std::runtime_error Thrown if the data is not a valid archive.
+     */
+    explicit EarcArchive(const std::span<const uint8_t> data)
+    {
+        Open(data);
+    }
+
+    EarcArchive(const EarcArchive&) = delete;
+
+    EarcArchive& operator=(const EarcArchive&) = delete;
+
+    /**
+     * Gets the archive header.
+     */
+    [[nodiscard]] const Header& GetHeader() const
+    {
+        return header_;
+    }
+
+    /**
+     * Gets a view of the entry table.
+     */
+    [[nodiscard]] EntryTable GetEntries() const
+    {
+        return {data_.data() + header_.FileHeadersOffset, header_.FileCount};
+    }
+
+    /**
+     * Finds the entry of an asset by its full hash.
+     * @param fullHash The full hash of the asset, as in LmAssetID::fullHash_.
+     * @return The entry, or nothing if the archive does not contain the asset.
+     */
+    [[nodiscard]] std::optional<Entry> Find(const uint64_t fullHash) const
+    {
+        const auto entries = GetEntries();
+        if (!hashIndex_.empty())
+        {
+            const auto match = std::lower_bound(
+                hashIndex_.begin(), hashIndex_.end(), IndexEntry{fullHash, 0});
+            if (match != hashIndex_.end() && match->Hash == fullHash)
+            {
+                return entries[match->Index];
+            }
+
+            return std::nullopt;
+        }
+
+        size_t low = 0;
+        size_t high = entries.size();
+        while (low < high)
+        {
+            const auto middle = low + (high - low) / 2;
+            if (ReadFullHash(middle) < fullHash)
+            {
+                low = middle + 1;
+            }
+            else
+            {
+                high = middle;
+            }
+        }
+
+        if (low < entries.size() && ReadFullHash(low) == fullHash)
+        {
+            return entries[low];
+        }
+
+        return std::nullopt;
+    }
+
+    /**
+     * Finds the entry of an asset by its URI.
+     * @param uri The URI of the asset, which is compared without case, as the
+     * name hash ignores it.
+     * @return The entry, or nothing if the archive does not contain the asset.
+     * @remarks The first call indexes every entry by its name hash, so it is
+     * not safe to call at the same time as the archive is destroyed.
+     */
+    [[nodiscard]] std::optional<Entry> FindUri(const std::string_view uri)
+    {
+        using SQEX::Luminous::AssetManager::LmAssetID;
+        std::call_once(hasNameIndex_, [this] { BuildNameIndex(); });
+
+        const auto nameHash =
+            SQEX::Luminous::Core::Fnv1a64LowerFast(
+                uri, LmAssetID::NAME_HASH_OFFSET_BASIS) &
+            LmAssetID::NAME_HASH_MASK;
+        const auto entries = GetEntries();
+        for (auto match = std::lower_bound(nameIndex_.begin(), nameIndex_.end(),
+                                           IndexEntry{nameHash, 0});
+             match != nameIndex_.end() && match->Hash == nameHash; ++match)
+        {
+            const auto entry = entries[match->Index];
+            if (IsSameUri(GetUri(entry), uri))
+            {
+                return entry;
+            }
+        }
+
+        return std::nullopt;
+    }
+
+    /**
+     * Finds the entry of an asset by its name hash.
+     * @param nameHash The name hash of the asset, as LmAssetID::GetNameHash
+     * computes.
+     * @return The first entry with that name hash, or nothing if the archive
+     * does not contain the asset.
+     * @remarks This is for callers that only have the hash, as URIs that
+     * collide share it, so FindUri should be preferred where the URI is known.
+     * Like FindUri, the first call indexes every entry by its name hash.
+     */
+    [[nodiscard]] std::optional<Entry> FindNameHash(const uint64_t nameHash)
+    {
+        using SQEX::Luminous::AssetManager::LmAssetID;
+        std::call_once(hasNameIndex_, [this] { BuildNameIndex(); });
+
+        const auto key = nameHash & LmAssetID::NAME_HASH_MASK;
+        const auto match = std::lower_bound(
+            nameIndex_.begin(), nameIndex_.end(), IndexEntry{key, 0});
+        if (match != nameIndex_.end() && match->Hash == key)
+        {
+            return GetEntries()[match->Index];
+        }
+
+        return std::nullopt;
+    }
+
+    /**
+     * Gets the bytes of a file as they are stored in the archive, which are
+     * compressed if the entry is.
+     * @param entry The entry of the file.
+     * @return A view of the mapped archive.
+     */
+    [[nodiscard]] std::span<const uint8_t> GetData(const Entry& entry) const
+    {
+        return data_.subspan(entry.DataOffset, entry.ProcessedSize);
+    }
+
+    /**
+     * Gets the URI of a file.
+     * @param entry The entry of the file.
+     * @return A view of the mapped archive.
+     */
+    [[nodiscard]] std::string_view GetUri(const Entry& entry) const
+    {
+        return ReadString(entry.UriOffset);
+    }
+
+    /**
+     * Gets the path of a file relative to the archive.
+     * @param entry The entry of the file.
+     * @return A view of the mapped archive.
+     */
+    [[nodiscard]] std::string_view GetRelativePath(const Entry& entry) const
+    {
+        return ReadString(entry.RelativePathOffset);
+    }
+
+private:
+    /**
+     * Validates the header and every file header, and indexes the entries by
+     * full hash if they are not sorted.
+     */
+    void Open(const std::span<const uint8_t> data)
+    {
+        data_ = data;
+        if (data_.size() < HEADER_SIZE)
+        {
+            throw std::runtime_error("Archive is too small for its header");
+        }
+
+        std::memcpy(&header_, data_.data(), sizeof(header_));
+        if (header_.Tag != MAGIC)
+        {
+            throw std::runtime_error("Archive does not start with CRAF");
+        }
+
+        if ((header_.Version & PROTECTED_VERSION) != 0)
+        {
+            throw std::runtime_error("Protected archives are not supported");
+        }
+
+        const auto tableSize =
+            static_cast<uint64_t>(header_.FileCount) * ENTRY_SIZE;
+        if (header_.FileHeadersOffset > data_.size() ||
+            tableSize > data_.size() - header_.FileHeadersOffset)
+        {
+            throw std::runtime_error("Archive entry table is out of bounds");
+        }
+
+        auto isSorted = true;
+        uint64_t previous = 0;
+        for (size_t i = 0; i < header_.FileCount; i++)
+        {
+            const auto entry = GetEntries()[i];
+            if (entry.DataOffset > data_.size() ||
+                entry.ProcessedSize > data_.size() - entry.DataOffset ||
+                entry.UriOffset >= data_.size() ||
+                entry.RelativePathOffset >= data_.size())
+            {
+                throw std::runtime_error("Archive entry " + std::to_string(i) +
+                                         " is out of bounds");
+            }
+
+            isSorted &= i == 0 || previous <= entry.FullHash;
+            previous = entry.FullHash;
+        }
+
+        if (!isSorted)
+        {
+            hashIndex_.reserve(header_.FileCount);
+            for (uint32_t i = 0; i < header_.FileCount; i++)
+            {
+                hashIndex_.push_back({ReadFullHash(i), i});
+            }
+
+            std::sort(hashIndex_.begin(), hashIndex_.end());
+        }
+    }
+
+    void BuildNameIndex()
+    {
+        using SQEX::Luminous::AssetManager::LmAssetID;
+        nameIndex_.reserve(header_.FileCount);
+        for (uint32_t i = 0; i < header_.FileCount; i++)
+        {
+            nameIndex_.push_back(
+                {ReadFullHash(i) & LmAssetID::NAME_HASH_MASK, i});
+        }
+
+        std::stable_sort(nameIndex_.begin(), nameIndex_.end());
+    }
+
+    static Entry DecodeEntry(const uint8_t* pEntry)
+    {
+        Entry entry;
+        std::memcpy(&entry.FullHash, pEntry, 8);
+        std::memcpy(&entry.Size, pEntry + 0x08, 4);
+        std::memcpy(&entry.ProcessedSize, pEntry + 0x0C, 4);
+        std::memcpy(&entry.Flags, pEntry + 0x10, 4);
+        std::memcpy(&entry.UriOffset, pEntry + 0x14, 4);
+        std::memcpy(&entry.DataOffset, pEntry + 0x18, 8);
+        std::memcpy(&entry.RelativePathOffset, pEntry + 0x20, 4);
+        entry.LocalizationType = pEntry[0x24];
+        entry.Locale = pEntry[0x25];
+        std::memcpy(&entry.Key, pEntry + 0x26, 2);
+        return entry;
+    }
+
+    [[nodiscard]] uint64_t ReadFullHash(const size_t index) const
+    {
+        uint64_t fullHash;
+        std::memcpy(&fullHash,
+                    data_.data() + header_.FileHeadersOffset +
+                        index * ENTRY_SIZE,
+                    sizeof(fullHash));
+        return fullHash;
+    }
+
+    /**
+     * Reads a null-terminated string, stopping at the end of the archive if
+     * it is not terminated.
+     */
+    [[nodiscard]] std::string_view ReadString(const size_t offset) const
+    {
+        const auto start = reinterpret_cast<const char*>(data_.data()) + offset;
+        const auto size = data_.size() - offset;
+        const auto end = static_cast<const char*>(std::memchr(start, 0, size));
+        return {start, end ? static_cast<size_t>(end - start) : size};
+    }
+
+    static bool IsSameUri(const std::string_view left,
+                          const std::string_view right)
+    {
+        using SQEX::Luminous::Core::ToLowerAscii;
+        return left.size() == right.size() &&
+               std::equal(left.begin(), left.end(), right.begin(),
+                          [](const char a, const char b) {
+                              return ToLowerAscii(a) == ToLowerAscii(b);
+                          });
+    }
+};
+
+#endif // EARCARCHIVE_H
@@ -0,0 +1,226 @@
+#ifndef EARCDECOMPRESSOR_H
+#define EARCDECOMPRESSOR_H
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <span>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include <zlib.h>
+
+#include "EarcArchive.h"
+#include "PayloadCache.h"
+
+#include "../Threading/ThreadPool.h"
+
+/**
+ * Inflates the compressed files in EARC archives, one chunk per task.
+ * @remarks A compressed file is a sequence of chunks, each of which starts
+ * with its compressed and decompressed sizes and is followed by a zlib stream,
+ * padded so that the next chunk starts on a 4-byte boundary. Each chunk is an
+ * independent stream, so once the headers have been walked to find where each
+ * chunk starts and where its output goes, every chunk can be inflated straight
+ * into its place in the output on a different thread. The thread pool hands
+ * out chunks from a shared counter, so threads that finish early take the
+ * remaining chunks instead of waiting on the slower ones.
+ */
+class EarcDecompressor
+{
+public:
+    /**
+     * The size of the header at the start of each chunk.
+     */
+    static constexpr size_t CHUNK_HEADER_SIZE = 8;
+
+    /**
+     * The alignment of each chunk within a compressed file.
+     */
+    static constexpr size_t CHUNK_ALIGNMENT = 4;
+
+    /**
+     * Represents one chunk of a compressed file.
+     */
+    struct Chunk
+    {
+        /**
+         * The offset of the zlib stream within the compressed file.
+         */
+        size_t Offset;
+
+        /**
+         * The size of the zlib stream.
+         */
+        uint32_t CompressedSize;
+
+        /**
+         * The offset of the decompressed chunk within the file.
+         */
+        size_t OutputOffset;
+
+        /**
+         * The size of the decompressed chunk.
+         */
+        uint32_t Size;
+    };
+
+    /**
+     * Finds the chunks of a compressed file.
+     * @param payload The file as it is stored in the archive.
+     * @param size The size of the file once decompressed.
+     * @return The chunks, in order.
+     * @exception std::runtime_error Thrown if the chunks overrun the payload
+     * or do not add up to the decompressed size.
+     */
+    static std::vector<Chunk> GetChunks(const std::span<const uint8_t> payload,
+                                        const size_t size)
+    {
+        std::vector<Chunk> chunks;
+        size_t offset = 0;
+        size_t outputOffset = 0;
+        while (outputOffset < size)
+        {
+            if (payload.size() - offset < CHUNK_HEADER_SIZE)
+            {
+                throw std::runtime_error("Compressed file is truncated");
+            }
+
+            Chunk chunk{offset + CHUNK_HEADER_SIZE, 0, outputOffset, 0};
+            std::memcpy(&chunk.CompressedSize, &payload[offset], 4);
+            std::memcpy(&chunk.Size, &payload[offset + 4], 4);
+            if (chunk.CompressedSize > payload.size() - chunk.Offset ||
+                chunk.Size == 0 || chunk.Size > size - outputOffset)
+            {
+                throw std::runtime_error("Compressed chunk " +
+                                         std::to_string(chunks.size()) +
+                                         " is out of bounds");
+            }
+
+            chunks.push_back(chunk);
+            offset = chunk.Offset + chunk.CompressedSize;
+            offset += (CHUNK_ALIGNMENT - offset % CHUNK_ALIGNMENT) %
+                      CHUNK_ALIGNMENT;
+            offset = std::min(offset, payload.size());
+            outputOffset += chunk.Size;
+        }
+
+        return chunks;
+    }
+
+    /**
+     * Inflates a compressed file into a buffer.
+     * @param payload The file as it is stored in the archive.
+     * @param output The buffer to inflate into, which must be at least as
+     * large as the decompressed file.
+     * @param size The size of the file once decompressed.
+     * @param pool The thread pool to inflate chunks on.
+     * @return The decompressed file, at the start of the output.
+     * @exception std::runtime_error Thrown if the file is malformed.
+     */
+    static std::span<uint8_t> Decompress(
+        const std::span<const uint8_t> payload, const std::span<uint8_t> output,
+        const size_t size, ThreadPool& pool = ThreadPool::GetInstance())
+    {
+        if (output.size() < size)
+        {
+            throw std::runtime_error("Output is too small for the file");
+        }
+
+        const auto chunks = GetChunks(payload, size);
+        const auto inflateChunk = [&](const size_t index) {
+            const auto& chunk = chunks[index];
+            auto inflatedSize = static_cast<uLongf>(chunk.Size);
+            if (uncompress(&output[chunk.OutputOffset], &inflatedSize,
+                           &payload[chunk.Offset],
+                           chunk.CompressedSize) != Z_OK ||
+                inflatedSize != chunk.Size)
+            {
+                throw std::runtime_error("Failed to inflate chunk " +
+                                         std::to_string(index));
+            }
+        };
+
+        if (chunks.size() <= 1 || pool.GetThreadCount() == 1)
+        {
+            for (size_t i = 0; i < chunks.size(); i++)
+            {
+                inflateChunk(i);
+            }
+        }
+        else
+        {
+            pool.ParallelFor(chunks.size(), inflateChunk);
+        }
+
+        return output.first(size);
+    }
+
+    /**
+     * Gets the contents of a file in an archive, inflating it if it is
+     * compressed.
+     * @param archive The archive.
+     * @param entry The entry of the file.
+     * @param output The buffer to write the file to, which must be at least
+     * as large as the decompressed file.
+     * @param pool The thread pool to inflate chunks on.
+     * @return The file, at the start of the output.
+     * @exception std::runtime_error Thrown if the file is malformed.
+     */
+    static std::span<uint8_t> Decompress(
+        const EarcArchive& archive, const EarcArchive::Entry& entry,
+        const std::span<uint8_t> output,
+        ThreadPool& pool = ThreadPool::GetInstance())
+    {
+        const auto data = archive.GetData(entry);
+        if (entry.IsCompressed())
+        {
+            return Decompress(data, output, entry.Size, pool);
+        }
+
+        if (output.size() < data.size())
+        {
+            throw std::runtime_error("Output is too small for the file");
+        }
+
+        std::memcpy(output.data(), data.data(), data.size());
+        return output.first(data.size());
+    }
+
+    /**
+     * Gets the contents of a file in an archive, serving compressed files from
+     * a cache where it can and caching those it has to inflate.
+     * @param archive The archive.
+     * @param entry The entry of the file.
+     * @param output The buffer to write the file to, which must be at least
+     * as large as the decompressed file.
+     * @param cache The cache of decompressed files.
+     * @param pool The thread pool to inflate chunks on.
+     * @return The file, at the start of the output.
+     * @exception std::runtime_error Thrown if the file is malformed.
+     * @remarks Files that are not compressed are copied straight from the
+     * mapped archive, so they are not cached.
+     */
+    static std::span<uint8_t> Decompress(
+        const EarcArchive& archive, const EarcArchive::Entry& entry,
+        const std::span<uint8_t> output, PayloadCache& cache,
+        ThreadPool& pool = ThreadPool::GetInstance())
+    {
+        if (!entry.IsCompressed())
+        {
+            return Decompress(archive, entry, output, pool);
+        }
+
+        if (const auto cached = cache.Get(entry.FullHash, output))
+        {
+            return *cached;
+        }
+
+        const auto file = Decompress(archive, entry, output, pool);
+        cache.Put(entry.FullHash, file);
+        return file;
+    }
+};
+
+#endif // EARCDECOMPRESSOR_H
@@ -0,0 +1,159 @@
+#ifndef MAPPEDFILE_H
+#define MAPPEDFILE_H
+
+#include <cstdint>
+#include <filesystem>
+#include <stdexcept>
+#include <string>
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+/**
+ * Maps a file into memory as read-only, so that it can be read without copying
+ * it into a buffer.
+ */
+class MappedFile
+{
+private:
+    const uint8_t* data_{nullptr};
+    size_t size_{0};
+
+#ifdef _WIN32
+    HANDLE hFile_{INVALID_HANDLE_VALUE};
+    HANDLE hMapping_{nullptr};
+#endif
+
+public:
+    /**
+     * Maps a file into memory.
+     * @param path Path to the file to map.
+     * @exception std::runtime_error Thrown if the file could not be mapped.
+     */
+    explicit MappedFile(const std::filesystem::path& path)
+    {
+#ifdef _WIN32
+        hFile_ = CreateFileW(path.c_str(), GENERIC_READ, FILE_SHARE_READ,
+                             nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL,
+                             nullptr);
+        LARGE_INTEGER size;
+        if (hFile_ == INVALID_HANDLE_VALUE || !GetFileSizeEx(hFile_, &size))
+        {
+            Close();
+            throw std::runtime_error("Failed to open " + path.string());
+        }
+
+        size_ = static_cast<size_t>(size.QuadPart);
+        if (size_ == 0)
+        {
+            return;
+        }
+
+        hMapping_ =
+            CreateFileMappingW(hFile_, nullptr, PAGE_READONLY, 0, 0, nullptr);
+        if (hMapping_)
+        {
+            data_ = static_cast<const uint8_t*>(
+                MapViewOfFile(hMapping_, FILE_MAP_READ, 0, 0, 0));
+        }
+#else
+        const auto file = open(path.c_str(), O_RDONLY);
+        struct stat status{};
+        if (file < 0 || fstat(file, &status) != 0)
+        {
+            if (file >= 0)
+            {
+                close(file);
+            }
+
+            throw std::runtime_error("Failed to open " + path.string());
+        }
+
+        size_ = static_cast<size_t>(status.st_size);
+        if (size_ == 0)
+        {
+            close(file);
+            return;
+        }
+
+        // The mapping keeps the file alive, so the descriptor can be closed
+        const auto address =
+            mmap(nullptr, size_, PROT_READ, MAP_PRIVATE, file, 0);
+        close(file);
+        if (address != MAP_FAILED)
+        {
+            data_ = static_cast<const uint8_t*>(address);
+            madvise(address, size_, MADV_WILLNEED);
+        }
+#endif
+
+        if (!data_)
+        {
+            Close();
+            throw std::runtime_error("Failed to map " + path.string());
+        }
+    }
+
+    ~MappedFile()
+    {
+        Close();
+    }
+
+    MappedFile(const MappedFile&) = delete;
+
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    /**
+     * Gets the start of the mapped file.
+     */
+    [[nodiscard]] const uint8_t* GetData() const
+    {
+        return data_;
+    }
+
+    /**
+     * Gets the size of the mapped file, in bytes.
+     */
+    [[nodiscard]] size_t GetSize() const
+    {
+        return size_;
+    }
+
+private:
+    void Close()
+    {
+#ifdef _WIN32
+        if (data_)
+        {
+            UnmapViewOfFile(data_);
+        }
+
+        if (hMapping_)
+        {
+            CloseHandle(hMapping_);
+            hMapping_ = nullptr;
+        }
+
+        if (hFile_ != INVALID_HANDLE_VALUE)
+        {
+            CloseHandle(hFile_);
+            hFile_ = INVALID_HANDLE_VALUE;
+        }
+#else
+        if (data_)
+        {
+            munmap(const_cast<uint8_t*>(data_), size_);
+        }
+#endif
+
+        data_ = nullptr;
+    }
+};
+
+#endif // MAPPEDFILE_H
@@ -0,0 +1,415 @@
+#ifndef PAYLOADCACHE_H
+#define PAYLOADCACHE_H
+
+#include <algorithm>
+#include <bit>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <span>
+#include <stdexcept>
+#include <unordered_map>
+#include <vector>
+
+/**
+ * Keeps the decompressed contents of recently read archive files in memory,
+ * within a fixed number of bytes, so that files that are read again do not
+ * need to be inflated again.
+ * @remarks The cache is split into shards by the full hash of each file,
+ * each with its own lock and an equal share of the budget, so threads
+ * reading different files rarely wait on each other. A file must fit in one
+ * shard, so the cache uses as many shards as it can, up to MAX_SHARD_COUNT,
+ * while each still holds the largest file it is sized for. Each shard stores
+ * its files in an arena of PAGE_SIZE pages that is reserved up front,
+ * chaining the pages of each file, so any free page can be reused and the
+ * cache never fragments or grows past its budget. When a shard runs out of
+ * pages, it evicts files with the CLOCK algorithm: a hand sweeps the files,
+ * sparing and unmarking those that were read since it last passed, and
+ * evicting the first one that was not. Files are keyed by their full hash
+ * alone, so a cache should only hold files from one set of archives, and be
+ * cleared if the set changes. It plugs into EarcDecompressor::Decompress,
+ * which the tools read compressed entries through. The game inflates the
+ * entries it reads itself, so the mod cannot use a cache until it serves
+ * asset overrides.
+ */
+class PayloadCache
+{
+public:
+    /**
+     * The size of each page of the arenas.
+     */
+    static constexpr size_t PAGE_SIZE = 16 << 10;
+
+    /**
+     * The most shards a cache is split into.
+     */
+    static constexpr size_t MAX_SHARD_COUNT = 16;
+
+    /**
+     * The default size of the largest file that a cache must be able to hold.
+     */
+    static constexpr size_t DEFAULT_MAX_FILE_SIZE = 16 << 20;
+
+    /**
+     * Represents how well the cache has performed.
+     */
+    struct Statistics
+    {
+        uint64_t Hits;
+        uint64_t Misses;
+        uint64_t Insertions;
+        uint64_t Evictions;
+
+        /**
+         * The number of decompressed bytes served from the cache instead of
+         * being inflated again.
+         */
+        uint64_t BytesSaved;
+
+        /**
+         * The number of bytes of the files in the cache.
+         */
+        uint64_t BytesCached;
+
+        /**
+         * The number of bytes that the cache may hold.
+         */
+        uint64_t Budget;
+
+        /**
+         * Gets the fraction of reads that were served from the cache.
+         */
+        [[nodiscard]] double GetHitRate() const
+        {
+            const auto reads = Hits + Misses;
+            return reads == 0 ? 0
+                              : static_cast<double>(Hits) /
+                                    static_cast<double>(reads);
+        }
+
+        /**
+         * Gets the number of files evicted for each file inserted.
+         */
+        [[nodiscard]] double GetEvictionRate() const
+        {
+            return Insertions == 0 ? 0
+                                   : static_cast<double>(Evictions) /
+                                         static_cast<double>(Insertions);
+        }
+    };
+
+private:
+    static constexpr uint32_t NO_PAGE = UINT32_MAX;
+
+    /**
+     * Represents a cached file.
+     */
+    struct Entry
+    {
+        uint64_t Hash;
+        uint64_t Size;
+        uint32_t FirstPage;
+        bool IsReferenced;
+        bool IsUsed;
+    };
+
+    /**
+     * Represents a shard, which is only accessed with its mutex held.
+     */
+    struct alignas(64) Shard
+    {
+        std::mutex Mutex;
+        std::unique_ptr<uint8_t[]> Arena;
+        size_t PageCount{0};
+
+        /**
+         * The page that follows each page in its file, or NO_PAGE.
+         */
+        std::vector<uint32_t> NextPages;
+        std::vector<uint32_t> FreePages;
+
+        /**
+         * The slots of the files, which the CLOCK hand sweeps.
+         */
+        std::vector<Entry> Entries;
+        std::vector<uint32_t> FreeEntries;
+        std::unordered_map<uint64_t, uint32_t> Index;
+        size_t Hand{0};
+
+        uint64_t Hits{0};
+        uint64_t Misses{0};
+        uint64_t Insertions{0};
+        uint64_t Evictions{0};
+        uint64_t BytesSaved{0};
+        uint64_t BytesCached{0};
+    };
+
+    std::unique_ptr<Shard[]> shards_;
+    size_t shardCount_;
+    int shardShift_;
+
+public:
+    /**
+     * Reserves a cache.
+     * @param budget The most bytes the cache may hold, which is split evenly
+     * between the shards and rounded down to whole pages.
+     * @param maxFileSize The size of the largest file that the cache must be
+     * able to hold, which decides how many shards it is split into.
+     * @exception std::invalid_argument Thrown if the largest file is empty or
+     * does not fit in the budget.
+     * @remarks The arenas are reserved without being written to, so the
+     * operating system only commits the pages that files are stored in.
+     */
+    explicit PayloadCache(const size_t budget,
+                          const size_t maxFileSize = DEFAULT_MAX_FILE_SIZE)
+    {
+        const auto filePageCount = (maxFileSize + PAGE_SIZE - 1) / PAGE_SIZE;
+        if (filePageCount == 0 || filePageCount > budget / PAGE_SIZE)
+        {
+            throw std::invalid_argument("Largest file does not fit the budget");
+        }
+
+        const auto shardCount = std::bit_floor(std::min(
+            MAX_SHARD_COUNT, budget / PAGE_SIZE / filePageCount));
+        const auto pageCount = budget / shardCount / PAGE_SIZE;
+        if (pageCount >= NO_PAGE)
+        {
+            throw std::invalid_argument("Budget does not fit the shards");
+        }
+
+        shardCount_ = shardCount;
+        shardShift_ = 64 - std::countr_zero(shardCount);
+        shards_ = std::make_unique<Shard[]>(shardCount);
+        for (size_t i = 0; i < shardCount; i++)
+        {
+            auto& shard = shards_[i];
+            shard.Arena = std::make_unique_for_overwrite<uint8_t[]>(
+                pageCount * PAGE_SIZE);
+            shard.PageCount = pageCount;
+            shard.NextPages.assign(pageCount, NO_PAGE);
+
+            // Every file uses at least one page, so there are never more files
+            // than pages
+            shard.Entries.resize(pageCount);
+            shard.Index.reserve(pageCount);
+            for (auto page = static_cast<uint32_t>(pageCount); page > 0; page--)
+            {
+                shard.FreePages.push_back(page - 1);
+                shard.FreeEntries.push_back(page - 1);
+            }
+        }
+    }
+
+    PayloadCache(const PayloadCache&) = delete;
+
+    PayloadCache& operator=(const PayloadCache&) = delete;
+
+    /**
+     * Gets the size of the largest file that the cache can hold, which is at
+     * least the size it was reserved for.
+     */
+    [[nodiscard]] size_t GetMaxFileSize() const
+    {
+        return shards_[0].PageCount * PAGE_SIZE;
+    }
+
+    /**
+     * Copies a cached file into a buffer.
+     * @param fullHash The full hash of the file.
+     * @param output The buffer to copy the file to.
+     * @return The file, at the start of the output, or nothing if it is not
+     * cached or does not fit in the output.
+     */
+    std::optional<std::span<uint8_t>> Get(const uint64_t fullHash,
+                                          const std::span<uint8_t> output)
+    {
+        auto& shard = GetShard(fullHash);
+        std::lock_guard lock(shard.Mutex);
+        const auto match = shard.Index.find(fullHash);
+        if (match == shard.Index.end() ||
+            shard.Entries[match->second].Size > output.size())
+        {
+            shard.Misses++;
+            return std::nullopt;
+        }
+
+        auto& entry = shard.Entries[match->second];
+        entry.IsReferenced = true;
+        size_t offset = 0;
+        for (auto page = entry.FirstPage; page != NO_PAGE;
+             page = shard.NextPages[page])
+        {
+            const auto size = std::min<size_t>(PAGE_SIZE, entry.Size - offset);
+            std::memcpy(&output[offset], &shard.Arena[page * PAGE_SIZE], size);
+            offset += size;
+        }
+
+        shard.Hits++;
+        shard.BytesSaved += entry.Size;
+        return output.first(entry.Size);
+    }
+
+    /**
+     * Copies a file into the cache, evicting others to make room for it.
+     * @param fullHash The full hash of the file.
+     * @param data The decompressed file.
+     * @return True if the file was cached, or false if it is empty or larger
+     * than GetMaxFileSize.
+     * @remarks A file that is already cached is replaced.
+     */
+    bool Put(const uint64_t fullHash, const std::span<const uint8_t> data)
+    {
+        const auto pageCount = (data.size() + PAGE_SIZE - 1) / PAGE_SIZE;
+        auto& shard = GetShard(fullHash);
+        if (data.empty() || pageCount > shard.PageCount)
+        {
+            return false;
+        }
+
+        std::lock_guard lock(shard.Mutex);
+        if (const auto match = shard.Index.find(fullHash);
+            match != shard.Index.end())
+        {
+            Release(shard, match->second);
+        }
+
+        while (shard.FreePages.size() < pageCount)
+        {
+            Evict(shard);
+        }
+
+        // Chain the pages in the order they are filled
+        auto previous = NO_PAGE;
+        auto firstPage = NO_PAGE;
+        for (size_t offset = 0; offset < data.size(); offset += PAGE_SIZE)
+        {
+            const auto page = shard.FreePages.back();
+            shard.FreePages.pop_back();
+            std::memcpy(&shard.Arena[page * PAGE_SIZE], &data[offset],
+                        std::min(PAGE_SIZE, data.size() - offset));
+            shard.NextPages[page] = NO_PAGE;
+            if (previous == NO_PAGE)
+            {
+                firstPage = page;
+            }
+            else
+            {
+                shard.NextPages[previous] = page;
+            }
+
+            previous = page;
+        }
+
+        const auto slot = shard.FreeEntries.back();
+        shard.FreeEntries.pop_back();
+        shard.Entries[slot] = {fullHash, data.size(), firstPage, false, true};
+        shard.Index.emplace(fullHash, slot);
+        shard.Insertions++;
+        shard.BytesCached += data.size();
+        return true;
+    }
+
+    /**
+     * Removes every file from the cache, keeping its statistics.
+     */
+    void Clear()
+    {
+        for (size_t i = 0; i < shardCount_; i++)
+        {
+            auto& shard = shards_[i];
+            std::lock_guard lock(shard.Mutex);
+            for (uint32_t slot = 0; slot < shard.Entries.size(); slot++)
+            {
+                if (shard.Entries[slot].IsUsed)
+                {
+                    Release(shard, slot);
+                }
+            }
+        }
+    }
+
+    /**
+     * Gets how well the cache has performed so far, summed over every shard.
+     */
+    [[nodiscard]] Statistics GetStatistics() const
+    {
+        Statistics statistics{};
+        for (size_t i = 0; i < shardCount_; i++)
+        {
+            auto& shard = shards_[i];
+            std::lock_guard lock(shard.Mutex);
+            statistics.Hits += shard.Hits;
+            statistics.Misses += shard.Misses;
+            statistics.Insertions += shard.Insertions;
+            statistics.Evictions += shard.Evictions;
+            statistics.BytesSaved += shard.BytesSaved;
+            statistics.BytesCached += shard.BytesCached;
+            statistics.Budget += shard.PageCount * PAGE_SIZE;
+        }
+
+        return statistics;
+    }
+
+private:
+    /**
+     * Maps a full hash to its shard, mixing its bits first, as the type hash
+     * in its high bits is shared by every file of the same type.
+     */
+    [[nodiscard]] Shard& GetShard(const uint64_t fullHash) const
+    {
+        if (shardCount_ == 1)
+        {
+            return shards_[0];
+        }
+
+        return shards_[(fullHash * 0x9E3779B97F4A7C15) >> shardShift_];
+    }
+
+    /**
+     * Evicts the first file the hand reaches that has not been read since it
+     * last passed.
+     */
+    static void Evict(Shard& shard)
+    {
+        for (;; shard.Hand = (shard.Hand + 1) % shard.Entries.size())
+        {
+            auto& entry = shard.Entries[shard.Hand];
+            if (!entry.IsUsed)
+            {
+                continue;
+            }
+
+            if (entry.IsReferenced)
+            {
+                entry.IsReferenced = false;
+                continue;
+            }
+
+            Release(shard, static_cast<uint32_t>(shard.Hand));
+            shard.Evictions++;
+            return;
+        }
+    }
+
+    /**
+     * Returns the pages and slot of a file to the shard.
+     */
+    static void Release(Shard& shard, const uint32_t slot)
+    {
+        auto& entry = shard.Entries[slot];
+        for (auto page = entry.FirstPage; page != NO_PAGE;
+             page = shard.NextPages[page])
+        {
+            shard.FreePages.push_back(page);
+        }
+
+        shard.Index.erase(entry.Hash);
+        shard.BytesCached -= entry.Size;
+        entry.IsUsed = false;
+        shard.FreeEntries.push_back(slot);
+    }
+};
+
+#endif // PAYLOADCACHE_H
@@ -3,9 +3,12 @@
 
 #include <csignal>
 #include <iostream>
-#include <windows.h>
 #include <sstream>
 
+#ifdef _WIN32
+#include <windows.h>
+#endif
+
 /**
  * Helper class for handling exceptional events that occur during the operation
  * of Drautos.
@@ -78,10 +81,15 @@ private:
                 stream << message;
             }
 
+#ifdef _WIN32
             // Wait for the user to dismiss the message box before terminating
             MessageBox(nullptr,
                 stream.str().c_str(),
                 "Error", MB_OK);
+#else
+            // There is no message box outside of Windows, such as in tools
+            std::cerr << stream.str() << std::endl;
+#endif
         }
     }
 };
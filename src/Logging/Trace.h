@@ -0,0 +1,274 @@
+#ifndef TRACE_H
+#define TRACE_H
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <memory>
+#include <string>
+
+#ifndef DRAUTOS_TRACE
+#define DRAUTOS_TRACE 0
+#endif
+
+/**
+ * Records how long each phase of startup takes, so that it can be viewed in
+ * chrome://tracing or Perfetto.
+ * @remarks Tracing is enabled by building with the DRAUTOS_TRACE CMake option.
+ * Otherwise TraceScope is empty and every trace point compiles to nothing.
+ * Events are written to a buffer that is allocated up front, and events that
+ * do not fit are dropped rather than allocating while timing.
+ */
+class Trace
+{
+public:
+    /**
+     * Whether trace points record anything in this build.
+     */
+    static constexpr bool IS_ENABLED = DRAUTOS_TRACE != 0;
+
+    /**
+     * The maximum number of events that can be recorded.
+     */
+    static constexpr size_t CAPACITY = 1 << 15;
+
+private:
+    /**
+     * Represents one completed scope.
+     */
+    struct Event
+    {
+        const char* Name;
+        const char* Detail;
+        int64_t Start;
+        int64_t End;
+        uint32_t ThreadId;
+    };
+
+    std::unique_ptr<Event[]> events_;
+    std::atomic<size_t> next_{0};
+    std::atomic<uint32_t> nextThreadId_{0};
+    std::chrono::steady_clock::time_point origin_;
+
+    Trace()
+        : events_(std::make_unique<Event[]>(CAPACITY)),
+          origin_(std::chrono::steady_clock::now())
+    {
+    }
+
+public:
+    static Trace& GetInstance()
+    {
+        static Trace instance;
+        return instance;
+    }
+
+    Trace(const Trace&) = delete;
+
+    Trace& operator=(const Trace&) = delete;
+
+    /**
+     * Gets the current time on the trace clock.
+     * @return Nanoseconds since the trace was created.
+     */
+    [[nodiscard]] int64_t Now() const
+    {
+        return std::chrono::duration_cast<std::chrono::nanoseconds>(
+                   std::chrono::steady_clock::now() - origin_)
+            .count();
+    }
+
+    /**
+     * Records a completed scope.
+     * @param name The name of the scope, which must be a string literal or
+     * otherwise outlive the trace.
+     * @param detail Extra information about the scope, such as the name of the
+     * patch it belongs to, or nullptr. Must also outlive the trace.
+     * @param start The time that the scope started, from Now.
+     * @param end The time that the scope ended, from Now.
+     */
+    void Record(const char* name, const char* detail, const int64_t start,
+                const int64_t end)
+    {
+        const auto index = next_.fetch_add(1, std::memory_order_relaxed);
+        if (index < CAPACITY)
+        {
+            events_[index] = {name, detail, start, end, GetThreadId()};
+        }
+    }
+
+    /**
+     * Gets the number of events that were dropped because the buffer was full.
+     */
+    [[nodiscard]] size_t GetDroppedCount() const
+    {
+        const auto count = next_.load(std::memory_order_relaxed);
+        return count > CAPACITY ? count - CAPACITY : 0;
+    }
+
+    /**
+     * Discards every recorded event.
+     */
+    void Clear()
+    {
+        next_.store(0, std::memory_order_relaxed);
+    }
+
+    /**
+     * Gets the default location of the trace file.
+     * @return %LOCALAPPDATA%/Flagrum/logs/DrautosTrace.json, or an empty path
+     * if the local application data folder is unknown.
+     */
+    static std::filesystem::path GetDefaultPath()
+    {
+        const auto localAppData = std::getenv("LOCALAPPDATA");
+        if (!localAppData || !*localAppData)
+        {
+            return {};
+        }
+
+        return std::filesystem::path(localAppData) / "Flagrum" / "logs" /
+               "DrautosTrace.json";
+    }
+
+    /**
+     * Writes every recorded event as a Chrome trace.
+     * @param path Path to the file to write.
+     * @return True if the file was written.
+     * @remarks This should only be called once no scopes are running, as
+     * events that are still being recorded may be written partially.
+     */
+    bool WriteJson(const std::filesystem::path& path) const
+    {
+        if (path.empty())
+        {
+            return false;
+        }
+
+        std::error_code error;
+        std::filesystem::create_directories(path.parent_path(), error);
+
+        std::ofstream stream(path);
+        stream << "{\"displayTimeUnit\": \"ns\", \"traceEvents\": [";
+
+        const auto count =
+            std::min(next_.load(std::memory_order_acquire), CAPACITY);
+        for (size_t i = 0; i < count; i++)
+        {
+            const auto& event = events_[i];
+            stream << (i == 0 ? "\n" : ",\n") << "  {\"name\": \""
+                   << Escape(event.Name)
+                   << "\", \"cat\": \"drautos\", \"ph\": \"X\", \"pid\": 1"
+                   << ", \"tid\": " << event.ThreadId
+                   << ", \"ts\": " << event.Start / 1000 << "."
+                   << Pad(event.Start % 1000)
+                   << ", \"dur\": " << (event.End - event.Start) / 1000 << "."
+                   << Pad((event.End - event.Start) % 1000);
+            if (event.Detail)
+            {
+                stream << ", \"args\": {\"detail\": \"" << Escape(event.Detail)
+                       << "\"}";
+            }
+
+            stream << "}";
+        }
+
+        stream << "\n]}\n";
+        return static_cast<bool>(stream);
+    }
+
+private:
+    /**
+     * Gets a small number that identifies the calling thread in the trace.
+     */
+    uint32_t GetThreadId()
+    {
+        thread_local const auto id =
+            nextThreadId_.fetch_add(1, std::memory_order_relaxed) + 1;
+        return id;
+    }
+
+    static std::string Pad(const int64_t value)
+    {
+        const auto text = std::to_string(value);
+        return std::string(3 - std::min<size_t>(text.size(), 3), '0') + text;
+    }
+
+    static std::string Escape(const char* text)
+    {
+        std::string escaped;
+        for (; *text; text++)
+        {
+            if (*text == '"' || *text == '\\')
+            {
+                escaped += '\\';
+            }
+
+            if (static_cast<unsigned char>(*text) >= 0x20)
+            {
+                escaped += *text;
+            }
+        }
+
+        return escaped;
+    }
+};
+
+/**
+ * Records the time from its construction to its destruction as a trace event.
+ * @tparam IsEnabled Whether the scope records anything, which defaults to
+ * whether tracing is enabled in this build.
+ * @remarks Declare one as a local variable at the start of the code to time:
+ * @code
+ * const TraceScope scope("PatchManager::ApplyPatches");
+ * @endcode
+ */
+template <bool IsEnabled = Trace::IS_ENABLED> class TraceScope
+{
+private:
+    const char* name_;
+    const char* detail_;
+    int64_t start_;
+
+public:
+    /**
+     * Starts timing a scope.
+     * @param name The name of the scope, usually a string literal.
+     * @param detail Extra information about the scope, or nullptr.
+     */
+    explicit TraceScope(const char* name, const char* detail = nullptr)
+        : name_(name), detail_(detail), start_(Trace::GetInstance().Now())
+    {
+    }
+
+    ~TraceScope()
+    {
+        auto& trace = Trace::GetInstance();
+        trace.Record(name_, detail_, start_, trace.Now());
+    }
+
+    TraceScope(const TraceScope&) = delete;
+
+    TraceScope& operator=(const TraceScope&) = delete;
+};
+
+/**
+ * A scope that records nothing, for builds without tracing.
+ */
+template <> class TraceScope<false>
+{
+public:
+    explicit TraceScope(const char*, const char* = nullptr)
+    {
+    }
+
+    TraceScope(const TraceScope&) = delete;
+
+    TraceScope& operator=(const TraceScope&) = delete;
+};
+
+#endif // TRACE_H
@@ -0,0 +1,225 @@
+#ifndef EXECUTABLEFINGERPRINT_H
+#define EXECUTABLEFINGERPRINT_H
+
+#include <algorithm>
+#include <bit>
+#include <cstdint>
+#include <cstring>
+#include <vector>
+
+#include "PeImage.h"
+
+/**
+ * Identifies a specific build of an executable.
+ * @remarks The header fields are cheap to read but are not guaranteed to
+ * change between builds, so the code sections are hashed as well.
+ */
+struct ExecutableFingerprint
+{
+    /**
+     * The time that the linker created the executable.
+     */
+    uint32_t TimeDateStamp{0};
+
+    /**
+     * The checksum from the optional header.
+     */
+    uint32_t CheckSum{0};
+
+    /**
+     * The size of the executable once loaded, in bytes.
+     */
+    uint32_t SizeOfImage{0};
+
+    /**
+     * A hash of every code section, excluding relocated addresses.
+     */
+    uint64_t CodeHash{0};
+
+    bool operator==(const ExecutableFingerprint&) const = default;
+
+    /**
+     * Computes the fingerprint of an executable.
+     * @param image The executable to fingerprint.
+     * @param excluded RVAs of 8-byte ranges to hash as zeroes, such as code
+     * that has already been detoured.
+     * @return The fingerprint of the executable.
+     * @remarks Addresses that the loader rebases are hashed as zeroes, so the
+     * fingerprint does not change when the executable is loaded at a different
+     * address.
+     */
+    static ExecutableFingerprint Compute(
+        const PeImage& image, const std::vector<uint32_t>& excluded = {})
+    {
+        auto relocations = image.GetRelocations();
+        if (!excluded.empty())
+        {
+            relocations.insert(relocations.end(), excluded.begin(),
+                               excluded.end());
+            std::sort(relocations.begin(), relocations.end());
+        }
+
+        Hasher hasher;
+
+        for (const auto& section : image.GetSections())
+        {
+            if (section.GetClass() != PeImage::CODE)
+            {
+                continue;
+            }
+
+            const auto [start, end] = image.GetSectionData(section);
+            auto next = std::lower_bound(relocations.begin(),
+                                         relocations.end(),
+                                         section.VirtualAddress > 7
+                                             ? section.VirtualAddress - 7
+                                             : 0);
+            const auto size = static_cast<size_t>(end - start);
+
+            for (size_t offset = 0; offset < size;)
+            {
+                const auto blockRva =
+                    section.VirtualAddress + static_cast<uint32_t>(offset);
+
+                // Skip relocations that end before this block
+                while (next != relocations.end() && *next + 8 <= blockRva)
+                {
+                    ++next;
+                }
+
+                // Hash every whole block before the next relocation in place
+                auto clean = size - size % Hasher::BLOCK;
+                if (next != relocations.end() &&
+                    *next < section.VirtualAddress + size)
+                {
+                    const size_t relocated = *next > section.VirtualAddress
+                                                 ? *next - section.VirtualAddress
+                                                 : 0;
+                    clean = std::min(clean, relocated - relocated %
+                                                            Hasher::BLOCK);
+                }
+
+                if (clean > offset)
+                {
+                    hasher.Update(start + offset,
+                                  (clean - offset) / Hasher::BLOCK);
+                    offset = clean;
+                    continue;
+                }
+
+                // The block contains relocated bytes or is the partial block
+                // at the end of the section
+                const auto count = std::min(Hasher::BLOCK, size - offset);
+                uint8_t block[Hasher::BLOCK]{};
+                std::memcpy(block, start + offset, count);
+
+                for (auto relocation = next;
+                     relocation != relocations.end() &&
+                     *relocation < blockRva + count;
+                     ++relocation)
+                {
+                    const auto first = std::max(*relocation, blockRva);
+                    const auto last = std::min<uint64_t>(
+                        *relocation + 8ull, blockRva + count);
+                    std::memset(block + (first - blockRva), 0, last - first);
+                }
+
+                hasher.UpdatePartial(block, count);
+                offset += count;
+            }
+        }
+
+        return {image.GetTimeDateStamp(), image.GetCheckSum(),
+                image.GetSizeOfImage(), hasher.Finish()};
+    }
+
+private:
+    /**
+     * A fast, non-cryptographic 64-bit hash in the style of xxHash64, with
+     * four independent lanes so that hashing is limited by memory bandwidth.
+     */
+    class Hasher
+    {
+    public:
+        static constexpr size_t BLOCK = 32;
+
+    private:
+        static constexpr uint64_t PRIME1 = 0x9E3779B185EBCA87;
+        static constexpr uint64_t PRIME2 = 0xC2B2AE3D27D4EB4F;
+        static constexpr uint64_t PRIME3 = 0x165667B19E3779F9;
+
+        uint64_t lanes_[4]{PRIME1 + PRIME2, PRIME2, 0, 0 - PRIME1};
+        uint64_t length_{0};
+
+        static uint64_t Round(const uint64_t lane, const uint64_t input)
+        {
+            return std::rotl(lane + input * PRIME2, 31) * PRIME1;
+        }
+
+        static uint64_t Load(const uint8_t* address)
+        {
+            uint64_t value;
+            std::memcpy(&value, address, 8);
+            return value;
+        }
+
+    public:
+        /**
+         * Hashes whole blocks.
+         * @param data Start of the blocks.
+         * @param blocks The number of blocks to hash.
+         */
+        void Update(const uint8_t* data, const size_t blocks)
+        {
+            auto lane0 = lanes_[0];
+            auto lane1 = lanes_[1];
+            auto lane2 = lanes_[2];
+            auto lane3 = lanes_[3];
+
+            for (auto block = data; block < data + blocks * BLOCK;
+                 block += BLOCK)
+            {
+                lane0 = Round(lane0, Load(block));
+                lane1 = Round(lane1, Load(block + 8));
+                lane2 = Round(lane2, Load(block + 16));
+                lane3 = Round(lane3, Load(block + 24));
+            }
+
+            lanes_[0] = lane0;
+            lanes_[1] = lane1;
+            lanes_[2] = lane2;
+            lanes_[3] = lane3;
+            length_ += blocks * BLOCK;
+        }
+
+        /**
+         * Hashes a block that may be followed by padding.
+         * @param block The block, padded with zeroes to a whole block.
+         * @param count The number of bytes in the block before the padding.
+         */
+        void UpdatePartial(const uint8_t* block, const size_t count)
+        {
+            Update(block, 1);
+            length_ -= BLOCK - count;
+        }
+
+        [[nodiscard]] uint64_t Finish() const
+        {
+            auto hash = std::rotl(lanes_[0], 1) + std::rotl(lanes_[1], 7) +
+                        std::rotl(lanes_[2], 12) + std::rotl(lanes_[3], 18);
+            for (const auto lane : lanes_)
+            {
+                hash = (hash ^ Round(0, lane)) * PRIME1 + PRIME3;
+            }
+
+            hash ^= length_;
+            hash ^= hash >> 33;
+            hash *= PRIME2;
+            hash ^= hash >> 29;
+            hash *= PRIME3;
+            return hash ^ hash >> 32;
+        }
+    };
+};
+
+#endif // EXECUTABLEFINGERPRINT_H
@@ -1,6 +1,9 @@
 ﻿#ifndef IPATCH_H
 #define IPATCH_H
 
+#include "PeImage.h"
+#include "Signature.h"
+
 namespace Patches
 {
 /**
@@ -28,17 +31,24 @@ public:
 
     /**
      * Gets the byte pattern that this patch will replace.
-     * @return The hexadecimal string representation of the target memory
-     * pattern.
+     * @return The target memory pattern, created with the _sig literal.
      */
-    virtual const char* GetTargetSignature() = 0;
+    virtual SignatureView GetTargetSignature() = 0;
 
     /**
      * Gets the byte pattern that will replace the target signature.
-     * @return The hexadecimal string representation of the patch memory
-     * pattern.
+     * @return The patch memory pattern, created with the _sig literal.
+     */
+    virtual SignatureView GetPatchSignature() = 0;
+
+    /**
+     * Gets the sections of the game executable that the target signature
+     * should be searched for in.
+     * @return The filter that selects the sections to search.
+     * @remarks Narrowing the search avoids scanning sections that the target
+     * cannot be in, and prevents false positives in data sections.
      */
-    virtual const char* GetPatchSignature() = 0;
+    virtual PeSectionFilter GetTargetSection() = 0;
 };
 } // namespace Patches
 
@@ -0,0 +1,245 @@
+#ifndef MEMORYPROTECTION_H
+#define MEMORYPROTECTION_H
+
+#include <algorithm>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <vector>
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
+
+/**
+ * Changes the protection of pages of memory in the current process, so that
+ * code can be written to.
+ * @remarks Backends are selected per platform, and the instance returned by
+ * GetDefault should be used unless a test or benchmark needs to observe the
+ * calls that are made.
+ */
+class MemoryProtection
+{
+public:
+    /**
+     * Represents a range of pages that share the same protection.
+     */
+    struct Region
+    {
+        uint8_t* Start;
+        uint8_t* End;
+        uint32_t Protection;
+    };
+
+    virtual ~MemoryProtection() = default;
+
+    /**
+     * Gets the size of a page of memory.
+     * @return The granularity that protection can be changed at.
+     */
+    [[nodiscard]] virtual size_t GetPageSize() const = 0;
+
+    /**
+     * Gets the protection of every page in a range.
+     * @param start The first byte of the range.
+     * @param end The byte after the end of the range.
+     * @return The regions that overlap the range, in ascending address order.
+     */
+    [[nodiscard]] virtual std::vector<Region> Query(uint8_t* start,
+                                                    uint8_t* end) const = 0;
+
+    /**
+     * Gets the protection that allows a region to be written to, without
+     * removing any access that it already has.
+     * @param protection The current protection of the region.
+     * @return The writable protection, which is equal to the current
+     * protection if the region is already writable.
+     */
+    [[nodiscard]] virtual uint32_t GetWritable(uint32_t protection) const = 0;
+
+    /**
+     * Changes the protection of a range of pages.
+     * @param start The first byte of the range, aligned to a page.
+     * @param size The size of the range in bytes, a multiple of the page size.
+     * @param protection The new protection.
+     * @return True if the protection was changed.
+     */
+    virtual bool Protect(uint8_t* start, size_t size, uint32_t protection) = 0;
+
+    /**
+     * Ensures that the processor does not execute stale code from a range of
+     * memory that has been written to.
+     * @param start The first byte of the range.
+     * @param size The size of the range in bytes.
+     */
+    virtual void FlushInstructionCache(uint8_t* start, size_t size) = 0;
+
+    /**
+     * Gets the backend for the current platform.
+     */
+    static MemoryProtection& GetDefault();
+};
+
+#ifdef _WIN32
+/**
+ * Changes memory protection with VirtualProtect.
+ */
+class WindowsMemoryProtection : public MemoryProtection
+{
+public:
+    [[nodiscard]] size_t GetPageSize() const override
+    {
+        SYSTEM_INFO info;
+        GetSystemInfo(&info);
+        return info.dwPageSize;
+    }
+
+    [[nodiscard]] std::vector<Region> Query(uint8_t* start,
+                                            uint8_t* end) const override
+    {
+        std::vector<Region> regions;
+        auto current = start;
+        while (current < end)
+        {
+            MEMORY_BASIC_INFORMATION memoryInfo;
+            if (!VirtualQuery(current, &memoryInfo, sizeof(memoryInfo)))
+            {
+                break;
+            }
+
+            const auto regionStart =
+                static_cast<uint8_t*>(memoryInfo.BaseAddress);
+            const auto regionEnd = regionStart + memoryInfo.RegionSize;
+            regions.push_back({regionStart, regionEnd, memoryInfo.Protect});
+            current = regionEnd;
+        }
+
+        return regions;
+    }
+
+    [[nodiscard]] uint32_t GetWritable(const uint32_t protection) const override
+    {
+        const auto flags = protection & 0xFF;
+        const auto modifiers = protection & ~0xFFu;
+        switch (flags)
+        {
+        case PAGE_READONLY:
+            return PAGE_READWRITE | modifiers;
+        case PAGE_EXECUTE:
+        case PAGE_EXECUTE_READ:
+            return PAGE_EXECUTE_READWRITE | modifiers;
+        case PAGE_WRITECOPY:
+            return PAGE_READWRITE | modifiers;
+        case PAGE_EXECUTE_WRITECOPY:
+            return PAGE_EXECUTE_READWRITE | modifiers;
+        default:
+            return protection;
+        }
+    }
+
+    bool Protect(uint8_t* start, const size_t size,
+                 const uint32_t protection) override
+    {
+        DWORD oldProtection;
+        return VirtualProtect(start, size, protection, &oldProtection);
+    }
+
+    void FlushInstructionCache(uint8_t* start, const size_t size) override
+    {
+        ::FlushInstructionCache(GetCurrentProcess(), start, size);
+    }
+};
+
+inline MemoryProtection& MemoryProtection::GetDefault()
+{
+    static WindowsMemoryProtection instance;
+    return instance;
+}
+#else
+/**
+ * Changes memory protection with mprotect, reading the current protection of
+ * each mapping from /proc/self/maps.
+ */
+class PosixMemoryProtection : public MemoryProtection
+{
+public:
+    [[nodiscard]] size_t GetPageSize() const override
+    {
+        return static_cast<size_t>(sysconf(_SC_PAGESIZE));
+    }
+
+    [[nodiscard]] std::vector<Region> Query(uint8_t* start,
+                                            uint8_t* end) const override
+    {
+        std::vector<Region> regions;
+        const auto maps = std::fopen("/proc/self/maps", "r");
+        if (!maps)
+        {
+            return regions;
+        }
+
+        // Each line starts with "start-end perms", such as "7f00-7f10 r-xp"
+        unsigned long long mapStart;
+        unsigned long long mapEnd;
+        char permissions[5];
+        char line[512];
+        auto isLineStart = true;
+        while (std::fgets(line, sizeof(line), maps))
+        {
+            // Skip the rest of lines with paths that do not fit in the buffer
+            const auto wasLineStart = isLineStart;
+            isLineStart = std::strchr(line, '\n') != nullptr;
+            if (!wasLineStart ||
+                std::sscanf(line, "%llx-%llx %4s", &mapStart, &mapEnd,
+                            permissions) != 3)
+            {
+                continue;
+            }
+
+            const auto regionStart = reinterpret_cast<uint8_t*>(mapStart);
+            const auto regionEnd = reinterpret_cast<uint8_t*>(mapEnd);
+            if (regionEnd <= start || regionStart >= end)
+            {
+                continue;
+            }
+
+            uint32_t protection = PROT_NONE;
+            protection |= permissions[0] == 'r' ? PROT_READ : 0;
+            protection |= permissions[1] == 'w' ? PROT_WRITE : 0;
+            protection |= permissions[2] == 'x' ? PROT_EXEC : 0;
+            regions.push_back({regionStart, regionEnd, protection});
+        }
+
+        std::fclose(maps);
+        return regions;
+    }
+
+    [[nodiscard]] uint32_t GetWritable(const uint32_t protection) const override
+    {
+        return protection | PROT_READ | PROT_WRITE;
+    }
+
+    bool Protect(uint8_t* start, const size_t size,
+                 const uint32_t protection) override
+    {
+        return mprotect(start, size, static_cast<int>(protection)) == 0;
+    }
+
+    void FlushInstructionCache(uint8_t* start, const size_t size) override
+    {
+        __builtin___clear_cache(reinterpret_cast<char*>(start),
+                                reinterpret_cast<char*>(start + size));
+    }
+};
+
+inline MemoryProtection& MemoryProtection::GetDefault()
+{
+    static PosixMemoryProtection instance;
+    return instance;
+}
+#endif
+
+#endif // MEMORYPROTECTION_H
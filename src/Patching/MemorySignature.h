@@ -1,153 +1,209 @@
 ﻿#ifndef MEMORYSIGNATURE_H
 #define MEMORYSIGNATURE_H
 #include <algorithm>
-#include <array>
-#include <stdexcept>
 #include <vector>
 
+#include "MultiSignatureScanner.h"
+#include "ParallelScanner.h"
+#include "PatchTransaction.h"
+#include "PeImage.h"
+#include "Signature.h"
+#include "SignatureResultCache.h"
+#include "SignatureScanner.h"
+
 #include "../Host.h"
 
 /**
- * Represents one byte in a memory signature.
+ * Represents a contiguous pattern of memory.
  */
-struct MemorySignatureByte
+struct MemorySignature
 {
     /**
-     * If true, overrides Value to match any byte
+     * Instantiates a new MemorySignature from a compile-time signature.
+     * @param signature The byte pattern, usually created with the _sig
+     * literal.
      */
-    bool IsWildcard{false};
+    explicit MemorySignature(const SignatureView& signature)
+        : Signature(signature)
+    {
+    }
 
     /**
-     * The value to match.
+     * The byte pattern that makes up the signature.
      */
-    uint8_t Value{0};
+    SignatureView Signature;
 
-    bool operator==(const uint8_t byte) const
+    /**
+     * Creates a scanner that searches memory for this signature.
+     * @param engine The preferred scanning engine.
+     * @return The scanner for this signature.
+     */
+    [[nodiscard]] SignatureScanner CreateScanner(
+        const SignatureScanner::Engine engine =
+            SignatureScanner::GetBestEngine()) const
     {
-        return IsWildcard || Value == byte;
+        return Signature.CreateScanner(engine);
     }
-};
 
-/**
- * Represents a contiguous pattern of memory.
- */
-struct MemorySignature
-{
-private:
     /**
-     * Parses a hex character.
-     * @param value The character to parse.
-     * @return The byte represented by the hex character.
+     * Gets the committed, accessible memory regions of the host process module.
+     * @param filter The sections of the module to include.
+     * @return The regions in ascending address order.
      */
-    static uint8_t ParseOctet(const char& value)
+    static std::vector<MemoryRegion> GetModuleRegions(
+        const PeSectionFilter& filter = {})
     {
-        // Parse digits
-        if (value >= '0' && value <= '9')
+        std::vector<MemoryRegion> regions;
+
+        // Determine bounds of the module
+        const auto moduleStart = reinterpret_cast<uint8_t*>(Host::hModule);
+        const auto moduleEnd = moduleStart + Host::ModuleSize;
+
+#ifdef _WIN32
+        // Iterate the entire module
+        auto current = moduleStart;
+        while (current < moduleEnd)
         {
-            return value - '0';
+            MEMORY_BASIC_INFORMATION memoryInfo;
+            if (!VirtualQuery(current, &memoryInfo, sizeof(memoryInfo)))
+            {
+                break;
+            }
+
+            // Determine bounds of this memory region
+            const auto start = static_cast<uint8_t*>(memoryInfo.BaseAddress);
+            const auto end = start + memoryInfo.RegionSize;
+            current = end;
+
+            // Skip memory that is not accessible
+            if (memoryInfo.State != MEM_COMMIT ||
+                memoryInfo.Protect & PAGE_GUARD)
+            {
+                continue;
+            }
+
+            regions.push_back({start, end});
         }
+#else
+        // Images mapped by tools are readable in their entirety
+        regions.push_back({moduleStart, moduleEnd});
+#endif
 
-        // Parse uppercase letters
-        if (value >= 'A' && value <= 'F')
+        if (filter == PeSectionFilter{})
         {
-            return 10 + value - 'A';
+            return regions;
         }
 
-        // Parse lowercase letters
-        if (value >= 'a' && value <= 'f')
+        // Only keep the parts of the regions that are in matching sections
+        const PeImage image(moduleStart, Host::ModuleSize, PeImage::MAPPED);
+        std::vector<MemoryRegion> filtered;
+        for (const auto& section : filter.GetRegions(image))
         {
-            return 10 + value - 'a';
+            for (const auto& region : regions)
+            {
+                const auto start = std::max(region.Start, section.Start);
+                const auto end = std::min(region.End, section.End);
+                if (start < end)
+                {
+                    filtered.push_back({start, end});
+                }
+            }
         }
 
-        throw std::invalid_argument("Invalid hex character.");
+        return filtered;
     }
 
-public:
     /**
-     * Instantiates a new MemorySignature from a hexadecimal string.
-     * @param hexString String representation of a hexadecimal memory pattern.
+     * Finds this signature within the host process module.
+     * @param filter The sections of the module to search.
+     * @return List of pointers to the matching signatures.
+     * @remarks The module is scanned on the shared thread pool, which can be
+     * sized with ThreadPool::DefaultThreadCount. If a patching run is in
+     * progress, the cached results are returned instead of scanning the module
+     * again.
      */
-    explicit MemorySignature(const char* hexString)
+    std::vector<uint8_t*> Find(const PeSectionFilter& filter = {})
     {
-        for (auto i = 0; i < strlen(hexString); i += 2)
+        const TraceScope scope("MemorySignature::Find");
+        const auto scanner = CreateScanner();
+        auto& cache = SignatureResultCache::GetInstance();
+        const auto key = SignatureResultCache::CreateKey(scanner, filter);
+        if (const auto cached = cache.Find(key))
         {
-            // Skip whitespace characters
-            if (hexString[i] == ' ')
-            {
-                i -= 1;
-                continue;
-            }
-
-            if (hexString[i] == '?' && hexString[i + 1] == '?')
-            {
-                // Value is a wildcard
-                Signature[Size++].IsWildcard = true;
-            }
-            else
-            {
-                // Value is a hex character
-                Signature[Size++].Value = ParseOctet(hexString[i]) << 4 |
-                                          ParseOctet(hexString[i + 1]);
-            }
+            return *cached;
         }
-    }
 
-    /**
-     * The byte pattern that makes up the signature.
-     */
-    std::array<MemorySignatureByte, 128> Signature;
+        // Search for the signature across the thread pool
+        const auto matches =
+            ParallelScanner().Scan(scanner, GetModuleRegions(filter));
 
-    /**
-     * The size of the signature, in bytes.
-     */
-    size_t Size{0};
+        std::vector<uint8_t*> results;
+        results.reserve(matches.size());
+        for (const auto match : matches)
+        {
+            results.push_back(const_cast<uint8_t*>(match));
+        }
+
+        cache.Store(key, results);
+        return results;
+    }
 
     /**
-     * Finds this signature within the host process module.
-     * @return List of pointers to the matching signatures.
+     * Finds many signatures within the host process module, with a single pass
+     * over the sections searched by each distinct filter.
+     * @param signatures The signatures to find.
+     * @param filters The sections to search for each signature.
+     * @return List of pointers to the matches of each signature, in the same
+     * order as the given signatures.
+     * @remarks If a patching run is in progress, the results are cached so that
+     * calling Find on any of the signatures does not scan the module again.
      */
-    std::vector<uint8_t*> Find()
+    static std::vector<std::vector<uint8_t*>> FindAll(
+        const std::vector<MemorySignature>& signatures,
+        const std::vector<PeSectionFilter>& filters)
     {
-        std::vector<uint8_t*> results;
-
-        // Determine bounds of the module
-        const auto moduleStart = reinterpret_cast<uint8_t*>(Host::hModule);
-        const auto moduleEnd = moduleStart + Host::ModuleSize;
-        auto current = moduleStart;
+        const TraceScope scope("MemorySignature::FindAll");
+        std::vector<std::vector<uint8_t*>> results(signatures.size());
+        std::vector<bool> isFound(signatures.size());
+        auto& cache = SignatureResultCache::GetInstance();
 
-        // Iterate the entire module
-        while (current < moduleEnd)
+        for (size_t i = 0; i < signatures.size(); i++)
         {
-            // Check if the memory is accessible
-            MEMORY_BASIC_INFORMATION memoryInfo;
-            if (!VirtualQuery(current, &memoryInfo, sizeof(memoryInfo)) ||
-                memoryInfo.State != MEM_COMMIT ||
-                memoryInfo.Protect & PAGE_GUARD)
+            if (isFound[i])
             {
                 continue;
             }
 
-            // Determine bounds of this memory region
-            const auto start = static_cast<uint8_t*>(memoryInfo.BaseAddress);
-            const auto end = start + memoryInfo.RegionSize;
+            // Group every signature that searches the same sections
+            MultiSignatureScanner scanner;
+            std::vector<size_t> group;
+            for (auto j = i; j < signatures.size(); j++)
+            {
+                if (!isFound[j] && filters[j] == filters[i])
+                {
+                    scanner.Add(signatures[j].CreateScanner());
+                    group.push_back(j);
+                    isFound[j] = true;
+                }
+            }
 
-            // Search for the signature in the region
-            auto found = std::search(
-                start, end, Signature.begin(),
-                Signature.begin() + Size); // NOLINT(*-narrowing-conversions)
+            // Search for every signature in the group across the thread pool
+            const auto matches =
+                ParallelScanner().Scan(scanner, GetModuleRegions(filters[i]));
 
-            while (found < end && found >= start)
+            for (size_t g = 0; g < group.size(); g++)
             {
-                results.push_back(found);
-                found =
-                    std::search(found + Size, end, Signature.begin(),
-                                Signature.begin() +
-                                    Size); // NOLINT(*-narrowing-conversions)
-            }
+                const auto index = group[g];
+                for (const auto match : matches[g])
+                {
+                    results[index].push_back(const_cast<uint8_t*>(match));
+                }
 
-            // Reset for the next region
-            current = end;
-            memoryInfo = {};
+                cache.Store(
+                    SignatureResultCache::CreateKey(
+                        signatures[index].CreateScanner(), filters[index]),
+                    results[index]);
+            }
         }
 
         return results;
@@ -157,36 +213,31 @@ public:
      * Replaces all occurrences of this byte pattern in the game's memory with
      * the given patch.
      * @param patch The byte pattern to replace this signature with.
+     * @param filter The sections of the module to search.
      * @return The number of matches of this signature that were replaced.
+     * @remarks To apply many patches at once, add them to a single
+     * PatchTransaction instead so the memory protection changes less often.
      */
-    int Replace(const MemorySignature& patch)
+    int Replace(const MemorySignature& patch,
+                const PeSectionFilter& filter = {})
     {
-        const auto matches = Find();
+        const TraceScope scope("MemorySignature::Replace");
+        const auto matches = Find(filter);
 
         if (matches.size() == 0)
         {
             Exception::Fatal("Failed to find memory signature.");
         }
 
+        PatchTransaction transaction;
         for (const auto current : matches)
         {
-            // Make the memory writable
-            DWORD oldProtection;
-            VirtualProtect(current, 128, PAGE_EXECUTE_READWRITE,
-                           &oldProtection);
-
-            // Patch the signature
-            for (auto p = 0; p < patch.Size; p++)
-            {
-                auto [IsWildcard, Value] = patch.Signature[p];
-                if (!IsWildcard)
-                {
-                    current[p] = Value;
-                }
-            }
+            transaction.Add(current, patch.Signature);
+        }
 
-            // Restore the memory protection
-            VirtualProtect(current, 128, oldProtection, &oldProtection);
+        if (!transaction.Commit())
+        {
+            Exception::Fatal("Failed to make memory writable.");
         }
 
         return matches.size();
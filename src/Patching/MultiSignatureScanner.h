@@ -0,0 +1,301 @@
+#ifndef MULTISIGNATURESCANNER_H
+#define MULTISIGNATURESCANNER_H
+
+#include <array>
+#include <cstdint>
+#include <vector>
+
+#include "SignatureScanner.h"
+
+/**
+ * Searches memory for many byte patterns in a single pass.
+ * @remarks Each pattern is anchored on its rarest non-wildcard byte, and the
+ * anchors of every pattern are combined into one shared table. Memory is read
+ * once, and a byte only costs a full pattern comparison when it is the anchor
+ * of at least one pattern. With AVX2, the anchor bytes are grouped into eight
+ * buckets by their low and high nibbles, so 32 bytes can be tested against
+ * every anchor with two shuffles regardless of how many patterns there are.
+ */
+class MultiSignatureScanner
+{
+private:
+    /**
+     * Represents the anchor byte of a single pattern.
+     */
+    struct Anchor
+    {
+        uint32_t Pattern;
+        uint32_t Offset;
+    };
+
+    std::vector<SignatureScanner> scanners_;
+    std::vector<uint32_t> unanchored_;
+
+    /**
+     * Anchors of every pattern, grouped by the value of the anchor byte.
+     */
+    std::vector<Anchor> anchors_;
+
+    /**
+     * Index of the first anchor in anchors_ for each byte value, where the
+     * anchors for a value end at the start of the next value.
+     */
+    std::array<uint32_t, 257> anchorStart_{};
+
+    /**
+     * Bucket bits for each low and high nibble of the anchor bytes.
+     */
+    alignas(16) std::array<uint8_t, 16> lowNibbles_{};
+    alignas(16) std::array<uint8_t, 16> highNibbles_{};
+
+    SignatureScanner::Engine engine_;
+
+public:
+    /**
+     * Instantiates an empty scanner.
+     * @param engine The preferred engine, which will be downgraded if it is
+     * not supported by the current CPU.
+     */
+    explicit MultiSignatureScanner(const SignatureScanner::Engine engine =
+                                       SignatureScanner::GetBestEngine())
+        : engine_(std::min(engine, SignatureScanner::GetBestEngine()))
+    {
+    }
+
+    /**
+     * Adds a pattern to the scanner.
+     * @param scanner The scanner for the pattern to add.
+     * @return The index of the pattern, which identifies its results.
+     */
+    size_t Add(const SignatureScanner& scanner)
+    {
+        const auto index = scanners_.size();
+        scanners_.push_back(scanner);
+        BuildAnchorTable();
+        return index;
+    }
+
+    /**
+     * Gets the number of patterns that have been added.
+     */
+    [[nodiscard]] size_t GetCount() const
+    {
+        return scanners_.size();
+    }
+
+    /**
+     * Gets the size of the largest pattern, in bytes.
+     */
+    [[nodiscard]] size_t GetMaxSize() const
+    {
+        size_t size = 0;
+        for (const auto& scanner : scanners_)
+        {
+            size = std::max(size, scanner.GetSize());
+        }
+
+        return size;
+    }
+
+    /**
+     * Finds every position in the range where each pattern matches, including
+     * matches that overlap each other.
+     * @param start Start of the memory range.
+     * @param end End of the memory range (exclusive).
+     * @param results Lists to append the matches of each pattern to, indexed by
+     * the value returned from Add, in ascending order.
+     */
+    void ScanAll(const uint8_t* start, const uint8_t* end,
+                 std::vector<std::vector<const uint8_t*>>& results) const
+    {
+        results.resize(std::max(results.size(), scanners_.size()));
+
+        // Patterns made entirely of wildcards have nothing to anchor on
+        for (const auto index : unanchored_)
+        {
+            scanners_[index].ScanAll(start, end, results[index]);
+        }
+
+        if (!anchors_.empty() && start < end)
+        {
+#ifdef SIGNATURE_SCANNER_X64
+            if (engine_ == SignatureScanner::AVX2)
+            {
+                ScanAvx2(start, end, results);
+                return;
+            }
+#endif
+
+            ScanScalar(start, start, end, results);
+        }
+    }
+
+    /**
+     * Finds every pattern in the range, skipping matches that overlap a
+     * previous match of the same pattern.
+     * @param start Start of the memory range.
+     * @param end End of the memory range (exclusive).
+     * @param results Lists to append the matches of each pattern to, indexed by
+     * the value returned from Add.
+     * @remarks Produces the same results as calling SignatureScanner::Scan for
+     * each pattern individually.
+     */
+    void Scan(const uint8_t* start, const uint8_t* end,
+              std::vector<std::vector<const uint8_t*>>& results) const
+    {
+        results.resize(std::max(results.size(), scanners_.size()));
+
+        std::vector<size_t> firsts(scanners_.size());
+        for (size_t i = 0; i < scanners_.size(); i++)
+        {
+            firsts[i] = results[i].size();
+        }
+
+        ScanAll(start, end, results);
+
+        for (size_t i = 0; i < scanners_.size(); i++)
+        {
+            SignatureScanner::RemoveOverlaps(results[i], firsts[i],
+                                             scanners_[i].GetSize());
+        }
+    }
+
+    /**
+     * Gets the size of a pattern, in bytes.
+     * @param index The index of the pattern, as returned from Add.
+     */
+    [[nodiscard]] size_t GetSize(const size_t index) const
+    {
+        return scanners_[index].GetSize();
+    }
+
+private:
+    void BuildAnchorTable()
+    {
+        anchors_.clear();
+        unanchored_.clear();
+        anchorStart_.fill(0);
+        lowNibbles_.fill(0);
+        highNibbles_.fill(0);
+
+        // Count the anchors for each byte value
+        for (uint32_t i = 0; i < scanners_.size(); i++)
+        {
+            if (scanners_[i].HasAnchor())
+            {
+                anchorStart_[scanners_[i].GetAnchorValue() + 1]++;
+            }
+            else if (scanners_[i].GetSize() > 0)
+            {
+                unanchored_.push_back(i);
+            }
+        }
+
+        // Assign each distinct anchor byte to a bucket
+        uint32_t distinct = 0;
+        for (size_t value = 0; value < 256; value++)
+        {
+            if (anchorStart_[value + 1] > 0)
+            {
+                const auto bucket = static_cast<uint8_t>(1 << distinct++ % 8);
+                lowNibbles_[value & 0x0F] |= bucket;
+                highNibbles_[value >> 4] |= bucket;
+            }
+
+            anchorStart_[value + 1] += anchorStart_[value];
+        }
+
+        // Group the anchors by byte value
+        anchors_.resize(anchorStart_[256]);
+        auto next = anchorStart_;
+        for (uint32_t i = 0; i < scanners_.size(); i++)
+        {
+            if (scanners_[i].HasAnchor())
+            {
+                const auto offset =
+                    static_cast<uint32_t>(scanners_[i].GetAnchorOffset());
+                anchors_[next[scanners_[i].GetAnchorValue()]++] = {i, offset};
+            }
+        }
+    }
+
+    /**
+     * Verifies every pattern that is anchored on the byte at the position.
+     */
+    void VerifyAnchor(const uint8_t* position, const uint8_t* start,
+                      const uint8_t* end,
+                      std::vector<std::vector<const uint8_t*>>& results) const
+    {
+        const auto value = *position;
+        for (auto i = anchorStart_[value]; i < anchorStart_[value + 1]; i++)
+        {
+            const auto& [pattern, offset] = anchors_[i];
+            if (position - start < static_cast<ptrdiff_t>(offset))
+            {
+                continue;
+            }
+
+            const auto current = position - offset;
+            const auto& scanner = scanners_[pattern];
+            if (end - current >= static_cast<ptrdiff_t>(scanner.GetSize()) &&
+                scanner.Matches(current))
+            {
+                results[pattern].push_back(current);
+            }
+        }
+    }
+
+    void ScanScalar(const uint8_t* current, const uint8_t* start,
+                    const uint8_t* end,
+                    std::vector<std::vector<const uint8_t*>>& results) const
+    {
+        for (; current < end; current++)
+        {
+            if (anchorStart_[*current] != anchorStart_[*current + 1])
+            {
+                VerifyAnchor(current, start, end, results);
+            }
+        }
+    }
+
+#ifdef SIGNATURE_SCANNER_X64
+    SIGNATURE_SCANNER_TARGET_AVX2
+    void ScanAvx2(const uint8_t* start, const uint8_t* end,
+                  std::vector<std::vector<const uint8_t*>>& results) const
+    {
+        constexpr ptrdiff_t width = 32;
+        const auto nibble = _mm256_set1_epi8(0x0F);
+        const auto zero = _mm256_setzero_si256();
+        const auto low = _mm256_broadcastsi128_si256(
+            _mm_load_si128(reinterpret_cast<const __m128i*>(lowNibbles_.data())));
+        const auto high = _mm256_broadcastsi128_si256(_mm_load_si128(
+            reinterpret_cast<const __m128i*>(highNibbles_.data())));
+
+        auto current = start;
+        for (; end - current >= width; current += width)
+        {
+            // A byte may be an anchor if its nibbles share a bucket
+            const auto block =
+                _mm256_loadu_si256(reinterpret_cast<const __m256i*>(current));
+            const auto lowBuckets =
+                _mm256_shuffle_epi8(low, _mm256_and_si256(block, nibble));
+            const auto highBuckets = _mm256_shuffle_epi8(
+                high, _mm256_and_si256(_mm256_srli_epi16(block, 4), nibble));
+            const auto buckets = _mm256_and_si256(lowBuckets, highBuckets);
+            auto candidates = ~static_cast<uint32_t>(
+                _mm256_movemask_epi8(_mm256_cmpeq_epi8(buckets, zero)));
+
+            while (candidates)
+            {
+                VerifyAnchor(current + std::countr_zero(candidates), start,
+                             end, results);
+                candidates &= candidates - 1;
+            }
+        }
+
+        ScanScalar(current, start, end, results);
+    }
+#endif
+};
+
+#endif // MULTISIGNATURESCANNER_H
@@ -0,0 +1,187 @@
+#ifndef PARALLELSCANNER_H
+#define PARALLELSCANNER_H
+
+#include <algorithm>
+#include <cstdint>
+#include <vector>
+
+#include "MultiSignatureScanner.h"
+#include "SignatureScanner.h"
+
+#include "../Logging/Trace.h"
+#include "../Threading/ThreadPool.h"
+
+/**
+ * Splits memory regions into chunks and scans them on a thread pool.
+ * @remarks Each chunk is extended by the pattern size minus one so that
+ * matches straddling a chunk boundary are still found by the chunk they start
+ * in. Chunk results are merged in address order and overlapping matches are
+ * removed per region, so the results are identical to a serial scan.
+ */
+class ParallelScanner
+{
+public:
+    /**
+     * The default number of bytes scanned by each task.
+     */
+    static constexpr size_t DEFAULT_CHUNK_SIZE = 4 * 1024 * 1024;
+
+private:
+    /**
+     * Represents the range of memory that a single task is responsible for.
+     */
+    struct Chunk
+    {
+        size_t Region;
+        const uint8_t* Start;
+        const uint8_t* End;
+    };
+
+    ThreadPool& pool_;
+    size_t chunkSize_;
+
+public:
+    /**
+     * Instantiates a parallel scanner.
+     * @param pool The thread pool to scan on.
+     * @param chunkSize The number of bytes scanned by each task.
+     */
+    explicit ParallelScanner(ThreadPool& pool = ThreadPool::GetInstance(),
+                             const size_t chunkSize = DEFAULT_CHUNK_SIZE)
+        : pool_(pool), chunkSize_(std::max<size_t>(chunkSize, 1))
+    {
+    }
+
+    /**
+     * Finds a pattern in each region, skipping matches that overlap a previous
+     * match in the same region.
+     * @param scanner The scanner for the pattern.
+     * @param regions The regions to search.
+     * @return The matches in ascending address order.
+     */
+    [[nodiscard]] std::vector<const uint8_t*> Scan(
+        const SignatureScanner& scanner,
+        const std::vector<MemoryRegion>& regions) const
+    {
+        const TraceScope scope("ParallelScanner::Scan");
+        const auto chunks = Split(regions);
+        std::vector<std::vector<const uint8_t*>> chunkResults(chunks.size());
+        const auto overlap = scanner.GetSize() - std::min<size_t>(
+                                                     scanner.GetSize(), 1);
+
+        pool_.ParallelFor(chunks.size(), [&](const size_t i) {
+            const auto& [region, start, end] = chunks[i];
+            const auto limit =
+                std::min<size_t>(regions[region].End - end, overlap);
+            scanner.ScanAll(start, end + limit, chunkResults[i]);
+        });
+
+        // Merge the chunks, then remove overlaps within each region
+        std::vector<const uint8_t*> results;
+        size_t first = 0;
+        for (size_t i = 0; i < chunks.size(); i++)
+        {
+            results.insert(results.end(), chunkResults[i].begin(),
+                           chunkResults[i].end());
+
+            if (i + 1 == chunks.size() ||
+                chunks[i + 1].Region != chunks[i].Region)
+            {
+                SignatureScanner::RemoveOverlaps(results, first,
+                                                 scanner.GetSize());
+                first = results.size();
+            }
+        }
+
+        return results;
+    }
+
+    /**
+     * Finds many patterns in each region, skipping matches that overlap a
+     * previous match of the same pattern in the same region.
+     * @param scanner The scanner for the patterns.
+     * @param regions The regions to search.
+     * @return The matches of each pattern in ascending address order, indexed
+     * by the values returned from MultiSignatureScanner::Add.
+     */
+    [[nodiscard]] std::vector<std::vector<const uint8_t*>> Scan(
+        const MultiSignatureScanner& scanner,
+        const std::vector<MemoryRegion>& regions) const
+    {
+        const TraceScope scope("ParallelScanner::Scan", "multiple");
+        const auto chunks = Split(regions);
+        const auto count = scanner.GetCount();
+        std::vector<std::vector<std::vector<const uint8_t*>>> chunkResults(
+            chunks.size());
+        const auto overlap = scanner.GetMaxSize() -
+                             std::min<size_t>(scanner.GetMaxSize(), 1);
+
+        pool_.ParallelFor(chunks.size(), [&](const size_t i) {
+            const auto& [region, start, end] = chunks[i];
+            const auto limit =
+                std::min<size_t>(regions[region].End - end, overlap);
+            auto& results = chunkResults[i];
+            scanner.ScanAll(start, end + limit, results);
+
+            // Matches of shorter patterns in the overlap belong to the next
+            // chunk
+            for (auto& matches : results)
+            {
+                matches.erase(std::lower_bound(matches.begin(),
+                                               matches.end(), end),
+                              matches.end());
+            }
+        });
+
+        // Merge the chunks, then remove overlaps within each region
+        std::vector<std::vector<const uint8_t*>> results(count);
+        std::vector<size_t> firsts(count);
+        for (size_t i = 0; i < chunks.size(); i++)
+        {
+            for (size_t pattern = 0; pattern < chunkResults[i].size();
+                 pattern++)
+            {
+                results[pattern].insert(results[pattern].end(),
+                                        chunkResults[i][pattern].begin(),
+                                        chunkResults[i][pattern].end());
+            }
+
+            if (i + 1 == chunks.size() ||
+                chunks[i + 1].Region != chunks[i].Region)
+            {
+                for (size_t pattern = 0; pattern < count; pattern++)
+                {
+                    SignatureScanner::RemoveOverlaps(results[pattern],
+                                                     firsts[pattern],
+                                                     scanner.GetSize(pattern));
+                    firsts[pattern] = results[pattern].size();
+                }
+            }
+        }
+
+        return results;
+    }
+
+private:
+    [[nodiscard]] std::vector<Chunk> Split(
+        const std::vector<MemoryRegion>& regions) const
+    {
+        std::vector<Chunk> chunks;
+
+        for (size_t i = 0; i < regions.size(); i++)
+        {
+            const auto& [start, end] = regions[i];
+            for (auto current = start; current < end;)
+            {
+                const auto next =
+                    current + std::min<size_t>(end - current, chunkSize_);
+                chunks.push_back({i, current, next});
+                current = next;
+            }
+        }
+
+        return chunks;
+    }
+};
+
+#endif // PARALLELSCANNER_H
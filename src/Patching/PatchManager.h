@@ -4,6 +4,10 @@
 
 #include "IPatch.h"
 #include "MemorySignature.h"
+#include "PatchTransaction.h"
+#include "SignatureResolver.h"
+
+#include "../Logging/Trace.h"
 
 namespace Patches
 {
@@ -46,46 +50,98 @@ public:
         patches_.push_back(new TPatch());
     }
 
+    /**
+     * Gets every registered patch.
+     * @return The patches in the order that they were registered.
+     */
+    [[nodiscard]] const std::vector<IPatch*>& GetPatches() const
+    {
+        return patches_;
+    }
+
     /**
      * Applies all registered patches to the game.
      * @remarks Patches will only be applied if their ShouldApply function
-     * returns true.
+     * returns true. Every target and patch signature is found in a single pass
+     * over the module before any patch is evaluated, and all patches are
+     * evaluated before any of them are applied, so they all see the unmodified
+     * module. The patches are then written in a single PatchTransaction.
+     * Signature locations are cached on disk for each build of the game, so
+     * warm startups only verify the cached locations.
      */
     void ApplyPatches() const
     {
+        const TraceScope scope("PatchManager::ApplyPatches");
+        auto& cache = SignatureResultCache::GetInstance();
+        cache.Begin();
+
+        // Find every signature up front so that no patch has to rescan
+        std::vector<MemorySignature> signatures;
+        std::vector<PeSectionFilter> filters;
+        for (const auto patch : patches_)
+        {
+            signatures.emplace_back(patch->GetTargetSignature());
+            signatures.emplace_back(patch->GetPatchSignature());
+            filters.insert(filters.end(), 2, patch->GetTargetSection());
+        }
+
+        SignatureResolver::Resolve(signatures, filters);
+
+        // Determine which patches need to be applied
+        std::vector<IPatch*> applicable;
         for (const auto patch : patches_)
         {
-            if (patch->ShouldApply())
+            if (ShouldApply(*patch))
             {
                 // Validate expected target count
-                auto expected = patch->GetExpectedTargetCount();
-                if (expected == 0)
+                if (patch->GetExpectedTargetCount() == 0)
                 {
                     Exception::Fatal(
                         "IPatch.GetExpectedTargetCount must not equal 0");
                 }
 
-                // Apply the patch
-                std::string name(typeid(*patch).name());
-                auto target = MemorySignature(patch->GetTargetSignature());
-                const auto replacement =
-                    MemorySignature(patch->GetPatchSignature());
-                const auto actual = target.Replace(replacement);
+                applicable.push_back(patch);
+            }
+        }
 
-                // Ensure the patch was applied as expected
-                if (expected < 1 && actual == 0)
-                {
-                    Exception::Fatal("Failed to apply patch: " +
-                                                  name);
-                }
+        // Collect the writes of every patch so that each page is only made
+        // writable once
+        PatchTransaction transaction;
+        for (const auto patch : applicable)
+        {
+            const auto expected = patch->GetExpectedTargetCount();
+            const std::string name(typeid(*patch).name());
+            const TraceScope patchScope("PatchManager::Find",
+                                        typeid(*patch).name());
+            auto target = MemorySignature(patch->GetTargetSignature());
+            const auto matches = target.Find(patch->GetTargetSection());
 
-                if (actual != expected)
-                {
-                    Exception::Fatal("Failed to apply patch: " +
-                                                  name);
-                }
+            // Ensure the patch will be applied as expected
+            const auto actual = static_cast<int>(matches.size());
+            if (actual == 0 || actual != expected)
+            {
+                Exception::Fatal("Failed to apply patch: " + name);
+            }
+
+            for (const auto match : matches)
+            {
+                transaction.Add(match, patch->GetPatchSignature());
             }
         }
+
+        if (!transaction.Commit())
+        {
+            Exception::Fatal("Failed to make memory writable for patches");
+        }
+
+        cache.End();
+    }
+
+private:
+    static bool ShouldApply(IPatch& patch)
+    {
+        const TraceScope scope("IPatch::ShouldApply", typeid(patch).name());
+        return patch.ShouldApply();
     }
 };
 } // namespace Patches
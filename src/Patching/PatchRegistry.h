@@ -0,0 +1,31 @@
+#ifndef PATCHREGISTRY_H
+#define PATCHREGISTRY_H
+
+#include "PatchManager.h"
+#include "Patches/AnselPatch.h"
+#include "Patches/TwitchPrimePatch.h"
+
+namespace Patches
+{
+/**
+ * Lists every patch that Drautos can apply to the game, so that the DLL and
+ * the offline tools always work with the same set of patches.
+ */
+class PatchRegistry
+{
+public:
+    PatchRegistry() = delete;
+
+    /**
+     * Registers every patch with the patch manager.
+     * @param patchManager The patch manager to register the patches with.
+     */
+    static void RegisterAll(PatchManager& patchManager)
+    {
+        patchManager.Register<AnselPatch>();
+        patchManager.Register<TwitchPrimePatch>();
+    }
+};
+} // namespace Patches
+
+#endif // PATCHREGISTRY_H
@@ -0,0 +1,213 @@
+#ifndef PATCHTRANSACTION_H
+#define PATCHTRANSACTION_H
+
+#include <algorithm>
+#include <cstdint>
+#include <vector>
+
+#include "MemoryProtection.h"
+#include "Signature.h"
+
+#include "../Logging/Trace.h"
+
+/**
+ * Collects writes to code and applies them together, so that the protection of
+ * each page only changes once no matter how many writes it receives.
+ * @remarks Writes are coalesced into ranges of whole pages. Each range that is
+ * not already writable is made writable once, every write is made, the
+ * original protection is restored, and the instruction cache is flushed once
+ * over everything that was written.
+ */
+class PatchTransaction
+{
+public:
+    /**
+     * Represents the work done by a committed transaction.
+     */
+    struct Statistics
+    {
+        size_t Writes;
+        size_t Ranges;
+        size_t ProtectionChanges;
+    };
+
+private:
+    /**
+     * Represents a pending write of a patch to an address.
+     */
+    struct Write
+    {
+        uint8_t* Address;
+        SignatureView Patch;
+    };
+
+    MemoryProtection& protection_;
+    std::vector<Write> writes_;
+    Statistics statistics_{};
+
+public:
+    /**
+     * Instantiates an empty transaction.
+     * @param protection The backend used to change memory protection.
+     */
+    explicit PatchTransaction(
+        MemoryProtection& protection = MemoryProtection::GetDefault())
+        : protection_(protection)
+    {
+    }
+
+    PatchTransaction(const PatchTransaction&) = delete;
+
+    PatchTransaction& operator=(const PatchTransaction&) = delete;
+
+    /**
+     * Adds a write to the transaction.
+     * @param address The address to write the patch to.
+     * @param patch The bytes to write. Wildcard bytes are left unchanged. The
+     * pattern must outlive the transaction.
+     */
+    void Add(uint8_t* address, const SignatureView& patch)
+    {
+        if (patch.GetSize() > 0)
+        {
+            writes_.push_back({address, patch});
+        }
+    }
+
+    /**
+     * Gets the number of writes that have been added.
+     */
+    [[nodiscard]] size_t GetSize() const
+    {
+        return writes_.size();
+    }
+
+    /**
+     * Gets the work done by the last call to Commit.
+     */
+    [[nodiscard]] const Statistics& GetStatistics() const
+    {
+        return statistics_;
+    }
+
+    /**
+     * Applies every write that has been added, then empties the transaction.
+     * @return True if every write was applied. If the protection of any range
+     * cannot be changed, nothing is written.
+     */
+    bool Commit()
+    {
+        const TraceScope scope("PatchTransaction::Commit");
+        statistics_ = {writes_.size(), 0, 0};
+        if (writes_.empty())
+        {
+            return true;
+        }
+
+        std::sort(writes_.begin(), writes_.end(),
+                  [](const Write& a, const Write& b) {
+                      return a.Address < b.Address;
+                  });
+
+        // Coalesce the writes into ranges of whole pages
+        const auto pageSize = protection_.GetPageSize();
+        const auto alignDown = [&](const uint8_t* address) {
+            const auto value = reinterpret_cast<uintptr_t>(address);
+            return reinterpret_cast<uint8_t*>(value - value % pageSize);
+        };
+
+        std::vector<std::pair<uint8_t*, uint8_t*>> ranges;
+        for (const auto& write : writes_)
+        {
+            const auto start = alignDown(write.Address);
+            const auto end =
+                alignDown(write.Address + write.Patch.GetSize() - 1) + pageSize;
+            if (!ranges.empty() && start <= ranges.back().second)
+            {
+                ranges.back().second = std::max(ranges.back().second, end);
+            }
+            else
+            {
+                ranges.emplace_back(start, end);
+            }
+        }
+
+        statistics_.Ranges = ranges.size();
+
+        // Make every range writable, splitting it where its protection changes
+        const auto regions =
+            protection_.Query(ranges.front().first, ranges.back().second);
+        std::vector<MemoryProtection::Region> changed;
+        auto isWritable = true;
+        for (const auto& [start, end] : ranges)
+        {
+            for (const auto& region : regions)
+            {
+                const auto changeStart = std::max(start, region.Start);
+                const auto changeEnd = std::min(end, region.End);
+                const auto writable =
+                    protection_.GetWritable(region.Protection);
+                if (changeStart >= changeEnd || writable == region.Protection)
+                {
+                    continue;
+                }
+
+                if (!protection_.Protect(changeStart, changeEnd - changeStart,
+                                         writable))
+                {
+                    isWritable = false;
+                    break;
+                }
+
+                changed.push_back({changeStart, changeEnd, region.Protection});
+            }
+
+            if (!isWritable)
+            {
+                break;
+            }
+        }
+
+        if (isWritable)
+        {
+            for (const auto& write : writes_)
+            {
+                const auto values = write.Patch.GetValues();
+                const auto masks = write.Patch.GetMasks();
+                for (size_t i = 0; i < write.Patch.GetSize(); i++)
+                {
+                    if (masks[i])
+                    {
+                        write.Address[i] = values[i];
+                    }
+                }
+            }
+        }
+
+        // Restore the original protection
+        for (const auto& region : changed)
+        {
+            protection_.Protect(region.Start, region.End - region.Start,
+                                region.Protection);
+        }
+
+        statistics_.ProtectionChanges = changed.size() * 2;
+
+        if (isWritable)
+        {
+            const auto start = writes_.front().Address;
+            auto end = start;
+            for (const auto& write : writes_)
+            {
+                end = std::max(end, write.Address + write.Patch.GetSize());
+            }
+
+            protection_.FlushInstructionCache(start, end - start);
+        }
+
+        writes_.clear();
+        return isWritable;
+    }
+};
+
+#endif // PATCHTRANSACTION_H
@@ -25,12 +25,12 @@ public:
 
             // Check if the target signature exists
             auto target = MemorySignature(GetTargetSignature());
-            const auto matches = target.Find();
+            const auto matches = target.Find(GetTargetSection());
             if (matches.empty())
             {
                 // Target signature does not exist, check if already patched
                 auto patch = MemorySignature(GetPatchSignature());
-                const auto patchMatches = patch.Find();
+                const auto patchMatches = patch.Find(GetTargetSection());
                 if (patchMatches.empty())
                 {
                     // Patch is not present, this is an error
@@ -54,6 +54,11 @@ public:
         return 1;
     }
 
+    PeSectionFilter GetTargetSection() override
+    {
+        return {PeImage::CODE};
+    }
+
     /**
      * Targets the following pattern:
      * @code
@@ -64,9 +69,10 @@ public:
      * @remarks This will only jump to the Ansel session startup if the
      * condition is met as determined by the second two lines.
      */
-    const char* GetTargetSignature() override
+    SignatureView GetTargetSignature() override
     {
-        return "72 ?? 80 7C 24 48 00 75";
+        static constexpr auto signature = "72 ?? 80 7C 24 48 00 75"_sig;
+        return signature;
     }
 
     /**
@@ -79,9 +85,10 @@ public:
      * @remarks This removes the condition from the jump, so the Ansel session
      * will always start.
      */
-    const char* GetPatchSignature() override
+    SignatureView GetPatchSignature() override
     {
-        return "72 ?? 80 7C 24 48 00 EB";
+        static constexpr auto signature = "72 ?? 80 7C 24 48 00 EB"_sig;
+        return signature;
     }
 };
 } // namespace Patches
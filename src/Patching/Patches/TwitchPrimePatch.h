@@ -34,6 +34,11 @@ public:
         return 1;
     }
 
+    PeSectionFilter GetTargetSection() override
+    {
+        return {PeImage::CODE};
+    }
+
     /**
      * Targets the following pattern:
      * @code
@@ -45,9 +50,11 @@ public:
      * given boolean (char) value (r8b). This is separate to UnlockDlcHook as it
      * runs separately after the function that that hooks.
      */
-    const char* GetTargetSignature() override
+    SignatureView GetTargetSignature() override
     {
-        return "48 63 C2 44 88 84 08 10 ?? ?? ?? C3";
+        static constexpr auto signature =
+            "48 63 C2 44 88 84 08 10 ?? ?? ?? C3"_sig;
+        return signature;
     }
 
     /**
@@ -60,9 +67,11 @@ public:
      * @remarks This is setting the value to 1 instead of the parameter at r8b.
      *          Essentially, this means the DLC will always be enabled.
      */
-    const char* GetPatchSignature() override
+    SignatureView GetPatchSignature() override
     {
-        return "48 63 C2 C6 84 08 10 01 00 00 01 C3";
+        static constexpr auto signature =
+            "48 63 C2 C6 84 08 10 01 00 00 01 C3"_sig;
+        return signature;
     }
 };
 } // namespace Patches
@@ -0,0 +1,449 @@
+#ifndef PEIMAGE_H
+#define PEIMAGE_H
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "SignatureScanner.h"
+
+/**
+ * Reads the headers and section table of a portable executable (PE) image.
+ * @remarks Does not depend on any Windows headers, so it can read an image
+ * that has been loaded by Windows as well as an executable mapped from disk on
+ * any platform.
+ */
+class PeImage
+{
+public:
+    /**
+     * Represents how the image is laid out in memory.
+     */
+    enum Layout : uint8_t
+    {
+        MAPPED, /**< Sections are at their RVAs, as loaded by Windows. */
+        FILE    /**< Sections are at their raw file offsets. */
+    };
+
+    /**
+     * Represents the kind of content that a section holds.
+     */
+    enum SectionClass : uint8_t
+    {
+        ANY,            /**< Matches every section. */
+        CODE,           /**< Executable code, such as .text. */
+        READ_ONLY_DATA, /**< Read-only data, such as .rdata. */
+        WRITABLE_DATA   /**< Writable data, such as .data. */
+    };
+
+    /**
+     * Represents a single entry in the section table.
+     */
+    struct Section
+    {
+        /**
+         * The name of the section, such as .text.
+         */
+        std::string Name;
+
+        /**
+         * The RVA of the start of the section.
+         */
+        uint32_t VirtualAddress;
+
+        /**
+         * The size of the section once loaded, in bytes.
+         */
+        uint32_t VirtualSize;
+
+        /**
+         * The file offset of the start of the section.
+         */
+        uint32_t PointerToRawData;
+
+        /**
+         * The size of the section in the file, in bytes.
+         */
+        uint32_t SizeOfRawData;
+
+        /**
+         * The IMAGE_SCN_* flags of the section.
+         */
+        uint32_t Characteristics;
+
+        /**
+         * Gets the kind of content that the section holds.
+         * @return The class of the section, which is never ANY.
+         */
+        [[nodiscard]] SectionClass GetClass() const
+        {
+            if (Characteristics & (SCN_MEM_EXECUTE | SCN_CNT_CODE))
+            {
+                return CODE;
+            }
+
+            return Characteristics & SCN_MEM_WRITE ? WRITABLE_DATA
+                                                   : READ_ONLY_DATA;
+        }
+    };
+
+    static constexpr uint32_t SCN_CNT_CODE = 0x00000020;
+    static constexpr uint32_t SCN_MEM_DISCARDABLE = 0x02000000;
+    static constexpr uint32_t SCN_MEM_EXECUTE = 0x20000000;
+    static constexpr uint32_t SCN_MEM_READ = 0x40000000;
+    static constexpr uint32_t SCN_MEM_WRITE = 0x80000000;
+
+private:
+    const uint8_t* data_;
+    size_t size_;
+    Layout layout_;
+    uint32_t timeDateStamp_{0};
+    uint32_t checkSum_{0};
+    uint32_t sizeOfImage_{0};
+    uint64_t imageBase_{0};
+    uint32_t relocationsRva_{0};
+    uint32_t relocationsSize_{0};
+    std::vector<Section> sections_;
+
+public:
+    /**
+     * Reads the headers of a PE image.
+     * @param data Start of the image.
+     * @param size Size of the image, in bytes.
+     * @param layout How the image is laid out in memory.
+     * @exception std::invalid_argument Thrown if the headers are malformed.
+     */
+    PeImage(const uint8_t* data, const size_t size, const Layout layout)
+        : data_(data), size_(size), layout_(layout)
+    {
+        if (Read<uint16_t>(0) != 0x5A4D)
+        {
+            throw std::invalid_argument("Image is missing the MZ signature.");
+        }
+
+        const auto ntHeaders = Read<uint32_t>(0x3C);
+        if (Read<uint32_t>(ntHeaders) != 0x00004550)
+        {
+            throw std::invalid_argument("Image is missing the PE signature.");
+        }
+
+        // Read the COFF file header
+        const auto fileHeader = ntHeaders + 4;
+        const auto sectionCount = Read<uint16_t>(fileHeader + 2);
+        timeDateStamp_ = Read<uint32_t>(fileHeader + 4);
+        const auto optionalHeaderSize = Read<uint16_t>(fileHeader + 16);
+
+        // Read the optional header, which differs between PE32 and PE32+
+        const auto optionalHeader = fileHeader + 20;
+        const auto magic = Read<uint16_t>(optionalHeader);
+        size_t dataDirectories;
+        if (magic == 0x20B)
+        {
+            imageBase_ = Read<uint64_t>(optionalHeader + 24);
+            dataDirectories = optionalHeader + 108;
+        }
+        else if (magic == 0x10B)
+        {
+            imageBase_ = Read<uint32_t>(optionalHeader + 28);
+            dataDirectories = optionalHeader + 92;
+        }
+        else
+        {
+            throw std::invalid_argument("Image has an unknown optional header.");
+        }
+
+        sizeOfImage_ = Read<uint32_t>(optionalHeader + 56);
+        checkSum_ = Read<uint32_t>(optionalHeader + 64);
+
+        // Locate the base relocation directory, which is the sixth entry
+        if (Read<uint32_t>(dataDirectories) > 5)
+        {
+            relocationsRva_ = Read<uint32_t>(dataDirectories + 4 + 5 * 8);
+            relocationsSize_ = Read<uint32_t>(dataDirectories + 8 + 5 * 8);
+        }
+
+        // Read the section table
+        const auto sectionTable = optionalHeader + optionalHeaderSize;
+        for (size_t i = 0; i < sectionCount; i++)
+        {
+            const auto header = sectionTable + i * 40;
+            char name[9]{};
+            std::memcpy(name, Bounds(header, 8), 8);
+
+            sections_.push_back({name, Read<uint32_t>(header + 12),
+                                 Read<uint32_t>(header + 8),
+                                 Read<uint32_t>(header + 20),
+                                 Read<uint32_t>(header + 16),
+                                 Read<uint32_t>(header + 36)});
+        }
+    }
+
+    /**
+     * Gets the time that the linker created the image, as a Unix timestamp.
+     */
+    [[nodiscard]] uint32_t GetTimeDateStamp() const
+    {
+        return timeDateStamp_;
+    }
+
+    /**
+     * Gets the checksum of the image, which may be 0 if it was not computed.
+     */
+    [[nodiscard]] uint32_t GetCheckSum() const
+    {
+        return checkSum_;
+    }
+
+    /**
+     * Gets the size of the image once loaded, in bytes.
+     */
+    [[nodiscard]] uint32_t GetSizeOfImage() const
+    {
+        return sizeOfImage_;
+    }
+
+    /**
+     * Gets the preferred base address of the image.
+     */
+    [[nodiscard]] uint64_t GetImageBase() const
+    {
+        return imageBase_;
+    }
+
+    /**
+     * Gets the section table of the image.
+     */
+    [[nodiscard]] const std::vector<Section>& GetSections() const
+    {
+        return sections_;
+    }
+
+    /**
+     * Finds a section by name.
+     * @param name The name of the section, such as .text.
+     * @return The first section with the name, or nullptr if there is none.
+     */
+    [[nodiscard]] const Section* FindSection(const std::string_view name) const
+    {
+        const auto section =
+            std::find_if(sections_.begin(), sections_.end(),
+                         [&](const Section& s) { return s.Name == name; });
+        return section == sections_.end() ? nullptr : &*section;
+    }
+
+    /**
+     * Gets the memory that holds the contents of a section.
+     * @param section The section to get the contents of.
+     * @return The range of the section within the image, which is empty if the
+     * section has no contents in this layout.
+     */
+    [[nodiscard]] MemoryRegion GetSectionData(const Section& section) const
+    {
+        size_t offset;
+        size_t size;
+        if (layout_ == MAPPED)
+        {
+            offset = section.VirtualAddress;
+            size = section.VirtualSize ? section.VirtualSize
+                                       : section.SizeOfRawData;
+        }
+        else
+        {
+            offset = section.PointerToRawData;
+            size = section.VirtualSize ? std::min(section.VirtualSize,
+                                                  section.SizeOfRawData)
+                                       : section.SizeOfRawData;
+        }
+
+        offset = std::min(offset, size_);
+        size = std::min(size, size_ - offset);
+        return {data_ + offset, data_ + offset + size};
+    }
+
+    /**
+     * Gets the RVAs of every 64-bit address that the loader rebases when the
+     * image is not loaded at its preferred base address.
+     * @return The RVAs of the relocated addresses, in ascending order.
+     */
+    [[nodiscard]] std::vector<uint32_t> GetRelocations() const
+    {
+        constexpr uint16_t IMAGE_REL_BASED_DIR64 = 10;
+        std::vector<uint32_t> relocations;
+
+        // The directory must be backed by contiguous memory in the image
+        const auto directory = FromRva(relocationsRva_);
+        if (!directory || relocationsSize_ == 0 ||
+            FromRva(relocationsRva_ + relocationsSize_ - 1) !=
+                directory + relocationsSize_ - 1)
+        {
+            return relocations;
+        }
+
+        for (uint32_t offset = 0; relocationsSize_ - offset >= 8;)
+        {
+            // Each block covers one page and is followed by its entries
+            uint32_t pageRva;
+            uint32_t blockSize;
+            std::memcpy(&pageRva, directory + offset, 4);
+            std::memcpy(&blockSize, directory + offset + 4, 4);
+            if (blockSize < 8 || blockSize > relocationsSize_ - offset)
+            {
+                break;
+            }
+
+            for (uint32_t i = 8; i + 2 <= blockSize; i += 2)
+            {
+                uint16_t entry;
+                std::memcpy(&entry, directory + offset + i, 2);
+                if (entry >> 12 == IMAGE_REL_BASED_DIR64)
+                {
+                    relocations.push_back(pageRva + (entry & 0x0FFF));
+                }
+            }
+
+            offset += blockSize;
+        }
+
+        std::sort(relocations.begin(), relocations.end());
+        return relocations;
+    }
+
+    /**
+     * Converts an address within the image to an RVA.
+     * @param address The address to convert.
+     * @return The RVA, or 0 if the address is not within a section.
+     */
+    [[nodiscard]] uint32_t ToRva(const uint8_t* address) const
+    {
+        if (layout_ == MAPPED)
+        {
+            return static_cast<uint32_t>(address - data_);
+        }
+
+        for (const auto& section : sections_)
+        {
+            const auto [start, end] = GetSectionData(section);
+            if (address >= start && address < end)
+            {
+                return section.VirtualAddress +
+                       static_cast<uint32_t>(address - start);
+            }
+        }
+
+        return 0;
+    }
+
+    /**
+     * Converts an RVA to an address within the image.
+     * @param rva The RVA to convert.
+     * @return The address, or nullptr if the RVA is not backed by the image.
+     */
+    [[nodiscard]] const uint8_t* FromRva(const uint32_t rva) const
+    {
+        if (layout_ == MAPPED)
+        {
+            return rva < size_ ? data_ + rva : nullptr;
+        }
+
+        for (const auto& section : sections_)
+        {
+            const auto [start, end] = GetSectionData(section);
+            if (rva >= section.VirtualAddress &&
+                rva - section.VirtualAddress <
+                    static_cast<size_t>(end - start))
+            {
+                return start + (rva - section.VirtualAddress);
+            }
+        }
+
+        return nullptr;
+    }
+
+private:
+    [[nodiscard]] const uint8_t* Bounds(const size_t offset,
+                                        const size_t size) const
+    {
+        if (offset > size_ || size > size_ - offset)
+        {
+            throw std::invalid_argument("Image headers are truncated.");
+        }
+
+        return data_ + offset;
+    }
+
+    template <typename T> [[nodiscard]] T Read(const size_t offset) const
+    {
+        T value;
+        std::memcpy(&value, Bounds(offset, sizeof(T)), sizeof(T));
+        return value;
+    }
+};
+
+/**
+ * Selects which sections of a PE image are searched for a signature.
+ */
+struct PeSectionFilter
+{
+    /**
+     * The class of section to search.
+     */
+    PeImage::SectionClass Class{PeImage::ANY};
+
+    /**
+     * The name of the section to search, or empty to search any name.
+     */
+    std::string_view Name{};
+
+    /**
+     * Whether the section should be searched.
+     * @param section The section to check.
+     * @return True if the section has the class and name of this filter.
+     * @remarks Discardable sections, such as relocations, are only matched by
+     * name or when searching any class.
+     */
+    [[nodiscard]] bool Matches(const PeImage::Section& section) const
+    {
+        if (!Name.empty())
+        {
+            return section.Name == Name &&
+                   (Class == PeImage::ANY || section.GetClass() == Class);
+        }
+
+        if (Class == PeImage::ANY)
+        {
+            return true;
+        }
+
+        return section.GetClass() == Class &&
+               !(section.Characteristics & PeImage::SCN_MEM_DISCARDABLE);
+    }
+
+    /**
+     * Gets the ranges of the image that should be searched.
+     * @param image The image to search.
+     * @return The contents of every matching section, in section table order.
+     */
+    [[nodiscard]] std::vector<MemoryRegion> GetRegions(
+        const PeImage& image) const
+    {
+        std::vector<MemoryRegion> regions;
+        for (const auto& section : image.GetSections())
+        {
+            const auto region = image.GetSectionData(section);
+            if (Matches(section) && region.Start < region.End)
+            {
+                regions.push_back(region);
+            }
+        }
+
+        return regions;
+    }
+
+    bool operator==(const PeSectionFilter&) const = default;
+};
+
+#endif // PEIMAGE_H
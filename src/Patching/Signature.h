@@ -0,0 +1,223 @@
+#ifndef SIGNATURE_H
+#define SIGNATURE_H
+
+#include <array>
+#include <cstdint>
+#include <stdexcept>
+
+#include "SignatureScanner.h"
+
+#include "../Logging/Trace.h"
+
+/**
+ * A byte pattern with a value and mask per byte, sized exactly to the pattern.
+ * @tparam Size The size of the pattern, in bytes.
+ * @remarks Created at compile time with the _sig literal.
+ */
+template <size_t Size> struct PackedSignature
+{
+    static_assert(Size > 0 && Size <= SignatureScanner::MAX_SIZE,
+                  "Signatures must be between 1 and 128 bytes long.");
+
+    /**
+     * The value of each byte in the pattern, with wildcards zeroed.
+     */
+    std::array<uint8_t, Size> Values{};
+
+    /**
+     * The mask of each byte in the pattern, where 0xFF must match exactly and
+     * 0x00 matches any byte.
+     */
+    std::array<uint8_t, Size> Masks{};
+};
+
+/**
+ * Refers to a signature of any size, along with the comparison that was
+ * specialized for its size at compile time.
+ * @remarks Does not own the pattern, so the signature it refers to must
+ * outlive it. Signatures created with the _sig literal are usually stored in
+ * static constexpr variables for this reason.
+ */
+class SignatureView
+{
+private:
+    const uint8_t* values_{nullptr};
+    const uint8_t* masks_{nullptr};
+    size_t size_{0};
+    SignatureScanner::MatchFunction matches_{&SignatureScanner::MatchesAny};
+
+public:
+    constexpr SignatureView() = default;
+
+    template <size_t Size>
+    constexpr SignatureView(const PackedSignature<Size>& signature)
+        : values_(signature.Values.data()), masks_(signature.Masks.data()),
+          size_(Size)
+    {
+        if constexpr (Size <= SignatureScanner::MAX_UNROLLED_SIZE)
+        {
+            matches_ = &SignatureScanner::MatchesFixed<Size>;
+        }
+    }
+
+    /**
+     * Gets the value of each byte in the pattern, with wildcards zeroed.
+     */
+    [[nodiscard]] constexpr const uint8_t* GetValues() const
+    {
+        return values_;
+    }
+
+    /**
+     * Gets the mask of each byte in the pattern.
+     */
+    [[nodiscard]] constexpr const uint8_t* GetMasks() const
+    {
+        return masks_;
+    }
+
+    /**
+     * Gets the size of the pattern, in bytes.
+     */
+    [[nodiscard]] constexpr size_t GetSize() const
+    {
+        return size_;
+    }
+
+    /**
+     * Checks whether the pattern matches the memory at the given position.
+     * @param current Start of the memory to compare, which must have at least
+     * GetSize() readable bytes.
+     * @return True if every byte matches under its mask.
+     */
+    [[nodiscard]] bool Matches(const uint8_t* current) const
+    {
+        return matches_(values_, masks_, size_, current);
+    }
+
+    /**
+     * Creates a scanner that searches memory for this signature.
+     * @param engine The preferred scanning engine.
+     * @return The scanner for this signature.
+     */
+    [[nodiscard]] SignatureScanner CreateScanner(
+        const SignatureScanner::Engine engine =
+            SignatureScanner::GetBestEngine()) const
+    {
+        const TraceScope scope("SignatureView::CreateScanner");
+        return {values_, masks_, size_, engine};
+    }
+};
+
+/**
+ * Holds the text of a signature literal so that it can be parsed at compile
+ * time.
+ * @tparam Length The length of the text, including the null terminator.
+ */
+template <size_t Length> struct SignatureLiteral
+{
+    char Text[Length]{};
+
+    consteval SignatureLiteral(const char (&text)[Length])
+    {
+        for (size_t i = 0; i < Length; i++)
+        {
+            Text[i] = text[i];
+        }
+    }
+
+    /**
+     * Parses the signature.
+     * @param values Receives the value of each byte, or nullptr to only count
+     * the bytes.
+     * @param masks Receives the mask of each byte, or nullptr to only count the
+     * bytes.
+     * @return The number of bytes in the signature.
+     * @remarks Bytes are written as pairs of hex characters, or ?? to match any
+     * byte, and may be separated by spaces. Invalid text fails to compile.
+     */
+    consteval size_t Parse(uint8_t* values = nullptr,
+                           uint8_t* masks = nullptr) const
+    {
+        size_t size = 0;
+        for (size_t i = 0; i + 1 < Length; i++)
+        {
+            // Skip whitespace characters
+            if (Text[i] == ' ')
+            {
+                continue;
+            }
+
+            if (i + 2 >= Length || Text[i + 1] == ' ')
+            {
+                throw std::invalid_argument("Incomplete byte in signature.");
+            }
+
+            uint8_t value = 0;
+            uint8_t mask = 0;
+            if (Text[i] == '?' && Text[i + 1] == '?')
+            {
+                // Value is a wildcard
+            }
+            else
+            {
+                // Value is a hex character
+                value = ParseOctet(Text[i]) << 4 | ParseOctet(Text[i + 1]);
+                mask = 0xFF;
+            }
+
+            if (values && masks)
+            {
+                values[size] = value;
+                masks[size] = mask;
+            }
+
+            size++;
+            i++;
+        }
+
+        return size;
+    }
+
+private:
+    static consteval uint8_t ParseOctet(const char value)
+    {
+        // Parse digits
+        if (value >= '0' && value <= '9')
+        {
+            return value - '0';
+        }
+
+        // Parse uppercase letters
+        if (value >= 'A' && value <= 'F')
+        {
+            return 10 + value - 'A';
+        }
+
+        // Parse lowercase letters
+        if (value >= 'a' && value <= 'f')
+        {
+            return 10 + value - 'a';
+        }
+
+        throw std::invalid_argument("Invalid hex character.");
+    }
+};
+
+/**
+ * Parses a signature at compile time.
+ * @code
+ * static constexpr auto signature = "72 ?? 80 7C 24 48 00 75"_sig;
+ * @endcode
+ * @return The signature, with exactly one value and mask per byte.
+ * @remarks A malformed signature is a compile error rather than a runtime
+ * error.
+ */
+template <SignatureLiteral Literal> consteval auto operator""_sig()
+{
+    PackedSignature<Literal.Parse()> signature;
+    Literal.Parse(signature.Values.data(), signature.Masks.data());
+    return signature;
+}
+
+#endif // SIGNATURE_H
@@ -0,0 +1,163 @@
+﻿#ifndef SIGNATURERESOLUTIONCACHE_H
+#define SIGNATURERESOLUTIONCACHE_H
+
+#include <cstdint>
+#include <filesystem>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "ExecutableFingerprint.h"
+
+#include "../IO/CacheFile.h"
+
+/**
+ * Remembers where signatures were found across launches of the game, so that
+ * warm startups only need to verify the cached locations instead of scanning.
+ * @remarks The cache file belongs to a single build of the executable, which is
+ * identified by its fingerprint. If the fingerprint changes, the cached
+ * locations are discarded. Failing to read or write the file is not an error,
+ * since the signatures can always be found by scanning.
+ */
+class SignatureResolutionCache
+{
+private:
+    static constexpr uint32_t MAGIC = 0x43535244; // DRSC
+    static constexpr uint32_t VERSION = 1;
+
+    CacheFile file_;
+    ExecutableFingerprint fingerprint_;
+    std::unordered_map<std::string, std::vector<uint32_t>> entries_;
+    bool isDirty_{false};
+
+public:
+    /**
+     * Instantiates an empty cache.
+     * @param path Path to the cache file, or an empty path to disable
+     * persistence.
+     * @param fingerprint The fingerprint of the executable being patched.
+     */
+    SignatureResolutionCache(std::filesystem::path path,
+                             const ExecutableFingerprint& fingerprint)
+        : file_(std::move(path), MAGIC, VERSION), fingerprint_(fingerprint)
+    {
+    }
+
+    /**
+     * Gets the default location of the cache file.
+     * @return %LOCALAPPDATA%/Flagrum/cache/DrautosSignatures.bin, or an empty
+     * path if the local application data folder is unknown.
+     */
+    static std::filesystem::path GetDefaultPath()
+    {
+        return CacheFile::GetDefaultPath("DrautosSignatures.bin");
+    }
+
+    /**
+     * Loads the cached locations from the cache file.
+     * @return True if the file exists and belongs to the same executable.
+     */
+    bool Load()
+    {
+        entries_.clear();
+        isDirty_ = false;
+
+        const auto readHeader = [this](std::istream& stream) {
+            ExecutableFingerprint fingerprint;
+            return CacheFile::Read(stream, fingerprint.TimeDateStamp) &&
+                   CacheFile::Read(stream, fingerprint.CheckSum) &&
+                   CacheFile::Read(stream, fingerprint.SizeOfImage) &&
+                   CacheFile::Read(stream, fingerprint.CodeHash) &&
+                   fingerprint == fingerprint_;
+        };
+
+        const auto readEntry = [this](std::istream& stream) {
+            std::string key;
+            uint32_t rvaCount;
+            if (!CacheFile::ReadString(stream, key) ||
+                !CacheFile::Read(stream, rvaCount) || rvaCount > 0x10000)
+            {
+                return false;
+            }
+
+            std::vector<uint32_t> rvas(rvaCount);
+            stream.read(reinterpret_cast<char*>(rvas.data()),
+                        static_cast<std::streamsize>(rvaCount * 4));
+            entries_[std::move(key)] = std::move(rvas);
+            return static_cast<bool>(stream);
+        };
+
+        if (!file_.Load(readHeader, readEntry))
+        {
+            entries_.clear();
+            return false;
+        }
+
+        return true;
+    }
+
+    /**
+     * Gets the cached locations of a signature.
+     * @param key The key of the signature, from SignatureResultCache::CreateKey.
+     * @return The RVAs of the matches, or nullptr if the signature is not
+     * cached.
+     */
+    [[nodiscard]] const std::vector<uint32_t>* Find(
+        const std::string& key) const
+    {
+        const auto entry = entries_.find(key);
+        return entry == entries_.end() ? nullptr : &entry->second;
+    }
+
+    /**
+     * Stores the locations of a signature.
+     * @param key The key of the signature, from SignatureResultCache::CreateKey.
+     * @param rvas The RVAs of the matches.
+     */
+    void Store(const std::string& key, std::vector<uint32_t> rvas)
+    {
+        const auto [entry, isInserted] = entries_.try_emplace(key);
+        if (isInserted || entry->second != rvas)
+        {
+            entry->second = std::move(rvas);
+            isDirty_ = true;
+        }
+    }
+
+    /**
+     * Writes the cache file if anything has changed since it was loaded.
+     * @return True if the file is up to date.
+     */
+    bool Save()
+    {
+        if (!isDirty_)
+        {
+            return true;
+        }
+
+        const auto writeHeader = [this](std::ostream& stream) {
+            CacheFile::Write(stream, fingerprint_.TimeDateStamp);
+            CacheFile::Write(stream, fingerprint_.CheckSum);
+            CacheFile::Write(stream, fingerprint_.SizeOfImage);
+            CacheFile::Write(stream, fingerprint_.CodeHash);
+        };
+
+        const auto writeEntry = [](std::ostream& stream, const auto& entry) {
+            const auto& [key, rvas] = entry;
+            CacheFile::WriteString(stream, key);
+            CacheFile::Write(stream, static_cast<uint32_t>(rvas.size()));
+            stream.write(reinterpret_cast<const char*>(rvas.data()),
+                         static_cast<std::streamsize>(rvas.size() * 4));
+        };
+
+        if (!file_.Save(writeHeader, entries_, writeEntry))
+        {
+            return false;
+        }
+
+        isDirty_ = false;
+        return true;
+    }
+};
+
+#endif // SIGNATURERESOLUTIONCACHE_H
@@ -0,0 +1,194 @@
+#ifndef SIGNATURERESOLVER_H
+#define SIGNATURERESOLVER_H
+
+#include <algorithm>
+#include <string>
+#include <vector>
+
+#include "ExecutableFingerprint.h"
+#include "MemorySignature.h"
+#include "SignatureResolutionCache.h"
+
+/**
+ * Finds signatures in the host module, reusing the locations cached on disk by
+ * a previous launch of the same build wherever they can be verified.
+ */
+class SignatureResolver
+{
+public:
+    SignatureResolver() = delete;
+
+    /**
+     * Finds every signature, using the locations cached by a previous launch
+     * where they can be verified, and scanning the module for the rest.
+     * @param signatures The signatures to find.
+     * @param filters The sections to search for each signature.
+     * @return The matches of each signature, in the same order as signatures.
+     * @remarks Only signatures restricted to code sections are cached on disk,
+     * as the executable fingerprint does not cover the other sections. This
+     * includes signatures that were not found, since the code they were
+     * searched for in cannot have changed. The results are also stored in the
+     * SignatureResultCache if it is active.
+     */
+    static std::vector<std::vector<uint8_t*>> Resolve(
+        const std::vector<MemorySignature>& signatures,
+        const std::vector<PeSectionFilter>& filters)
+    {
+        const TraceScope scope("SignatureResolver::Resolve");
+        const auto moduleStart = reinterpret_cast<uint8_t*>(Host::hModule);
+        SignatureResolutionCache persistentCache(
+            SignatureResolutionCache::GetDefaultPath(), GetFingerprint());
+        persistentCache.Load();
+
+        auto& cache = SignatureResultCache::GetInstance();
+        std::vector<std::vector<uint8_t*>> results(signatures.size());
+        std::vector<MemorySignature> misses;
+        std::vector<PeSectionFilter> missFilters;
+        std::vector<size_t> missIndices;
+        std::vector<std::string> missKeys;
+
+        for (size_t i = 0; i < signatures.size(); i++)
+        {
+            const auto scanner = signatures[i].CreateScanner();
+            const auto key =
+                SignatureResultCache::CreateKey(scanner, filters[i]);
+
+            // Verify that the signature still matches at every cached location
+            const auto rvas = filters[i].Class == PeImage::CODE
+                                  ? persistentCache.Find(key)
+                                  : nullptr;
+            auto isVerified = rvas != nullptr;
+            if (isVerified)
+            {
+                const auto regions =
+                    MemorySignature::GetModuleRegions(filters[i]);
+                for (const auto rva : *rvas)
+                {
+                    const auto address = moduleStart + rva;
+                    if (!IsMatch(scanner, address, regions))
+                    {
+                        isVerified = false;
+                        results[i].clear();
+                        break;
+                    }
+
+                    results[i].push_back(address);
+                }
+            }
+
+            if (!isVerified)
+            {
+                misses.push_back(signatures[i]);
+                missFilters.push_back(filters[i]);
+                missIndices.push_back(i);
+                missKeys.push_back(filters[i].Class == PeImage::CODE
+                                       ? key
+                                       : std::string());
+                continue;
+            }
+
+            cache.Store(key, results[i]);
+        }
+
+        if (misses.empty())
+        {
+            return results;
+        }
+
+        // Scan for the signatures that could not be verified
+        auto found = MemorySignature::FindAll(misses, missFilters);
+        for (size_t i = 0; i < misses.size(); i++)
+        {
+            if (!missKeys[i].empty())
+            {
+                std::vector<uint32_t> rvas;
+                rvas.reserve(found[i].size());
+                for (const auto match : found[i])
+                {
+                    rvas.push_back(static_cast<uint32_t>(match - moduleStart));
+                }
+
+                persistentCache.Store(missKeys[i], std::move(rvas));
+            }
+
+            results[missIndices[i]] = std::move(found[i]);
+        }
+
+        persistentCache.Save();
+        return results;
+    }
+
+    /**
+     * Checks whether a signature matches at an address without reading past
+     * the end of the regions that are allowed to contain it.
+     * @param scanner Scanner for the signature.
+     * @param address The address to check.
+     * @param regions The regions that the match must lie within.
+     * @return True if the signature matches at the address.
+     */
+    static bool IsMatch(const SignatureScanner& scanner,
+                        const uint8_t* address,
+                        const std::vector<MemoryRegion>& regions)
+    {
+        const auto isInRegion =
+            std::any_of(regions.begin(), regions.end(), [&](const auto& r) {
+                return address >= r.Start &&
+                       r.End - address >=
+                           static_cast<ptrdiff_t>(scanner.GetSize());
+            });
+        return isInRegion && scanner.Matches(address);
+    }
+
+    /**
+     * Excludes code from the fingerprint of the host module because it has
+     * been modified in a way that differs between launches.
+     * @param address The start of the modified code.
+     * @param size The number of bytes that were modified.
+     * @remarks This must be called before the fingerprint is first used.
+     */
+    static void ExcludeFromFingerprint(const void* address, const size_t size)
+    {
+        const auto rva = static_cast<uint32_t>(
+            static_cast<const uint8_t*>(address) -
+            reinterpret_cast<uint8_t*>(Host::hModule));
+        for (size_t offset = 0; offset < size; offset += 8)
+        {
+            GetExcluded().push_back(rva + static_cast<uint32_t>(offset));
+        }
+    }
+
+private:
+    static std::vector<uint32_t>& GetExcluded()
+    {
+        static std::vector<uint32_t> excluded;
+        return excluded;
+    }
+
+    /**
+     * Gets the fingerprint of the host module.
+     * @remarks The fingerprint is computed on first use and then kept, as
+     * applying patches modifies the code that it covers. It must therefore be
+     * first requested before anything is patched. It is only recomputed if
+     * the host module changes, which only happens in the tools.
+     */
+    static const ExecutableFingerprint& GetFingerprint()
+    {
+        static Host::ModuleHandle module{};
+        static size_t moduleSize = 0;
+        static ExecutableFingerprint fingerprint;
+        if (module != Host::hModule || moduleSize != Host::ModuleSize)
+        {
+            module = Host::hModule;
+            moduleSize = Host::ModuleSize;
+            const TraceScope scope("ExecutableFingerprint::Compute");
+            fingerprint = ExecutableFingerprint::Compute(
+                PeImage(reinterpret_cast<uint8_t*>(Host::hModule),
+                        Host::ModuleSize, PeImage::MAPPED),
+                GetExcluded());
+        }
+
+        return fingerprint;
+    }
+};
+
+#endif // SIGNATURERESOLVER_H
@@ -0,0 +1,117 @@
+#ifndef SIGNATURERESULTCACHE_H
+#define SIGNATURERESULTCACHE_H
+
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "PeImage.h"
+#include "SignatureScanner.h"
+
+/**
+ * Remembers where signatures were found for the duration of a patching run, so
+ * that repeated queries for the same signature never rescan memory.
+ * @remarks Results are only stored and returned between Begin and End. The
+ * cache must be ended before the module is modified in a way that would change
+ * the results.
+ */
+class SignatureResultCache
+{
+private:
+    std::unordered_map<std::string, std::vector<uint8_t*>> results_;
+    bool isActive_{false};
+
+    SignatureResultCache() = default;
+
+public:
+    static SignatureResultCache& GetInstance()
+    {
+        static SignatureResultCache instance;
+        return instance;
+    }
+
+    SignatureResultCache(const SignatureResultCache&) = delete;
+
+    SignatureResultCache& operator=(const SignatureResultCache&) = delete;
+
+    /**
+     * Creates the key that identifies a signature in the cache.
+     * @param scanner The scanner for the signature.
+     * @param filter The sections that the signature was searched for in.
+     * @return The values and masks of the signature, followed by the filter.
+     */
+    static std::string CreateKey(const SignatureScanner& scanner,
+                                 const PeSectionFilter& filter = {})
+    {
+        std::string key(scanner.GetSize() * 2, '\0');
+        for (size_t i = 0; i < scanner.GetSize(); i++)
+        {
+            key[i] = static_cast<char>(scanner.GetValues()[i]);
+            key[scanner.GetSize() + i] =
+                static_cast<char>(scanner.GetMasks()[i]);
+        }
+
+        key += static_cast<char>(filter.Class);
+        key += filter.Name;
+        return key;
+    }
+
+    /**
+     * Starts a new run with an empty cache.
+     */
+    void Begin()
+    {
+        results_.clear();
+        isActive_ = true;
+    }
+
+    /**
+     * Ends the current run and discards all cached results.
+     */
+    void End()
+    {
+        results_.clear();
+        isActive_ = false;
+    }
+
+    /**
+     * Whether a run is in progress.
+     */
+    [[nodiscard]] bool IsActive() const
+    {
+        return isActive_;
+    }
+
+    /**
+     * Gets the cached results for a signature.
+     * @param key The key of the signature, from CreateKey.
+     * @return The cached results, or nullptr if there are none.
+     */
+    [[nodiscard]] const std::vector<uint8_t*>* Find(
+        const std::string& key) const
+    {
+        if (!isActive_)
+        {
+            return nullptr;
+        }
+
+        const auto result = results_.find(key);
+        return result == results_.end() ? nullptr : &result->second;
+    }
+
+    /**
+     * Stores the results for a signature if a run is in progress.
+     * @param key The key of the signature, from CreateKey.
+     * @param results The locations the signature was found at.
+     */
+    void Store(const std::string& key, std::vector<uint8_t*> results)
+    {
+        if (isActive_)
+        {
+            results_[key] = std::move(results);
+        }
+    }
+};
+
+#endif // SIGNATURERESULTCACHE_H
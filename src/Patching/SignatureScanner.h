@@ -0,0 +1,614 @@
+#ifndef SIGNATURESCANNER_H
+#define SIGNATURESCANNER_H
+
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <cstdint>
+#include <cstring>
+#include <utility>
+#include <vector>
+
+#if defined(_M_X64) || defined(__x86_64__)
+#define SIGNATURE_SCANNER_X64
+#include <immintrin.h>
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+#endif
+
+/**
+ * Allows a function to use AVX2 intrinsics without enabling AVX2 for the whole
+ * translation unit, so that it can be selected at runtime.
+ */
+#if defined(__GNUC__) || defined(__clang__)
+#define SIGNATURE_SCANNER_TARGET_AVX2 __attribute__((target("avx2")))
+#else
+#define SIGNATURE_SCANNER_TARGET_AVX2
+#endif
+
+/**
+ * Represents a contiguous range of readable memory.
+ */
+struct MemoryRegion
+{
+    /**
+     * Start of the range.
+     */
+    const uint8_t* Start;
+
+    /**
+     * End of the range (exclusive).
+     */
+    const uint8_t* End;
+};
+
+/**
+ * Searches memory for a byte pattern described by a value and mask per byte.
+ * @remarks The two rarest non-wildcard bytes in the pattern are used as
+ * anchors. Candidate positions are filtered by comparing the anchors against
+ * a whole vector of memory at a time, and only the positions where both
+ * anchors match are verified against the full pattern.
+ */
+class SignatureScanner
+{
+public:
+    /**
+     * Represents the instruction set used to filter candidate positions.
+     */
+    enum Engine : uint8_t
+    {
+        SCALAR, /**< Portable fallback using memchr on the rarest byte. */
+        SSE2,   /**< Filters 16 bytes at a time. */
+        AVX2    /**< Filters 32 bytes at a time. */
+    };
+
+    /**
+     * The maximum size of a pattern, in bytes.
+     */
+    static constexpr size_t MAX_SIZE = 128;
+
+    /**
+     * The largest pattern size that has a fully unrolled comparison.
+     */
+    static constexpr size_t MAX_UNROLLED_SIZE = 32;
+
+    /**
+     * Compares a pattern against memory.
+     * @param values The value of each byte in the pattern, with wildcards
+     * zeroed.
+     * @param masks The mask of each byte in the pattern.
+     * @param size The size of the pattern, in bytes.
+     * @param current Start of the memory to compare.
+     * @return True if every byte matches under its mask.
+     */
+    using MatchFunction = bool (*)(const uint8_t* values, const uint8_t* masks,
+                                   size_t size, const uint8_t* current);
+
+private:
+    /**
+     * Approximate ordering of the most frequent bytes in x64 code, most
+     * frequent first. Bytes that are not listed are considered equally rare.
+     */
+    static constexpr uint8_t COMMON_BYTES[] = {
+        0x00, 0xFF, 0x48, 0x8B, 0x89, 0xCC, 0x0F, 0xE8, 0x24, 0x4C, 0x44,
+        0x41, 0x8D, 0x83, 0x85, 0xC0, 0x01, 0x20, 0x10, 0x08, 0x74, 0x75,
+        0x28, 0x30, 0x40, 0x38, 0x18, 0x49, 0x4D, 0x45, 0x33, 0xC3, 0xC7,
+        0xD2, 0x90, 0x84, 0x80, 0x02, 0x04, 0xEB, 0x5C, 0x54, 0x7C, 0x50,
+        0x58, 0x60, 0x70, 0x78, 0x0C, 0x03, 0xF8, 0xC9, 0xDB, 0x57, 0x56,
+        0x55, 0x53, 0x5F, 0x5E, 0x5D, 0x5B, 0xE9, 0x8A, 0x88, 0x3B, 0x39,
+        0x66, 0x14, 0x1C, 0x2C, 0x34, 0x3C, 0xF0, 0xE0, 0xD0, 0x05, 0x06,
+        0x07, 0x0D, 0x0E, 0x1F, 0x11, 0x12, 0x3D, 0x63, 0x81, 0xC1, 0xC8};
+
+    /**
+     * How common each byte value is, where higher values are more common.
+     */
+    static constexpr std::array<uint8_t, 256> BYTE_FREQUENCY = [] {
+        std::array<uint8_t, 256> frequency{};
+        constexpr auto count = sizeof(COMMON_BYTES);
+        for (size_t i = 0; i < count; i++)
+        {
+            const auto rank = static_cast<uint8_t>(count - i);
+            frequency[COMMON_BYTES[i]] =
+                std::max(frequency[COMMON_BYTES[i]], rank);
+        }
+        return frequency;
+    }();
+
+    std::array<uint8_t, MAX_SIZE> values_{};
+    std::array<uint8_t, MAX_SIZE> masks_{};
+    size_t size_{0};
+    size_t anchor_{0};
+    size_t secondAnchor_{0};
+    bool hasAnchor_{false};
+    MatchFunction matches_;
+    Engine engine_;
+
+public:
+    /**
+     * Instantiates a scanner for the given pattern.
+     * @param values The value of each byte in the pattern.
+     * @param masks The mask of each byte in the pattern, where 0xFF must match
+     * exactly and 0x00 matches any byte.
+     * @param size The size of the pattern, in bytes.
+     * @param engine The preferred engine, which will be downgraded if it is
+     * not supported by the current CPU.
+     */
+    SignatureScanner(const uint8_t* values, const uint8_t* masks,
+                     const size_t size, const Engine engine = GetBestEngine())
+        : size_(std::min(size, MAX_SIZE)),
+          matches_(GetMatchFunction(size_)),
+          engine_(std::min(engine, GetBestEngine()))
+    {
+        for (size_t i = 0; i < size_; i++)
+        {
+            masks_[i] = masks[i];
+            values_[i] = values[i] & masks[i];
+        }
+
+        SelectAnchors();
+    }
+
+    /**
+     * Gets the best engine supported by the current CPU.
+     * @return The engine that will be used by default.
+     */
+    static Engine GetBestEngine()
+    {
+        static const auto engine = DetectEngine();
+        return engine;
+    }
+
+    /**
+     * Gets the engine used by this scanner.
+     */
+    [[nodiscard]] Engine GetEngine() const
+    {
+        return engine_;
+    }
+
+    /**
+     * Gets the size of the pattern, in bytes.
+     */
+    [[nodiscard]] size_t GetSize() const
+    {
+        return size_;
+    }
+
+    /**
+     * Whether the pattern has at least one non-wildcard byte to anchor on.
+     */
+    [[nodiscard]] bool HasAnchor() const
+    {
+        return hasAnchor_;
+    }
+
+    /**
+     * Gets the offset of the rarest non-wildcard byte in the pattern.
+     */
+    [[nodiscard]] size_t GetAnchorOffset() const
+    {
+        return anchor_;
+    }
+
+    /**
+     * Gets the value of the rarest non-wildcard byte in the pattern.
+     */
+    [[nodiscard]] uint8_t GetAnchorValue() const
+    {
+        return values_[anchor_];
+    }
+
+    /**
+     * Gets the value of each byte in the pattern, with wildcards zeroed.
+     */
+    [[nodiscard]] const uint8_t* GetValues() const
+    {
+        return values_.data();
+    }
+
+    /**
+     * Gets the mask of each byte in the pattern.
+     */
+    [[nodiscard]] const uint8_t* GetMasks() const
+    {
+        return masks_.data();
+    }
+
+    /**
+     * Checks whether the pattern matches the memory at the given position.
+     * @param current Start of the memory to compare, which must have at least
+     * GetSize() readable bytes.
+     * @return True if every byte matches under its mask.
+     */
+    [[nodiscard]] bool Matches(const uint8_t* current) const
+    {
+        return matches_(values_.data(), masks_.data(), size_, current);
+    }
+
+    /**
+     * Compares a pattern of a size known at compile time against memory, with
+     * every byte compared without branching.
+     * @tparam Size The size of the pattern, in bytes.
+     */
+    template <size_t Size>
+    static bool MatchesFixed(const uint8_t* values, const uint8_t* masks,
+                             size_t, const uint8_t* current)
+    {
+        return [&]<size_t... I>(std::index_sequence<I...>) {
+            return (0u | ... |
+                    static_cast<unsigned>((current[I] & masks[I]) ^
+                                          values[I])) == 0;
+        }(std::make_index_sequence<Size>{});
+    }
+
+    /**
+     * Compares a pattern of any size against memory.
+     */
+    static bool MatchesAny(const uint8_t* values, const uint8_t* masks,
+                           const size_t size, const uint8_t* current)
+    {
+        for (size_t i = 0; i < size; i++)
+        {
+            if ((current[i] & masks[i]) != values[i])
+            {
+                return false;
+            }
+        }
+
+        return true;
+    }
+
+    /**
+     * Gets the fastest comparison for a pattern size.
+     * @param size The size of the pattern, in bytes.
+     * @return The unrolled comparison for the size if there is one, otherwise
+     * the generic comparison.
+     */
+    static MatchFunction GetMatchFunction(const size_t size)
+    {
+        static constexpr auto unrolled = []<size_t... I>(
+                                             std::index_sequence<I...>) {
+            return std::array<MatchFunction, sizeof...(I)>{
+                &MatchesFixed<I>...};
+        }(std::make_index_sequence<MAX_UNROLLED_SIZE + 1>{});
+
+        return size <= MAX_UNROLLED_SIZE ? unrolled[size] : &MatchesAny;
+    }
+
+    /**
+     * Finds every position in the range where the pattern matches, including
+     * matches that overlap each other.
+     * @param start Start of the memory range.
+     * @param end End of the memory range (exclusive).
+     * @param results List to append the matching positions to, in ascending
+     * order.
+     */
+    void ScanAll(const uint8_t* start, const uint8_t* end,
+                 std::vector<const uint8_t*>& results) const
+    {
+        if (size_ == 0 || end - start < static_cast<ptrdiff_t>(size_))
+        {
+            return;
+        }
+
+#ifdef SIGNATURE_SCANNER_X64
+        if (hasAnchor_)
+        {
+            if (engine_ == AVX2)
+            {
+                ScanAvx2(start, end, results);
+                return;
+            }
+
+            if (engine_ == SSE2)
+            {
+                ScanSse2(start, end, results);
+                return;
+            }
+        }
+#endif
+
+        ScanScalar(start, end, results);
+    }
+
+    /**
+     * Finds the pattern in the range, skipping matches that overlap a previous
+     * match.
+     * @param start Start of the memory range.
+     * @param end End of the memory range (exclusive).
+     * @param results List to append the matching positions to, in ascending
+     * order.
+     * @remarks Produces the same results as repeatedly calling std::search,
+     * resuming from the end of the previous match.
+     */
+    void Scan(const uint8_t* start, const uint8_t* end,
+              std::vector<const uint8_t*>& results) const
+    {
+        const auto first = results.size();
+        ScanAll(start, end, results);
+        RemoveOverlaps(results, first, size_);
+    }
+
+    /**
+     * Removes matches that start inside a previous match.
+     * @param results The list of matches, in ascending order.
+     * @param first Index of the first match to consider.
+     * @param size The size of the pattern, in bytes.
+     */
+    static void RemoveOverlaps(std::vector<const uint8_t*>& results,
+                               const size_t first, const size_t size)
+    {
+        auto kept = first;
+        const uint8_t* next = nullptr;
+
+        for (auto i = first; i < results.size(); i++)
+        {
+            if (results[i] >= next)
+            {
+                next = results[i] + size;
+                results[kept++] = results[i];
+            }
+        }
+
+        results.resize(kept);
+    }
+
+private:
+    static Engine DetectEngine()
+    {
+#ifdef SIGNATURE_SCANNER_X64
+#ifdef _MSC_VER
+        int info[4];
+        __cpuid(info, 0);
+        if (info[0] >= 7)
+        {
+            __cpuid(info, 1);
+            const auto hasOsSave = (info[2] & (1 << 27)) != 0;
+            const auto hasAvx = (info[2] & (1 << 28)) != 0;
+
+            __cpuidex(info, 7, 0);
+            const auto hasAvx2 = (info[1] & (1 << 5)) != 0;
+
+            // The OS must also save the YMM registers on context switches
+            if (hasOsSave && hasAvx && hasAvx2 && (_xgetbv(0) & 6) == 6)
+            {
+                return AVX2;
+            }
+        }
+#else
+        __builtin_cpu_init();
+        if (__builtin_cpu_supports("avx2"))
+        {
+            return AVX2;
+        }
+#endif
+
+        // SSE2 is part of the x64 baseline
+        return SSE2;
+#else
+        return SCALAR;
+#endif
+    }
+
+    /**
+     * Selects the two rarest non-wildcard bytes in the pattern as anchors.
+     */
+    void SelectAnchors()
+    {
+        for (size_t i = 0; i < size_; i++)
+        {
+            if (masks_[i] != 0xFF)
+            {
+                continue;
+            }
+
+            if (!hasAnchor_ || IsRarer(i, anchor_))
+            {
+                secondAnchor_ = hasAnchor_ ? anchor_ : i;
+                anchor_ = i;
+                hasAnchor_ = true;
+            }
+            else if (secondAnchor_ == anchor_ || IsRarer(i, secondAnchor_))
+            {
+                secondAnchor_ = i;
+            }
+        }
+    }
+
+    [[nodiscard]] bool IsRarer(const size_t left, const size_t right) const
+    {
+        return BYTE_FREQUENCY[values_[left]] < BYTE_FREQUENCY[values_[right]];
+    }
+
+    void ScanScalar(const uint8_t* start, const uint8_t* end,
+                    std::vector<const uint8_t*>& results) const
+    {
+        if (end - start < static_cast<ptrdiff_t>(size_))
+        {
+            return;
+        }
+
+        const auto last = end - size_;
+
+        if (!hasAnchor_)
+        {
+            // Every position matches a pattern made entirely of wildcards
+            for (auto current = start; current <= last; current++)
+            {
+                results.push_back(current);
+            }
+
+            return;
+        }
+
+        // Let memchr find the rarest byte, then verify the rest
+        const auto anchorValue = values_[anchor_];
+        auto current = start;
+        while (current <= last)
+        {
+            const auto found = static_cast<const uint8_t*>(
+                std::memchr(current + anchor_, anchorValue, last - current + 1));
+            if (!found)
+            {
+                break;
+            }
+
+            current = found - anchor_;
+            if (Matches(current))
+            {
+                results.push_back(current);
+            }
+
+            current++;
+        }
+    }
+
+#ifdef SIGNATURE_SCANNER_X64
+    /**
+     * Verifies each candidate position whose bit is set in the mask.
+     */
+    void VerifyCandidates(const uint8_t* base, uint32_t candidates,
+                          std::vector<const uint8_t*>& results) const
+    {
+        while (candidates)
+        {
+            const auto current = base + std::countr_zero(candidates);
+            if (Matches(current))
+            {
+                results.push_back(current);
+            }
+
+            candidates &= candidates - 1;
+        }
+    }
+
+    void ScanSse2(const uint8_t* start, const uint8_t* end,
+                  std::vector<const uint8_t*>& results) const
+    {
+        constexpr ptrdiff_t width = 16;
+        const auto first = _mm_set1_epi8(static_cast<char>(values_[anchor_]));
+        const auto second =
+            _mm_set1_epi8(static_cast<char>(values_[secondAnchor_]));
+
+        const auto load = [](const uint8_t* address) {
+            return _mm_loadu_si128(reinterpret_cast<const __m128i*>(address));
+        };
+
+        // Skip four vectors at a time while the rarest anchor is absent
+        const auto needed = static_cast<ptrdiff_t>(size_) + width - 1;
+        auto current = start;
+        for (; end - current >= needed + width * 3; current += width * 4)
+        {
+            const auto anchor = current + anchor_;
+            const auto any = _mm_or_si128(
+                _mm_or_si128(_mm_cmpeq_epi8(load(anchor), first),
+                             _mm_cmpeq_epi8(load(anchor + width), first)),
+                _mm_or_si128(_mm_cmpeq_epi8(load(anchor + width * 2), first),
+                             _mm_cmpeq_epi8(load(anchor + width * 3), first)));
+            if (_mm_movemask_epi8(any) == 0)
+            {
+                continue;
+            }
+
+            for (auto block = current; block < current + width * 4;
+                 block += width)
+            {
+                VerifyCandidates(block, FilterSse2(block, first, second),
+                                 results);
+            }
+        }
+
+        // Stop once the last candidate in the block would overrun the range
+        for (; end - current >= needed; current += width)
+        {
+            VerifyCandidates(current, FilterSse2(current, first, second),
+                             results);
+        }
+
+        ScanScalar(current, end, results);
+    }
+
+    /**
+     * Finds the positions in a block of 16 where both anchors match.
+     */
+    [[nodiscard]] uint32_t FilterSse2(const uint8_t* block,
+                                      const __m128i first,
+                                      const __m128i second) const
+    {
+        const auto a =
+            _mm_loadu_si128(reinterpret_cast<const __m128i*>(block + anchor_));
+        const auto b = _mm_loadu_si128(
+            reinterpret_cast<const __m128i*>(block + secondAnchor_));
+        return static_cast<uint32_t>(_mm_movemask_epi8(
+            _mm_and_si128(_mm_cmpeq_epi8(a, first), _mm_cmpeq_epi8(b, second))));
+    }
+
+    SIGNATURE_SCANNER_TARGET_AVX2
+    void ScanAvx2(const uint8_t* start, const uint8_t* end,
+                  std::vector<const uint8_t*>& results) const
+    {
+        constexpr ptrdiff_t width = 32;
+        const auto first =
+            _mm256_set1_epi8(static_cast<char>(values_[anchor_]));
+        const auto second =
+            _mm256_set1_epi8(static_cast<char>(values_[secondAnchor_]));
+
+        // Skip four vectors at a time while the rarest anchor is absent
+        const auto needed = static_cast<ptrdiff_t>(size_) + width - 1;
+        auto current = start;
+        for (; end - current >= needed + width * 3; current += width * 4)
+        {
+            const auto anchor = current + anchor_;
+            const auto any = _mm256_or_si256(
+                _mm256_or_si256(CompareAvx2(anchor, first),
+                                CompareAvx2(anchor + width, first)),
+                _mm256_or_si256(CompareAvx2(anchor + width * 2, first),
+                                CompareAvx2(anchor + width * 3, first)));
+            if (_mm256_testz_si256(any, any))
+            {
+                continue;
+            }
+
+            for (auto block = current; block < current + width * 4;
+                 block += width)
+            {
+                VerifyCandidates(block, FilterAvx2(block, first, second),
+                                 results);
+            }
+        }
+
+        // Stop once the last candidate in the block would overrun the range
+        for (; end - current >= needed; current += width)
+        {
+            VerifyCandidates(current, FilterAvx2(current, first, second),
+                             results);
+        }
+
+        ScanScalar(current, end, results);
+    }
+
+    SIGNATURE_SCANNER_TARGET_AVX2
+    static __m256i CompareAvx2(const uint8_t* address, const __m256i value)
+    {
+        return _mm256_cmpeq_epi8(
+            _mm256_loadu_si256(reinterpret_cast<const __m256i*>(address)),
+            value);
+    }
+
+    /**
+     * Finds the positions in a block of 32 where both anchors match.
+     */
+    SIGNATURE_SCANNER_TARGET_AVX2
+    [[nodiscard]] uint32_t FilterAvx2(const uint8_t* block,
+                                      const __m256i first,
+                                      const __m256i second) const
+    {
+        return static_cast<uint32_t>(_mm256_movemask_epi8(
+            _mm256_and_si256(CompareAvx2(block + anchor_, first),
+                             CompareAvx2(block + secondAnchor_, second))));
+    }
+#endif
+};
+
+#endif // SIGNATURESCANNER_H
@@ -0,0 +1,95 @@
+#ifndef LMARCENTRYFLAGS_H
+#define LMARCENTRYFLAGS_H
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+
+namespace SQEX::Luminous::AssetManager
+{
+/**
+ * Normalizes the flags of archive entries that Flagrum has masked.
+ * @remarks Flagrum replaces the compressed flag of the entries in mod archives
+ * with MASK_COMPRESSED, so the game needs the real flag restored before it
+ * reads them. The game stores its entries as an array of structures, so
+ * UnmaskAll gathers the flag fields into small contiguous blocks that the
+ * compiler can normalize with vector instructions, and only scatters back the
+ * blocks that had a masked flag. The mod does not call UnmaskAll yet, since
+ * neither the function that creates an archive interface nor where it keeps
+ * its entry table is known. Until a hook on it can pass the table,
+ * UnmaskCompressedHook unmasks each entry as it is looked up instead.
+ */
+class LmArcEntryFlags
+{
+public:
+    static constexpr int16_t COMPRESSED = 2;
+    static constexpr int16_t MASK_COMPRESSED = 256;
+
+    /**
+     * Replaces MASK_COMPRESSED with COMPRESSED in a set of flags.
+     * @param flags The flags of an archive entry.
+     * @return The flags without MASK_COMPRESSED, with COMPRESSED set if
+     * MASK_COMPRESSED was.
+     */
+    static constexpr int16_t Unmask(const int16_t flags)
+    {
+        const auto isMasked = (flags & MASK_COMPRESSED) != 0;
+        return static_cast<int16_t>((flags & ~MASK_COMPRESSED) |
+                                    (isMasked ? COMPRESSED : 0));
+    }
+
+    /**
+     * Unmasks the flags of every entry in an archive entry table.
+     * @param pEntries The first entry in the table.
+     * @param count The number of entries in the table.
+     * @param stride The size of each entry.
+     * @param flagsOffset The offset of the flags within each entry.
+     * @return The number of entries that had MASK_COMPRESSED.
+     */
+    static size_t UnmaskAll(void* pEntries, const size_t count,
+                            const size_t stride, const size_t flagsOffset)
+    {
+        auto pFlags = static_cast<char*>(pEntries) + flagsOffset;
+        size_t unmaskedCount = 0;
+
+        for (size_t start = 0; start < count; start += BLOCK_SIZE)
+        {
+            const auto size =
+                count - start < BLOCK_SIZE ? count - start : BLOCK_SIZE;
+            int16_t block[BLOCK_SIZE] = {};
+
+            for (size_t i = 0; i < size; i++)
+            {
+                std::memcpy(&block[i], pFlags + i * stride, sizeof(int16_t));
+            }
+
+            // Branch-free over the whole block so that it is vectorized
+            size_t maskedCount = 0;
+            for (auto& flags : block)
+            {
+                maskedCount += (flags & MASK_COMPRESSED) != 0;
+                flags = Unmask(flags);
+            }
+
+            if (maskedCount > 0)
+            {
+                for (size_t i = 0; i < size; i++)
+                {
+                    std::memcpy(pFlags + i * stride, &block[i],
+                                sizeof(int16_t));
+                }
+
+                unmaskedCount += maskedCount;
+            }
+
+            pFlags += size * stride;
+        }
+
+        return unmaskedCount;
+    }
+
+private:
+    static constexpr size_t BLOCK_SIZE = 64;
+};
+} // namespace SQEX::Luminous::AssetManager
+
+#endif // LMARCENTRYFLAGS_H
@@ -2,6 +2,7 @@
 #define LMASSETID_H
 #include <cstdint>
 #include <string>
+#include <string_view>
 
 #include "../Core.h"
 
@@ -13,13 +14,22 @@ namespace SQEX::Luminous::AssetManager
 struct LmAssetID
 {
 private:
-    explicit LmAssetID(const char* uri)
+    explicit LmAssetID(const std::string_view uri, const uint64_t fullHash = 0)
+        : fullHash_(fullHash), m_path(uri)
     {
-        fullHash_ = 0;
-        m_path = uri;
     }
 
 public:
+    /**
+     * The FNV1A offset basis that URIs are hashed with.
+     */
+    static constexpr uint64_t NAME_HASH_OFFSET_BASIS = 0x14650FB0739D0383;
+
+    /**
+     * The bits of the full hash that hold the URI hash.
+     */
+    static constexpr uint64_t NAME_HASH_MASK = 0xFFFFFFFFFFF;
+
     /**
      * The raw value of the asset ID. This is a combined hash of the URI and
      * type (file extension).
@@ -57,6 +67,24 @@ public:
         return *result;
     }
 
+    /**
+     * Gets the URI hash for an asset without storing it, so that asset IDs
+     * owned by the game are never written to.
+     * @param pAssetId The ID of the asset to get the URI hash for.
+     * @return The stored URI hash, or the computed one if none is stored.
+     */
+    static uint64_t GetNameHash(const LmAssetID* pAssetId)
+    {
+        const auto uriHash = pAssetId->fullHash_ & NAME_HASH_MASK;
+        if (uriHash != 0)
+        {
+            return uriHash;
+        }
+
+        uint64_t result;
+        return GenerateNameHash(&result, &pAssetId->m_path);
+    }
+
     /**
      * Generates the hash of the given URI, excluding the file extension (type)
      * component.
@@ -67,11 +95,23 @@ public:
      */
     static uint64_t GenerateNameHash(uint64_t* result, const std::string* path)
     {
-        *result = Core::Fnv1a64Lower(path->data(), 0x14650FB0739D0383) &
-                  0xFFFFFFFFFFF;
+        *result = Core::Fnv1a64LowerFast(*path, NAME_HASH_OFFSET_BASIS) &
+                  NAME_HASH_MASK;
         return *result;
     }
 
+    /**
+     * Computes the same hash as GenerateNameHash at compile time, so the
+     * hashes of fixed URIs can be constants.
+     * @param uri The URI to hash.
+     * @return The computed hash.
+     */
+    static constexpr uint64_t ComputeNameHash(const std::string_view uri)
+    {
+        return Core::Fnv1a64LowerConstexpr(uri, NAME_HASH_OFFSET_BASIS) &
+               NAME_HASH_MASK;
+    }
+
     /**
      * Creates a new unhashed AssetID with the URI populated.
      * @param uri The URI to initialize the asset ID with.
@@ -81,6 +121,29 @@ public:
     {
         return LmAssetID(uri);
     }
+
+    /**
+     * Creates a new unhashed AssetID with the URI populated.
+     * @param uri The URI to initialize the asset ID with, which does not need
+     * to be null-terminated.
+     * @return The newly created LmAssetID.
+     */
+    static LmAssetID Create(const std::string_view uri)
+    {
+        return LmAssetID(uri);
+    }
+
+    /**
+     * Creates a new AssetID with the URI populated and its hash already
+     * computed, such as by ComputeNameHash.
+     * @param uri The URI to initialize the asset ID with.
+     * @param nameHash The hash of the URI.
+     * @return The newly created LmAssetID.
+     */
+    static LmAssetID Create(const char* uri, const uint64_t nameHash)
+    {
+        return LmAssetID(uri, nameHash);
+    }
 };
 } // namespace SQEX::Luminous::AssetManager
 
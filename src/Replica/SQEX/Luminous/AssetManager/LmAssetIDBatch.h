@@ -0,0 +1,227 @@
+#ifndef LMASSETIDBATCH_H
+#define LMASSETIDBATCH_H
+#include <algorithm>
+#include <cstdint>
+#include <span>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "LmAssetID.h"
+
+#include "../../../../Threading/ThreadPool.h"
+
+namespace SQEX::Luminous::AssetManager
+{
+/**
+ * Stores many asset URIs in a single buffer so that their name hashes can be
+ * generated together.
+ * @remarks URIs are stored back to back in a blob, with the offset of the end
+ * of each URI in a separate array that starts with 0, so adding a URI never
+ * allocates once the buffers have grown. Hashing interleaves LANES URIs at a
+ * time, as each FNV1A hash is a serial chain of multiplies that would
+ * otherwise leave most of the multiplier idle, and splits large batches across
+ * a thread pool. Hashing allocates one buffer per chunk, not per URI.
+ */
+class LmAssetIDBatch
+{
+public:
+    /**
+     * The number of URIs that are hashed at the same time by each thread.
+     */
+    static constexpr size_t LANES = 4;
+
+    /**
+     * The number of URIs hashed by each task on the thread pool.
+     */
+    static constexpr size_t CHUNK_SIZE = 16384;
+
+private:
+    std::string blob_;
+    std::vector<size_t> offsets_{0};
+
+public:
+    /**
+     * Reserves space for URIs.
+     * @param count The number of URIs.
+     * @param size The total size of the URIs.
+     */
+    void Reserve(const size_t count, const size_t size)
+    {
+        offsets_.reserve(count + 1);
+        blob_.reserve(size);
+    }
+
+    /**
+     * Adds a URI to the batch.
+     * @param uri The URI, which must not contain null characters.
+     */
+    void Add(const std::string_view uri)
+    {
+        blob_.append(uri);
+        offsets_.push_back(blob_.size());
+    }
+
+    /**
+     * Gets the number of URIs in the batch.
+     */
+    [[nodiscard]] size_t GetSize() const
+    {
+        return offsets_.size() - 1;
+    }
+
+    /**
+     * Gets a URI in the batch.
+     * @param index The index of the URI.
+     */
+    [[nodiscard]] std::string_view Get(const size_t index) const
+    {
+        return std::string_view(blob_).substr(
+            offsets_[index], offsets_[index + 1] - offsets_[index]);
+    }
+
+    /**
+     * Generates the name hashes of every URI in the batch.
+     * @param fullHashes The full hash of each URI, as described by
+     * GenerateNameHashes.
+     * @param pool The thread pool to hash large batches on.
+     */
+    void GenerateNameHashes(const std::span<uint64_t> fullHashes,
+                            ThreadPool& pool = ThreadPool::GetInstance()) const
+    {
+        GenerateNameHashes(blob_, offsets_, fullHashes, pool);
+    }
+
+    /**
+     * Generates the name hashes of URIs that are stored in a single buffer.
+     * @param blob The URIs, back to back.
+     * @param offsets The offset of the start of the first URI, followed by the
+     * offset of the end of each URI.
+     * @param fullHashes The full hash of each URI. On input, these hold the
+     * type hash of each URI, or 0. On output, the URI hash is combined with the
+     * type hash as LmAssetID::GetNameHash does, and URI hashes that were
+     * already set are kept.
+     * @param pool The thread pool to hash large batches on.
+     * @exception std::invalid_argument Thrown if the offsets do not describe
+     * one URI for each full hash within the blob.
+     */
+    static void GenerateNameHashes(const std::string_view blob,
+                                   const std::span<const size_t> offsets,
+                                   const std::span<uint64_t> fullHashes,
+                                   ThreadPool& pool = ThreadPool::GetInstance())
+    {
+        if (offsets.size() != fullHashes.size() + 1 ||
+            offsets.back() > blob.size() ||
+            !std::is_sorted(offsets.begin(), offsets.end()))
+        {
+            throw std::invalid_argument(
+                "Offsets do not match the URIs and hashes");
+        }
+
+        const auto count = fullHashes.size();
+        const auto chunkCount = (count + CHUNK_SIZE - 1) / CHUNK_SIZE;
+        const auto hashChunk = [&](const size_t chunk) {
+            const auto start = chunk * CHUNK_SIZE;
+            const auto end = std::min(start + CHUNK_SIZE, count);
+            HashRange(blob.data(), offsets, fullHashes, start, end);
+        };
+
+        if (chunkCount <= 1 || pool.GetThreadCount() == 1)
+        {
+            for (size_t chunk = 0; chunk < chunkCount; chunk++)
+            {
+                hashChunk(chunk);
+            }
+
+            return;
+        }
+
+        pool.ParallelFor(chunkCount, hashChunk);
+    }
+
+private:
+    static constexpr uint64_t TYPE_HASH_MASK = ~LmAssetID::NAME_HASH_MASK;
+
+    /**
+     * Generates the name hashes of a range of URIs, LANES at a time.
+     * @remarks The whole range is lowercased up front, so that each character
+     * only costs the FNV1A update in each lane.
+     */
+    static void HashRange(const char* blob,
+                          const std::span<const size_t> offsets,
+                          const std::span<uint64_t> fullHashes,
+                          const size_t start, const size_t end)
+    {
+        const auto base = offsets[start];
+        std::string lowered(offsets[end] - base, '\0');
+        Core::ToLowerAscii(blob + base, lowered.data(), lowered.size());
+
+        const auto getUri = [&](const size_t i) {
+            return std::string_view(lowered).substr(
+                offsets[i] - base, offsets[i + 1] - offsets[i]);
+        };
+
+        auto i = start;
+        for (; i + LANES <= end; i += LANES)
+        {
+            std::string_view uris[LANES];
+            uint64_t hashes[LANES];
+            auto shared = SIZE_MAX;
+            for (size_t lane = 0; lane < LANES; lane++)
+            {
+                uris[lane] = getUri(i + lane);
+                hashes[lane] = LmAssetID::NAME_HASH_OFFSET_BASIS;
+                shared = std::min(shared, uris[lane].size());
+            }
+
+            // Hash the length that every lane has together, then the rest
+            for (size_t c = 0; c < shared; c++)
+            {
+                for (size_t lane = 0; lane < LANES; lane++)
+                {
+                    hashes[lane] =
+                        Core::Fnv1a64Combine(hashes[lane], uris[lane][c]);
+                }
+            }
+
+            for (size_t lane = 0; lane < LANES; lane++)
+            {
+                for (auto c = shared; c < uris[lane].size(); c++)
+                {
+                    hashes[lane] =
+                        Core::Fnv1a64Combine(hashes[lane], uris[lane][c]);
+                }
+
+                Combine(fullHashes[i + lane], hashes[lane]);
+            }
+        }
+
+        for (; i < end; i++)
+        {
+            auto hash = LmAssetID::NAME_HASH_OFFSET_BASIS;
+            for (const auto character : getUri(i))
+            {
+                hash = Core::Fnv1a64Combine(hash, character);
+            }
+
+            Combine(fullHashes[i], hash);
+        }
+    }
+
+    /**
+     * Combines a URI hash with a full hash, keeping any URI hash that was
+     * already set, as LmAssetID::GetNameHash does.
+     */
+    static void Combine(uint64_t& fullHash, const uint64_t hash)
+    {
+        if ((fullHash & LmAssetID::NAME_HASH_MASK) == 0)
+        {
+            fullHash = (fullHash & TYPE_HASH_MASK) |
+                       (hash & LmAssetID::NAME_HASH_MASK);
+        }
+    }
+};
+} // namespace SQEX::Luminous::AssetManager
+
+#endif // LMASSETIDBATCH_H
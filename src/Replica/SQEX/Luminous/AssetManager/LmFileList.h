@@ -1,11 +1,17 @@
 ﻿#ifndef LMFILELIST_H
 #define LMFILELIST_H
 
+#include <algorithm>
+#include <bit>
+#include <span>
+#include <string_view>
 #include <vector>
 
 #include "LmAssetID.h"
 
+#include "../AssetManager.h"
 #include "../../../../Host.h"
+#include "../../../../Logging/Trace.h"
 
 using LmAssetId = SQEX::Luminous::AssetManager::LmAssetID;
 
@@ -17,6 +23,10 @@ namespace SQEX::Luminous::AssetManager
 class LmFileList
 {
 private:
+    // x64 has a single calling convention, so this builds for the tools too
+    using AcquireAsset_t = void* (*)(void* pAssetManager, LmAssetID*, uint64_t,
+                                     int64_t);
+
     inline static bool hasInitializedVector_;
 
 public:
@@ -27,6 +37,115 @@ public:
      * appear to exist in release.
      */
     static void AddPatchIndexEarc(LmAssetID* lmAssetID)
+    {
+        // Add the URI hash to the patch index list
+        uint64_t result;
+        const auto nameHash = LmAssetID::GetNameHash(lmAssetID, &result);
+        GetPatchIndexEarcList()->push_back(nameHash);
+    }
+
+    /**
+     * Adds many patch index archives to the asset manager's file list, and has
+     * the asset manager acquire each of them.
+     * @param ids The identifiers of the patch index assets.
+     * @return The number of archives that were added, which excludes those
+     * that were given more than once.
+     * @remarks Archives keep the order they are given in, as later archives
+     * take priority. Each added archive is acquired as the patch hooks used to
+     * do one at a time. Archives that are already in the list are added again,
+     * as AddPatchIndexEarc does, as they may not have been acquired.
+     */
+    static size_t AddPatchIndexEarcs(const std::span<LmAssetID> ids)
+    {
+        const TraceScope scope("LmFileList::AddPatchIndexEarcs");
+        const auto added = AppendPatchIndices(*GetPatchIndexEarcList(), ids);
+
+        // This call is needed to finish this off, but it's not 100% clear
+        // what it does
+        const auto assetManager = LmGetAssetManager();
+        const auto assetManagerBaseAddress =
+            *static_cast<uint64_t*>(assetManager);
+        const auto acquireAsset =
+            *reinterpret_cast<AcquireAsset_t*>(assetManagerBaseAddress + 8);
+        for (const auto index : added)
+        {
+            acquireAsset(assetManager, &ids[index], 0, 2);
+        }
+
+        return added.size();
+    }
+
+    /**
+     * Adds many patch index archives by their URIs.
+     * @param uris The URIs of the patch index assets.
+     * @return The number of archives that were added.
+     */
+    static size_t AddPatchIndexEarcs(
+        const std::span<const std::string_view> uris)
+    {
+        std::vector<LmAssetID> ids;
+        ids.reserve(uris.size());
+        for (const auto uri : uris)
+        {
+            ids.push_back(LmAssetID::Create(uri));
+        }
+
+        return AddPatchIndexEarcs(ids);
+    }
+
+    /**
+     * Appends the URI hashes of patch index archives to a patch index list.
+     * @param list The patch index list.
+     * @param ids The identifiers of the patch index assets. Any that have not
+     * been hashed are hashed first, and keep their hash.
+     * @return The indices of the identifiers that were appended, in order,
+     * which excludes those that were given more than once.
+     * @remarks The list grows with a single insert, so it is reallocated at
+     * most once however many archives are appended.
+     */
+    static std::vector<size_t> AppendPatchIndices(
+        std::vector<uint64_t>& list, const std::span<LmAssetID> ids)
+    {
+        // Patch index URIs are few and short, so interleaving their hashes
+        // with LmAssetIDBatch costs more than it saves
+        std::vector<size_t> added;
+        std::vector<uint64_t> addedHashes;
+        added.reserve(ids.size());
+        addedHashes.reserve(ids.size());
+
+        // Find duplicates with an open-addressed set of at most half load,
+        // which stores each hash plus one so that zero marks an empty slot
+        const auto slotCount =
+            std::bit_ceil(std::max<size_t>(ids.size() * 2, 2));
+        const auto shift = 64 - std::countr_zero(slotCount);
+        std::vector<uint64_t> seen(slotCount);
+        for (size_t i = 0; i < ids.size(); i++)
+        {
+            uint64_t nameHash;
+            LmAssetID::GetNameHash(&ids[i], &nameHash);
+            auto slot = (nameHash * 0x9E3779B97F4A7C15) >> shift;
+            while (seen[slot] != 0 && seen[slot] != nameHash + 1)
+            {
+                slot = (slot + 1) & (slotCount - 1);
+            }
+
+            if (seen[slot] == 0)
+            {
+                seen[slot] = nameHash + 1;
+                added.push_back(i);
+                addedHashes.push_back(nameHash);
+            }
+        }
+
+        list.insert(list.end(), addedHashes.begin(), addedHashes.end());
+        return added;
+    }
+
+private:
+    /**
+     * Gets the asset manager's list of patch index archives.
+     */
+    static std::vector<uint64_t>* GetPatchIndexEarcList()
     {
         // Grab the patch index list
         const auto lmFileList =
@@ -42,10 +161,7 @@ public:
             *pPatchIndexEarcList = std::vector<uint64_t>();
         }
 
-        // Add the URI hash to the patch index list
-        uint64_t result;
-        const auto nameHash = LmAssetID::GetNameHash(lmAssetID, &result);
-        pPatchIndexEarcList->push_back(nameHash);
+        return pPatchIndexEarcList;
     }
 };
 } // namespace SQEX::Luminous::AssetManager
@@ -0,0 +1,223 @@
+#ifndef LMURIARENA_H
+#define LMURIARENA_H
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <mutex>
+#include <string_view>
+#include <vector>
+
+#include "LmAssetID.h"
+
+namespace SQEX::Luminous::AssetManager
+{
+/**
+ * Stores each distinct asset URI once, for the rest of the session.
+ * @remarks URIs are copied into large blocks with a bump pointer, so interning
+ * a URI allocates only when a block fills up, and blocks are never freed or
+ * moved, so the views that are handed out stay valid. Duplicates are found
+ * with an open addressing table keyed by the name hash of the URI, which
+ * LmAssetRef needs anyway.
+ */
+class LmUriArena
+{
+public:
+    /**
+     * The size of each block that URIs are copied into.
+     */
+    static constexpr size_t BLOCK_SIZE = 64 * 1024;
+
+    /**
+     * Represents a URI that has been interned.
+     */
+    struct Entry
+    {
+        /**
+         * The URI, which is followed by a null character in the arena.
+         */
+        std::string_view Uri;
+
+        /**
+         * The name hash of the URI, as LmAssetID::GenerateNameHash computes.
+         */
+        uint64_t NameHash;
+    };
+
+    /**
+     * Represents how much memory the arena uses.
+     */
+    struct Statistics
+    {
+        size_t Count;
+        size_t UriBytes;
+        size_t BlockBytes;
+        size_t TableBytes;
+    };
+
+private:
+    std::mutex mutex_;
+    std::vector<std::unique_ptr<char[]>> blocks_;
+    char* next_{nullptr};
+    size_t remaining_{0};
+    std::vector<Entry> table_;
+    Statistics statistics_{};
+
+public:
+    LmUriArena() = default;
+
+    /**
+     * Gets the arena shared by the session.
+     */
+    static LmUriArena& GetInstance()
+    {
+        static LmUriArena instance;
+        return instance;
+    }
+
+    LmUriArena(const LmUriArena&) = delete;
+
+    LmUriArena& operator=(const LmUriArena&) = delete;
+
+    /**
+     * Gets the interned copy of a URI, adding it if needed.
+     * @param uri The URI, which must not contain null characters.
+     * @return The interned URI and its name hash.
+     */
+    Entry Intern(const std::string_view uri)
+    {
+        const auto nameHash =
+            Core::Fnv1a64LowerFast(uri, LmAssetID::NAME_HASH_OFFSET_BASIS) &
+            LmAssetID::NAME_HASH_MASK;
+
+        std::lock_guard lock(mutex_);
+        if ((statistics_.Count + 1) * 2 > table_.size())
+        {
+            Grow();
+        }
+
+        // URIs that only differ by case share a hash, so compare them too
+        const auto mask = table_.size() - 1;
+        auto slot = nameHash & mask;
+        for (; table_[slot].Uri.data(); slot = (slot + 1) & mask)
+        {
+            if (table_[slot].NameHash == nameHash && table_[slot].Uri == uri)
+            {
+                return table_[slot];
+            }
+        }
+
+        table_[slot] = {Copy(uri), nameHash};
+        statistics_.Count++;
+        statistics_.UriBytes += uri.size() + 1;
+        return table_[slot];
+    }
+
+    /**
+     * Gets how much memory the arena uses.
+     */
+    [[nodiscard]] Statistics GetStatistics()
+    {
+        std::lock_guard lock(mutex_);
+        auto statistics = statistics_;
+        statistics.TableBytes = table_.capacity() * sizeof(Entry);
+        return statistics;
+    }
+
+private:
+    std::string_view Copy(const std::string_view uri)
+    {
+        const auto size = uri.size() + 1;
+        if (size > remaining_)
+        {
+            // Give URIs that would waste most of a block their own block
+            const auto blockSize = std::max(size, BLOCK_SIZE);
+            blocks_.push_back(std::make_unique<char[]>(blockSize));
+            statistics_.BlockBytes += blockSize;
+            next_ = blocks_.back().get();
+            remaining_ = blockSize;
+        }
+
+        const auto copy = next_;
+        std::memcpy(copy, uri.data(), uri.size());
+        copy[uri.size()] = '\0';
+        next_ += size;
+        remaining_ -= size;
+        return {copy, uri.size()};
+    }
+
+    void Grow()
+    {
+        std::vector<Entry> table(std::max<size_t>(table_.size() * 2, 1024));
+        const auto mask = table.size() - 1;
+        for (const auto& entry : table_)
+        {
+            if (entry.Uri.data())
+            {
+                auto slot = entry.NameHash & mask;
+                while (table[slot].Uri.data())
+                {
+                    slot = (slot + 1) & mask;
+                }
+
+                table[slot] = entry;
+            }
+        }
+
+        table_ = std::move(table);
+    }
+};
+
+/**
+ * Represents an identifier for a game asset whose URI is interned in an
+ * LmUriArena, without owning any memory.
+ * @remarks This is smaller than LmAssetID, owns no memory, and creating one
+ * never allocates once its URI has been interned. It should be converted to
+ * an LmAssetID only where the engine needs its layout.
+ */
+struct LmAssetRef
+{
+    /**
+     * The raw value of the asset ID, as in LmAssetID.
+     */
+    uint64_t fullHash_;
+
+    /**
+     * The URI associated with the asset, which is followed by a null
+     * character.
+     */
+    std::string_view m_path;
+
+    /**
+     * Creates an asset ID for a URI, interning the URI if needed.
+     * @param uri The URI of the asset.
+     * @param arena The arena to intern the URI in.
+     * @return The asset ID, with its name hash already computed.
+     */
+    static LmAssetRef Create(const std::string_view uri,
+                             LmUriArena& arena = LmUriArena::GetInstance())
+    {
+        const auto entry = arena.Intern(uri);
+        return {entry.NameHash, entry.Uri};
+    }
+
+    /**
+     * Gets the URI hash of the asset.
+     */
+    [[nodiscard]] uint64_t GetNameHash() const
+    {
+        return fullHash_ & LmAssetID::NAME_HASH_MASK;
+    }
+
+    /**
+     * Creates an asset ID with the layout that the engine uses.
+     * @return The asset ID, with the same URI and hash.
+     */
+    [[nodiscard]] LmAssetID ToAssetID() const
+    {
+        return LmAssetID::Create(m_path.data(), fullHash_);
+    }
+};
+} // namespace SQEX::Luminous::AssetManager
+
+#endif // LMURIARENA_H
@@ -1,6 +1,13 @@
 ﻿#ifndef CORE_H
 #define CORE_H
+#include <cstddef>
 #include <cstdint>
+#include <string_view>
+
+#if defined(_M_X64) || defined(__x86_64__)
+#define LUMINOUS_CORE_X64
+#include <emmintrin.h>
+#endif
 
 namespace SQEX::Luminous::Core
 {
@@ -32,6 +39,122 @@ inline uint64_t Fnv1a64Lower(const char* pString, uint64_t offsetBasis)
     // Return the final hash
     return offsetBasis;
 }
+
+/**
+ * The FNV1A prime used by Fnv1a64Lower.
+ */
+constexpr uint64_t FNV1A64_PRIME = 0x100000001B3;
+
+/**
+ * Updates an FNV1A hash with a character that has already been lowercased.
+ * @remarks The engine hashes characters as signed, so bytes from 0x80 upwards
+ * are sign extended before they are combined with the hash.
+ */
+constexpr uint64_t Fnv1a64Combine(const uint64_t hash, const char character)
+{
+    const auto value =
+        static_cast<int64_t>(static_cast<signed char>(character));
+    return FNV1A64_PRIME * (static_cast<uint64_t>(value) ^ hash);
+}
+
+/**
+ * Converts an uppercase ASCII letter to lowercase without a branch.
+ */
+constexpr char ToLowerAscii(const char character)
+{
+    const auto isUpper = static_cast<uint8_t>(character - 'A') <= 'Z' - 'A';
+    return static_cast<char>(character + isUpper * ('a' - 'A'));
+}
+
+/**
+ * Converts the uppercase ASCII letters in a string to lowercase.
+ * @param source The string to convert.
+ * @param destination Where to write the converted string, which may be the
+ * same as the source.
+ * @param size The size of the string.
+ * @remarks Converts 16 characters at a time with SSE2 and no branches.
+ */
+inline void ToLowerAscii(const char* source, char* destination,
+                         const size_t size)
+{
+    size_t i = 0;
+
+#ifdef LUMINOUS_CORE_X64
+    // Shift into the signed range so that 'A' to 'Z' is a single comparison
+    const auto bias = _mm_set1_epi8(static_cast<char>(0x80 - 'A'));
+    const auto limit = _mm_set1_epi8(static_cast<char>(0x80 + 'Z' - 'A' + 1));
+    const auto offset = _mm_set1_epi8('a' - 'A');
+
+    for (; i + 16 <= size; i += 16)
+    {
+        const auto block =
+            _mm_loadu_si128(reinterpret_cast<const __m128i*>(source + i));
+        const auto isUpper = _mm_cmplt_epi8(_mm_add_epi8(block, bias), limit);
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(destination + i),
+                         _mm_add_epi8(block, _mm_and_si128(isUpper, offset)));
+    }
+#endif
+
+    for (; i < size; i++)
+    {
+        destination[i] = ToLowerAscii(source[i]);
+    }
+}
+
+/**
+ * Generates the same hash as Fnv1a64Lower at compile time.
+ * @param string The string to hash, which ends at its first null character.
+ * @param offsetBasis The FNV1A offset basis to use for the hash calculation.
+ * @return The computed hash.
+ */
+constexpr uint64_t Fnv1a64LowerConstexpr(const std::string_view string,
+                                         uint64_t offsetBasis)
+{
+    for (const auto character : string)
+    {
+        if (character == '\0')
+        {
+            break;
+        }
+
+        offsetBasis = Fnv1a64Combine(offsetBasis, ToLowerAscii(character));
+    }
+
+    return offsetBasis;
+}
+
+/**
+ * Generates the same hash as Fnv1a64Lower for a string of known size.
+ * @param string The string to hash, which must not contain null characters.
+ * @param offsetBasis The FNV1A offset basis to use for the hash calculation.
+ * @return The computed hash.
+ * @remarks The string is lowercased 16 characters at a time, which leaves
+ * only the multiply chain of FNV1A, and is not scanned for its terminator.
+ */
+inline uint64_t Fnv1a64LowerFast(const std::string_view string,
+                                 uint64_t offsetBasis)
+{
+    constexpr size_t width = 16;
+    auto data = string.data();
+    auto remaining = string.size();
+
+    char lowered[width];
+    for (; remaining >= width; data += width, remaining -= width)
+    {
+        ToLowerAscii(data, lowered, width);
+        for (const auto character : lowered)
+        {
+            offsetBasis = Fnv1a64Combine(offsetBasis, character);
+        }
+    }
+
+    for (; remaining > 0; data++, remaining--)
+    {
+        offsetBasis = Fnv1a64Combine(offsetBasis, ToLowerAscii(*data));
+    }
+
+    return offsetBasis;
+}
 } // namespace SQEX::Luminous::Core
 
 #endif // CORE_H
@@ -0,0 +1,163 @@
+#ifndef INITIALIZATIONGATE_H
+#define INITIALIZATIONGATE_H
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdio>
+#include <functional>
+#include <mutex>
+#include <thread>
+
+#include "../Logging/Trace.h"
+
+/**
+ * Runs initialization on a background thread, and lets game code that depends
+ * on it wait until it has finished.
+ * @remarks The time from Begin to the gate opening, the part of it that was
+ * spent before the background thread started, and the time that game threads
+ * spent waiting at the gate are all recorded, so it is clear how much of the
+ * startup cost is still on the critical path.
+ */
+class InitializationGate
+{
+public:
+    /**
+     * Represents how long initialization took.
+     */
+    struct Statistics
+    {
+        double SynchronousMilliseconds;
+        double TotalMilliseconds;
+        double BlockedMilliseconds;
+    };
+
+private:
+    std::mutex mutex_;
+    std::condition_variable condition_;
+    std::atomic<bool> isOpen_{false};
+    std::chrono::steady_clock::time_point start_;
+    Statistics statistics_{};
+    bool isReporting_{false};
+
+    InitializationGate() = default;
+
+public:
+    static InitializationGate& GetInstance()
+    {
+        static InitializationGate instance;
+        return instance;
+    }
+
+    InitializationGate(const InitializationGate&) = delete;
+
+    InitializationGate& operator=(const InitializationGate&) = delete;
+
+    /**
+     * Sets whether the timings are printed to the console.
+     */
+    void SetIsReporting(const bool isReporting)
+    {
+        isReporting_ = isReporting;
+    }
+
+    /**
+     * Marks the start of initialization.
+     */
+    void Begin()
+    {
+        start_ = std::chrono::steady_clock::now();
+    }
+
+    /**
+     * Runs the rest of initialization on a background thread, and opens the
+     * gate once it has finished.
+     * @param work The initialization to run.
+     * @remarks This is safe to call while the loader lock is held, as the
+     * thread does not run until it is released.
+     */
+    void Start(std::function<void()> work)
+    {
+        statistics_.SynchronousMilliseconds = GetElapsedMilliseconds(start_);
+        std::thread([this, work = std::move(work)] {
+            work();
+            Open();
+        }).detach();
+    }
+
+    /**
+     * Blocks until initialization has finished.
+     * @remarks Returns immediately once the gate is open.
+     */
+    void Wait()
+    {
+        if (isOpen_.load(std::memory_order_acquire))
+        {
+            return;
+        }
+
+        const TraceScope scope("InitializationGate::Wait");
+        const auto start = std::chrono::steady_clock::now();
+        {
+            std::unique_lock lock(mutex_);
+            condition_.wait(lock, [this] {
+                return isOpen_.load(std::memory_order_acquire);
+            });
+            statistics_.BlockedMilliseconds += GetElapsedMilliseconds(start);
+        }
+
+        if (isReporting_)
+        {
+            std::printf("[Drautos] Game waited %.3f ms for initialization\n",
+                        GetElapsedMilliseconds(start));
+        }
+    }
+
+    /**
+     * Whether initialization has finished.
+     */
+    [[nodiscard]] bool IsOpen() const
+    {
+        return isOpen_.load(std::memory_order_acquire);
+    }
+
+    /**
+     * Gets how long initialization took.
+     * @remarks BlockedMilliseconds keeps growing while threads are waiting.
+     */
+    [[nodiscard]] Statistics GetStatistics()
+    {
+        std::lock_guard lock(mutex_);
+        return statistics_;
+    }
+
+private:
+    void Open()
+    {
+        {
+            std::lock_guard lock(mutex_);
+            statistics_.TotalMilliseconds = GetElapsedMilliseconds(start_);
+            isOpen_.store(true, std::memory_order_release);
+        }
+
+        condition_.notify_all();
+
+        if (isReporting_)
+        {
+            std::printf("[Drautos] Initialized in %.3f ms, %.3f ms of which "
+                        "blocked the loader\n",
+                        statistics_.TotalMilliseconds,
+                        statistics_.SynchronousMilliseconds);
+        }
+    }
+
+    static double GetElapsedMilliseconds(
+        const std::chrono::steady_clock::time_point start)
+    {
+        const std::chrono::duration<double, std::milli> elapsed =
+            std::chrono::steady_clock::now() - start;
+        return elapsed.count();
+    }
+};
+
+#endif // INITIALIZATIONGATE_H
@@ -0,0 +1,206 @@
+#ifndef THREADPOOL_H
+#define THREADPOOL_H
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <exception>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+/**
+ * A fixed set of worker threads that run loops in parallel.
+ * @remarks The calling thread always takes part in the loop, so a loop will
+ * still complete if the workers are unable to run, such as while the loader
+ * lock is held in DllMain.
+ */
+class ThreadPool
+{
+private:
+    std::vector<std::thread> workers_;
+    std::mutex submitMutex_;
+    std::mutex mutex_;
+    std::condition_variable wake_;
+    std::condition_variable done_;
+
+    const std::function<void(size_t)>* body_{nullptr};
+    size_t count_{0};
+    std::atomic<size_t> next_{0};
+    size_t completed_{0};
+    size_t active_{0};
+    uint64_t generation_{0};
+    std::exception_ptr exception_;
+    bool isStopping_{false};
+
+public:
+    /**
+     * The number of threads used by the shared instance, including the calling
+     * thread, or 0 to use every hardware thread.
+     * @remarks Must be set before the first call to GetInstance.
+     */
+    inline static size_t DefaultThreadCount = 0;
+
+    /**
+     * Instantiates a thread pool.
+     * @param threadCount The number of threads that run each loop, including
+     * the calling thread, or 0 to use every hardware thread.
+     */
+    explicit ThreadPool(size_t threadCount = 0)
+    {
+        if (threadCount == 0)
+        {
+            threadCount = std::max(1u, std::thread::hardware_concurrency());
+        }
+
+        for (size_t i = 1; i < threadCount; i++)
+        {
+            workers_.emplace_back([this] { RunWorker(); });
+        }
+    }
+
+    ~ThreadPool()
+    {
+        {
+            std::lock_guard lock(mutex_);
+            isStopping_ = true;
+        }
+
+        wake_.notify_all();
+        for (auto& worker : workers_)
+        {
+            worker.join();
+        }
+    }
+
+    ThreadPool(const ThreadPool&) = delete;
+
+    ThreadPool& operator=(const ThreadPool&) = delete;
+
+    /**
+     * Gets the thread pool shared by Drautos.
+     * @return The shared instance, sized by DefaultThreadCount.
+     */
+    static ThreadPool& GetInstance()
+    {
+        static ThreadPool instance(DefaultThreadCount);
+        return instance;
+    }
+
+    /**
+     * Gets the number of threads that run each loop, including the calling
+     * thread.
+     */
+    [[nodiscard]] size_t GetThreadCount() const
+    {
+        return workers_.size() + 1;
+    }
+
+    /**
+     * Runs the body once for each index, spread across the pool.
+     * @param count The number of indices.
+     * @param body The function to run for each index.
+     * @remarks Blocks until every index has completed. If any call throws, the
+     * first exception is rethrown once the loop has finished.
+     */
+    void ParallelFor(const size_t count,
+                     const std::function<void(size_t)>& body)
+    {
+        if (count == 0)
+        {
+            return;
+        }
+
+        std::lock_guard submitLock(submitMutex_);
+
+        {
+            std::lock_guard lock(mutex_);
+            body_ = &body;
+            count_ = count;
+            next_ = 0;
+            completed_ = 0;
+            exception_ = nullptr;
+            generation_++;
+        }
+
+        wake_.notify_all();
+        RunLoop();
+
+        // Wait for the workers that joined the loop to leave it
+        std::unique_lock lock(mutex_);
+        done_.wait(lock, [this] { return completed_ == count_ && active_ == 0; });
+        body_ = nullptr;
+
+        if (exception_)
+        {
+            std::rethrow_exception(exception_);
+        }
+    }
+
+private:
+    void RunWorker()
+    {
+        uint64_t generation = 0;
+
+        while (true)
+        {
+            {
+                std::unique_lock lock(mutex_);
+                wake_.wait(lock, [&] {
+                    return isStopping_ ||
+                           (body_ && generation_ != generation);
+                });
+
+                if (isStopping_)
+                {
+                    return;
+                }
+
+                generation = generation_;
+                active_++;
+            }
+
+            RunLoop();
+
+            {
+                std::lock_guard lock(mutex_);
+                active_--;
+            }
+
+            done_.notify_all();
+        }
+    }
+
+    void RunLoop()
+    {
+        size_t completed = 0;
+
+        for (auto i = next_++; i < count_; i = next_++)
+        {
+            try
+            {
+                (*body_)(i);
+            }
+            catch (...)
+            {
+                std::lock_guard lock(mutex_);
+                if (!exception_)
+                {
+                    exception_ = std::current_exception();
+                }
+            }
+
+            completed++;
+        }
+
+        if (completed > 0)
+        {
+            std::lock_guard lock(mutex_);
+            completed_ += completed;
+        }
+    }
+};
+
+#endif // THREADPOOL_H
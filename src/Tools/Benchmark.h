@@ -0,0 +1,287 @@
+#ifndef BENCHMARK_H
+#define BENCHMARK_H
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <fstream>
+#include <functional>
+#include <map>
+#include <sstream>
+#include <string>
+#include <vector>
+
+/**
+ * Times workloads and compares them against results from a previous run.
+ * @remarks Each workload is repeated until it has run for a minimum amount of
+ * time, and the median iteration is used for comparisons as it is the least
+ * sensitive to noise from the rest of the system.
+ */
+class Benchmark
+{
+public:
+    /**
+     * Represents the timings of a single workload.
+     */
+    struct Result
+    {
+        std::string Name;
+        uint64_t Bytes;
+        size_t Iterations;
+        double MinNanoseconds;
+        double MedianNanoseconds;
+        double MeanNanoseconds;
+        uint64_t Items;
+
+        /**
+         * Gets the throughput of the median iteration.
+         * @return The number of bytes processed per second, in GiB, or 0 if
+         * the workload does not process a known number of bytes.
+         */
+        [[nodiscard]] double GetThroughput() const
+        {
+            return MedianNanoseconds > 0
+                       ? Bytes / 1073741824.0 / (MedianNanoseconds / 1e9)
+                       : 0;
+        }
+
+        /**
+         * Gets the item rate of the median iteration.
+         * @return The number of items processed per second, in millions, or 0
+         * if the workload does not process a known number of items.
+         */
+        [[nodiscard]] double GetItemRate() const
+        {
+            return MedianNanoseconds > 0
+                       ? Items / 1e6 / (MedianNanoseconds / 1e9)
+                       : 0;
+        }
+    };
+
+private:
+    std::string filter_;
+    double minSeconds_;
+    size_t maxIterations_;
+    std::vector<Result> results_;
+
+public:
+    /**
+     * Instantiates a benchmark suite.
+     * @param filter Only workloads whose names contain this are run.
+     * @param minSeconds The minimum time to spend repeating each workload.
+     * @param maxIterations The maximum number of times to repeat each
+     * workload.
+     */
+    explicit Benchmark(std::string filter = {}, const double minSeconds = 0.5,
+                       const size_t maxIterations = 1000)
+        : filter_(std::move(filter)), minSeconds_(minSeconds),
+          maxIterations_(std::max<size_t>(maxIterations, 1))
+    {
+    }
+
+    /**
+     * Whether a workload would be run by this suite.
+     * @param name The name of the workload.
+     */
+    [[nodiscard]] bool IsEnabled(const std::string& name) const
+    {
+        return name.find(filter_) != std::string::npos;
+    }
+
+    /**
+     * Times a workload.
+     * @param name The unique name of the workload.
+     * @param bytes The number of bytes processed by each iteration, or 0.
+     * @param body The workload to time.
+     * @param setup Runs before each iteration without being timed, such as to
+     * restore state that the workload modifies.
+     * @param items The number of items processed by each iteration, or 0.
+     */
+    void Run(const std::string& name, const uint64_t bytes,
+             const std::function<void()>& body,
+             const std::function<void()>& setup = {}, const uint64_t items = 0)
+    {
+        if (!IsEnabled(name))
+        {
+            return;
+        }
+
+        // Warm up caches and lazily initialized state
+        if (setup)
+        {
+            setup();
+        }
+
+        body();
+
+        std::vector<double> times;
+        double total = 0;
+        while (times.size() < maxIterations_ &&
+               (times.empty() || total < minSeconds_ * 1e9))
+        {
+            if (setup)
+            {
+                setup();
+            }
+
+            const auto start = std::chrono::steady_clock::now();
+            body();
+            const std::chrono::duration<double, std::nano> elapsed =
+                std::chrono::steady_clock::now() - start;
+
+            times.push_back(elapsed.count());
+            total += elapsed.count();
+        }
+
+        std::sort(times.begin(), times.end());
+        const Result result{name,
+                            bytes,
+                            times.size(),
+                            times.front(),
+                            times[times.size() / 2],
+                            total / static_cast<double>(times.size()),
+                            items};
+        results_.push_back(result);
+
+        std::printf("%-56s %12.3f ms", name.c_str(),
+                    result.MedianNanoseconds / 1e6);
+        if (bytes > 0)
+        {
+            std::printf(" %9.2f GiB/s", result.GetThroughput());
+        }
+
+        if (items > 0)
+        {
+            std::printf(" %9.2f M/s", result.GetItemRate());
+        }
+
+        std::printf("\n");
+        std::fflush(stdout);
+    }
+
+    /**
+     * Gets the results of every workload that has been run.
+     */
+    [[nodiscard]] const std::vector<Result>& GetResults() const
+    {
+        return results_;
+    }
+
+    /**
+     * Writes the results as JSON.
+     * @param path Path to the file to write.
+     * @return True if the file was written.
+     */
+    bool WriteJson(const std::string& path) const
+    {
+        std::ofstream stream(path);
+        stream << "{\n  \"version\": 1,\n  \"benchmarks\": [";
+
+        for (size_t i = 0; i < results_.size(); i++)
+        {
+            const auto& result = results_[i];
+            stream << (i == 0 ? "\n" : ",\n") << "    {\"name\": \""
+                   << result.Name << "\", \"bytes\": " << result.Bytes
+                   << ", \"iterations\": " << result.Iterations
+                   << ", \"min_ns\": " << Format(result.MinNanoseconds)
+                   << ", \"median_ns\": " << Format(result.MedianNanoseconds)
+                   << ", \"mean_ns\": " << Format(result.MeanNanoseconds)
+                   << ", \"gib_per_s\": " << Format(result.GetThroughput())
+                   << ", \"items\": " << result.Items
+                   << ", \"million_items_per_s\": "
+                   << Format(result.GetItemRate()) << "}";
+        }
+
+        stream << "\n  ]\n}\n";
+        return static_cast<bool>(stream);
+    }
+
+    /**
+     * Compares the results against a file written by WriteJson.
+     * @param path Path to the baseline file.
+     * @param threshold How much slower a workload may be before it is
+     * considered a regression, as a fraction of the baseline.
+     * @return True if no workload regressed.
+     * @remarks Workloads that are not in the baseline are reported but never
+     * fail the comparison.
+     */
+    bool CompareToBaseline(const std::string& path,
+                           const double threshold) const
+    {
+        const auto baseline = ReadBaseline(path);
+        if (baseline.empty())
+        {
+            std::fprintf(stderr, "Failed to read baseline %s\n", path.c_str());
+            return false;
+        }
+
+        auto isValid = true;
+        std::printf("\n%-56s %12s %12s %8s\n", "Comparison to baseline",
+                    "baseline", "current", "change");
+
+        for (const auto& result : results_)
+        {
+            const auto entry = baseline.find(result.Name);
+            if (entry == baseline.end())
+            {
+                std::printf("%-56s %12s %9.3f ms %8s\n", result.Name.c_str(),
+                            "-", result.MedianNanoseconds / 1e6, "new");
+                continue;
+            }
+
+            const auto change =
+                result.MedianNanoseconds / entry->second - 1.0;
+            const auto isRegression = change > threshold;
+            isValid &= !isRegression;
+
+            std::printf("%-56s %9.3f ms %9.3f ms %+7.1f%%%s\n",
+                        result.Name.c_str(), entry->second / 1e6,
+                        result.MedianNanoseconds / 1e6, change * 100,
+                        isRegression ? "  REGRESSION" : "");
+        }
+
+        return isValid;
+    }
+
+private:
+    static std::string Format(const double value)
+    {
+        std::ostringstream stream;
+        stream.precision(17);
+        stream << value;
+        return stream.str();
+    }
+
+    /**
+     * Reads the median time of each workload from a file written by
+     * WriteJson.
+     * @remarks This only understands the layout that WriteJson produces, with
+     * one workload per line, rather than arbitrary JSON.
+     */
+    static std::map<std::string, double> ReadBaseline(const std::string& path)
+    {
+        std::map<std::string, double> medians;
+        std::ifstream stream(path);
+        std::string line;
+
+        while (std::getline(stream, line))
+        {
+            const auto name = line.find("\"name\": \"");
+            const auto median = line.find("\"median_ns\": ");
+            if (name == std::string::npos || median == std::string::npos)
+            {
+                continue;
+            }
+
+            const auto start = name + 9;
+            const auto end = line.find('"', start);
+            medians[line.substr(start, end - start)] =
+                std::stod(line.substr(median + 13));
+        }
+
+        return medians;
+    }
+};
+
+#endif // BENCHMARK_H
@@ -0,0 +1,2494 @@
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <cctype>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <exception>
+#include <filesystem>
+#include <fstream>
+#include <memory>
+#include <mutex>
+#include <numeric>
+#include <random>
+#include <span>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <unordered_set>
+#include <vector>
+
+#include "../Hooking/FunctionHook.h"
+#include "../Hooking/OneShotFunctionHook.h"
+#include "../Hooking/StaticExternFunctionHook.h"
+#include "../Hooking/StaticFunctionHook.h"
+#include "../IO/ArchivePrefetcher.h"
+#include "../IO/AssetAccessTrace.h"
+#include "../IO/AssetOverrideTable.h"
+#include "../IO/EarcArchive.h"
+#include "../IO/EarcDecompressor.h"
+#include "../IO/MappedFile.h"
+#include "../IO/PayloadCache.h"
+#include "../Patching/PatchRegistry.h"
+#include "../Replica/SQEX/Luminous/AssetManager/LmArcEntryFlags.h"
+#include "../Replica/SQEX/Luminous/AssetManager/LmAssetID.h"
+#include "../Replica/SQEX/Luminous/AssetManager/LmAssetIDBatch.h"
+#include "../Replica/SQEX/Luminous/AssetManager/LmFileList.h"
+#include "../Replica/SQEX/Luminous/AssetManager/LmUriArena.h"
+#include "../Replica/SQEX/Luminous/Core.h"
+#include "Benchmark.h"
+
+using SQEX::Luminous::AssetManager::LmArcEntryFlags;
+using SQEX::Luminous::AssetManager::LmAssetID;
+using SQEX::Luminous::AssetManager::LmAssetIDBatch;
+using SQEX::Luminous::AssetManager::LmAssetRef;
+using SQEX::Luminous::AssetManager::LmFileList;
+using SQEX::Luminous::AssetManager::LmUriArena;
+
+/**
+ * A game executable laid out at its RVAs, as if it had been loaded by Windows.
+ */
+class BenchmarkImage
+{
+private:
+    std::string name_;
+    std::vector<uint8_t> data_;
+
+    explicit BenchmarkImage(std::string name) : name_(std::move(name))
+    {
+    }
+
+public:
+    /**
+     * Creates an image with a single code section of random bytes that follow
+     * the byte frequencies of x64 code.
+     * @param size The size of the image, in bytes.
+     * @param seed The seed for the random bytes.
+     */
+    static BenchmarkImage CreateSynthetic(const size_t size,
+                                          const uint64_t seed)
+    {
+        constexpr uint8_t common[] = {
+            0x00, 0xFF, 0x48, 0x8B, 0x89, 0xCC, 0x0F, 0xE8, 0x24, 0x4C,
+            0x44, 0x41, 0x8D, 0x83, 0x85, 0xC0, 0x01, 0x20, 0x10, 0x08,
+            0x74, 0x75, 0x28, 0x30, 0x40, 0x38, 0x18, 0x49, 0x4D, 0x45};
+
+        BenchmarkImage image("synthetic_" + std::to_string(size >> 20) +
+                             "mb");
+        auto& data = image.data_;
+        data.resize(size);
+
+        // Three quarters of the bytes are drawn from the most common bytes
+        auto state = seed | 1;
+        for (size_t i = 0x1000; i < size; i++)
+        {
+            state ^= state << 13;
+            state ^= state >> 7;
+            state ^= state << 17;
+            const auto random = static_cast<uint32_t>(state >> 32);
+            data[i] = (random & 3) != 0
+                          ? common[(random >> 8) % sizeof(common)]
+                          : static_cast<uint8_t>(random >> 16);
+        }
+
+        // Write the headers of a PE32+ image with one code section
+        const auto write = [&](const size_t offset, const auto value) {
+            std::memcpy(&data[offset], &value, sizeof(value));
+        };
+
+        write(0x00, uint16_t{0x5A4D});
+        write(0x3C, uint32_t{0x80});
+        write(0x80, uint32_t{0x4550});
+        write(0x84, uint16_t{0x8664});
+        write(0x86, uint16_t{1});
+        write(0x94, uint16_t{0xF0});
+        write(0x98, uint16_t{0x20B});
+        write(0x98 + 24, uint64_t{0x140000000});
+        write(0x98 + 56, static_cast<uint32_t>(size));
+        write(0x98 + 108, uint32_t{16});
+
+        const size_t section = 0x98 + 0xF0;
+        std::memcpy(&data[section], ".text", 5);
+        write(section + 8, static_cast<uint32_t>(size - 0x1000));
+        write(section + 12, uint32_t{0x1000});
+        write(section + 16, static_cast<uint32_t>(size - 0x1000));
+        write(section + 20, uint32_t{0x1000});
+        write(section + 36, PeImage::SCN_CNT_CODE | PeImage::SCN_MEM_EXECUTE |
+                                PeImage::SCN_MEM_READ);
+
+        return image;
+    }
+
+    /**
+     * Lays out an executable from disk at its RVAs.
+     * @param path Path to the executable.
+     */
+    static BenchmarkImage CreateFromFile(const std::filesystem::path& path)
+    {
+        const MappedFile file(path);
+        const PeImage source(file.GetData(), file.GetSize(), PeImage::FILE);
+
+        BenchmarkImage image(path.stem().string());
+        image.data_.resize(source.GetSizeOfImage());
+
+        // The headers come before the first section in both layouts
+        auto headerSize = std::min<size_t>(file.GetSize(), 0x1000);
+        for (const auto& section : source.GetSections())
+        {
+            headerSize = std::min<size_t>(headerSize, section.VirtualAddress);
+        }
+
+        std::memcpy(image.data_.data(), file.GetData(), headerSize);
+        for (const auto& section : source.GetSections())
+        {
+            const auto [start, end] = source.GetSectionData(section);
+            const auto size = std::min<size_t>(
+                end - start,
+                image.data_.size() -
+                    std::min<size_t>(section.VirtualAddress,
+                                     image.data_.size()));
+            std::memcpy(image.data_.data() + section.VirtualAddress, start,
+                        size);
+        }
+
+        return image;
+    }
+
+    [[nodiscard]] const std::string& GetName() const
+    {
+        return name_;
+    }
+
+    [[nodiscard]] uint8_t* GetData()
+    {
+        return data_.data();
+    }
+
+    [[nodiscard]] size_t GetSize() const
+    {
+        return data_.size();
+    }
+
+    /**
+     * Writes a signature into the image, filling wildcards with a fixed byte.
+     * @param signature The signature to write.
+     * @param offset The offset to write the signature at.
+     */
+    void Plant(const SignatureView& signature, const size_t offset)
+    {
+        for (size_t i = 0; i < signature.GetSize(); i++)
+        {
+            data_[offset + i] =
+                signature.GetMasks()[i] ? signature.GetValues()[i] : 0x10;
+        }
+    }
+
+    /**
+     * Makes this image the module that signatures are searched for in.
+     */
+    void MakeHost()
+    {
+        Host::Initialize(data_.data(), static_cast<uint32_t>(data_.size()),
+                         Configuration::RELEASE);
+    }
+};
+
+/**
+ * A hook that is dispatched through its instance and a virtual call, as
+ * FunctionHook does.
+ */
+class VirtualDispatchHook final
+    : public Hooks::FunctionHook<0, 0, uint64_t, uint64_t>
+{
+protected:
+    uint64_t Detour(const uint64_t value) override
+    {
+        return original_(value) + 1;
+    }
+
+public:
+    bool ShouldApply() override
+    {
+        return true;
+    }
+};
+
+/**
+ * The same hook as VirtualDispatchHook, dispatched statically.
+ */
+class StaticDispatchHook final
+    : public Hooks::StaticFunctionHook<StaticDispatchHook, 0, 0, uint64_t,
+                                       uint64_t>
+{
+    friend StaticFunctionHook;
+
+protected:
+    static uint64_t Detour(const uint64_t value)
+    {
+        return original_(value) + 1;
+    }
+
+public:
+    bool ShouldApply() override
+    {
+        return true;
+    }
+};
+
+#ifdef _WIN32
+constexpr char EXTERN_DISPATCH_HOOK_MODULE[] = "ucrtbase.dll";
+#else
+constexpr char EXTERN_DISPATCH_HOOK_MODULE[] = "libc.so.6";
+#endif
+constexpr char EXTERN_DISPATCH_HOOK_FUNCTION[] = "llabs";
+
+/**
+ * The same hook as StaticDispatchHook, whose target is exported by the C
+ * runtime, as StaticExternFunctionHook finds it.
+ * @remarks llabs has the same calling convention as the other targets, so the
+ * target is replaced like theirs once it has been found.
+ */
+class StaticExternDispatchHook final
+    : public Hooks::StaticExternFunctionHook<
+          StaticExternDispatchHook, EXTERN_DISPATCH_HOOK_MODULE,
+          EXTERN_DISPATCH_HOOK_FUNCTION, uint64_t, uint64_t>
+{
+    friend StaticExternFunctionHook;
+
+protected:
+    static uint64_t Detour(const uint64_t value)
+    {
+        return original_(value) + 1;
+    }
+
+public:
+    bool ShouldApply() override
+    {
+        return true;
+    }
+};
+
+/**
+ * A hook that runs its work once behind a once flag on every call, as
+ * Patch1Hook used to.
+ * @remarks The RVAs differ from VirtualDispatchHook only so that the two are
+ * separate hooks, as the target is replaced before either is called.
+ */
+class CallOnceDispatchHook final
+    : public Hooks::FunctionHook<1, 1, uint64_t, uint64_t>
+{
+private:
+    std::once_flag hasRun_;
+
+protected:
+    uint64_t Detour(const uint64_t value) override
+    {
+        std::call_once(hasRun_, [] {});
+        return original_(value);
+    }
+
+public:
+    bool ShouldApply() override
+    {
+        return true;
+    }
+};
+
+/**
+ * The same hook as CallOnceDispatchHook, which removes itself after running.
+ */
+class OneShotDispatchHook final
+    : public Hooks::OneShotFunctionHook<OneShotDispatchHook, 0, 0, uint64_t,
+                                        uint64_t>
+{
+    friend OneShotFunctionHook;
+
+public:
+    /**
+     * The number of times that the action has run.
+     */
+    inline static std::atomic<size_t> ActionCount;
+
+protected:
+    static void Action(uint64_t)
+    {
+        ActionCount.fetch_add(1, std::memory_order_relaxed);
+    }
+
+public:
+    bool ShouldApply() override
+    {
+        return true;
+    }
+};
+
+/**
+ * Runs every benchmark workload.
+ */
+class DrautosBenchmark
+{
+private:
+    /**
+     * Represents a signature with a name to report it under.
+     */
+    struct NamedSignature
+    {
+        std::string Name;
+        SignatureView Signature;
+    };
+
+    Benchmark& benchmark_;
+
+public:
+    explicit DrautosBenchmark(Benchmark& benchmark) : benchmark_(benchmark)
+    {
+    }
+
+    /**
+     * Benchmarks creating the scanner for each signature.
+     */
+    void RunConstruction() const
+    {
+        for (const auto& [name, signature] : GetSignatures())
+        {
+            benchmark_.Run("signature/create_scanner/" + name, 0, [&] {
+                for (auto i = 0; i < 1000; i++)
+                {
+                    const auto scanner =
+                        MemorySignature(signature).CreateScanner();
+                    Consume(scanner.GetAnchorOffset());
+                }
+            });
+        }
+    }
+
+    /**
+     * Benchmarks finding signatures in an image.
+     * @param image The image to search.
+     * @param isSynthetic Whether the signatures should be planted in the
+     * image, so that each can be checked to have exactly one match.
+     * @return False if a signature was not found the expected number of times.
+     */
+    bool RunSignatures(BenchmarkImage& image, const bool isSynthetic) const
+    {
+        auto isValid = true;
+        const auto signatures = GetSignatures();
+        image.MakeHost();
+
+        // Plant one copy of each signature in the last quarter of the image
+        auto offset = image.GetSize() - image.GetSize() / 4;
+        for (const auto& [name, signature] : signatures)
+        {
+            if (isSynthetic)
+            {
+                image.Plant(signature, offset);
+                offset += 4096;
+            }
+        }
+
+        for (const auto& [name, signature] : signatures)
+        {
+            const auto suffix = name + "/" + image.GetName();
+            std::vector<uint8_t*> matches;
+            benchmark_.Run("find/" + suffix, image.GetSize(), [&] {
+                matches = MemorySignature(signature).Find({PeImage::CODE});
+            });
+
+            if (isSynthetic && benchmark_.IsEnabled("find/" + suffix) &&
+                matches.size() != 1)
+            {
+                std::fprintf(stderr, "Expected 1 match of %s, found %zu\n",
+                             name.c_str(), matches.size());
+                isValid = false;
+            }
+
+            // Measure each engine on a single thread without the thread pool
+            const PeImage peImage(image.GetData(), image.GetSize(),
+                                  PeImage::MAPPED);
+            const auto regions = PeSectionFilter{PeImage::CODE}.GetRegions(
+                peImage);
+            for (auto engine = SignatureScanner::SCALAR;
+                 engine <= SignatureScanner::GetBestEngine();
+                 engine = static_cast<SignatureScanner::Engine>(engine + 1))
+            {
+                const auto scanner = signature.CreateScanner(engine);
+                std::vector<const uint8_t*> results;
+                benchmark_.Run(
+                    "scan/" + std::string(GetEngineName(engine)) + "/" +
+                        suffix,
+                    image.GetSize(), [&] {
+                        results.clear();
+                        for (const auto& [start, end] : regions)
+                        {
+                            scanner.Scan(start, end, results);
+                        }
+                    });
+            }
+        }
+
+        return isValid;
+    }
+
+    /**
+     * Benchmarks calling a hooked function through each kind of hook, as if
+     * Detours had redirected the target function to it.
+     * @remarks If the benchmark was built with DRAUTOS_HOOK_STATISTICS, this
+     * includes the cost of recording them, and the statistics are printed.
+     * @return False if a hook did not find its target or did not remove
+     * itself.
+     */
+    bool RunHookDispatch() const
+    {
+        auto isValid = true;
+        using Function_t = uint64_t (*)(uint64_t);
+        VirtualDispatchHook virtualHook;
+        StaticDispatchHook staticHook;
+        StaticExternDispatchHook staticExternHook;
+        CallOnceDispatchHook callOnceHook;
+
+        const auto run = [&](const std::string& name,
+                             Hooks::IFunctionHook& hook) {
+            *hook.GetTargetFunctionPointerReference() =
+                reinterpret_cast<void*>(&HookTarget);
+            hook.OnAttaching();
+
+            // Call through a volatile pointer, as the game calls the target
+            // without knowing that it has been detoured
+            volatile auto detour =
+                reinterpret_cast<Function_t>(hook.GetDetourFunctionPointer());
+            benchmark_.Run("hook_dispatch/" + name + "/1000000", 0, [&] {
+                uint64_t value = 0;
+                for (auto i = 0; i < 1000000; i++)
+                {
+                    value = detour(value);
+                }
+
+                Consume(value);
+            });
+        };
+
+        run("virtual", virtualHook);
+        run("static", staticHook);
+
+        // The extern hook must have found llabs in the C runtime
+        using Llabs_t = long long (*)(long long);
+        const auto target = reinterpret_cast<Llabs_t>(
+            *staticExternHook.GetTargetFunctionPointerReference());
+        if (target(-5) == 5)
+        {
+            run("static_extern", staticExternHook);
+        }
+        else
+        {
+            std::fprintf(stderr, "Extern hook found the wrong target\n");
+            isValid = false;
+        }
+
+        run("call_once", callOnceHook);
+        isValid &= RunOneShotHook();
+
+        if constexpr (Hooks::HookStatistics::IS_ENABLED)
+        {
+            Hooks::HookStatistics::GetInstance().Print(stdout);
+        }
+
+        return isValid;
+    }
+
+    /**
+     * Attaches a one-shot hook to a function in a page of executable memory
+     * the way Detours would, calls it from several threads at once, and checks
+     * that the hook ran its action once and removed itself. The function is
+     * then benchmarked from the same page, as the game would call it after
+     * the hook has removed itself.
+     * @return False if the hook did not remove itself cleanly.
+     */
+    bool RunOneShotHook() const
+    {
+        using Function_t = uint64_t (*)(uint64_t);
+        constexpr size_t TRAMPOLINE_OFFSET = 64;
+        constexpr size_t STUB_OFFSET = 128;
+        constexpr size_t THREAD_COUNT = 8;
+
+        // mov rax, <first parameter>; xor rax, 0x5A; ret, as HookTarget does,
+        // padded with int3 to cover the words that the hook saves
+        std::array<uint8_t, 32> function;
+        function.fill(0xCC);
+#ifdef _WIN32
+        constexpr std::array<uint8_t, 8> code = {0x48, 0x89, 0xC8, 0x48,
+                                                 0x83, 0xF0, 0x5A, 0xC3};
+#else
+        constexpr std::array<uint8_t, 8> code = {0x48, 0x89, 0xF8, 0x48,
+                                                 0x83, 0xF0, 0x5A, 0xC3};
+#endif
+        std::memcpy(function.data(), code.data(), code.size());
+
+        auto& protection = MemoryProtection::GetDefault();
+        const auto size = protection.GetPageSize();
+#ifdef _WIN32
+        const auto page = static_cast<uint8_t*>(VirtualAlloc(
+            nullptr, size, MEM_COMMIT | MEM_RESERVE, PAGE_EXECUTE_READ));
+#else
+        const auto mapping = mmap(nullptr, size, PROT_READ | PROT_EXEC,
+                                  MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+        const auto page = mapping == MAP_FAILED
+                              ? nullptr
+                              : static_cast<uint8_t*>(mapping);
+#endif
+        if (!page)
+        {
+            std::fprintf(stderr, "Failed to allocate code pages\n");
+            return false;
+        }
+
+        const auto getProtection = [&] {
+            const auto regions = protection.Query(page, page + size);
+            return regions.empty() ? 0 : regions.front().Protection;
+        };
+
+        const auto executable = getProtection();
+        const auto write = [&](const size_t offset, const void* bytes,
+                               const size_t count) {
+            protection.Protect(page, size, protection.GetWritable(executable));
+            std::memcpy(page + offset, bytes, count);
+            protection.Protect(page, size, executable);
+            protection.FlushInstructionCache(page + offset, count);
+        };
+
+        // Lay the page out as Detours would: the target, a trampoline that
+        // runs its original code, and a stub that jumps to the detour
+        OneShotDispatchHook hook;
+        const auto detour = hook.GetDetourFunctionPointer();
+        std::array<uint8_t, 14> stub = {0xFF, 0x25};
+        std::memcpy(&stub[6], &detour, sizeof(detour));
+        write(0, function.data(), function.size());
+        write(TRAMPOLINE_OFFSET, function.data(), function.size());
+        write(STUB_OFFSET, stub.data(), stub.size());
+
+        *hook.GetTargetFunctionPointerReference() = page;
+        hook.OnAttaching();
+        *hook.GetTargetFunctionPointerReference() = page + TRAMPOLINE_OFFSET;
+
+        std::array<uint8_t, 5> jump = {0xE9};
+        const auto displacement = static_cast<int32_t>(STUB_OFFSET - 5);
+        std::memcpy(&jump[1], &displacement, sizeof(displacement));
+        write(0, jump.data(), jump.size());
+
+        // Call the target twice from every thread at once, so that some calls
+        // wait for the action while others race the removal of the hook
+        const auto target = reinterpret_cast<Function_t>(page);
+        std::atomic<size_t> waiting{THREAD_COUNT};
+        std::atomic<size_t> wrongResults{0};
+        std::vector<std::thread> threads;
+        for (size_t i = 0; i < THREAD_COUNT; i++)
+        {
+            threads.emplace_back([&, i] {
+                waiting.fetch_sub(1);
+                while (waiting.load() != 0)
+                {
+                }
+
+                for (uint64_t call = 0; call < 2; call++)
+                {
+                    const auto value = i * 2 + call;
+                    if (target(value) != (value ^ 0x5A))
+                    {
+                        wrongResults.fetch_add(1);
+                    }
+                }
+            });
+        }
+
+        for (auto& thread : threads)
+        {
+            thread.join();
+        }
+
+        auto isValid = true;
+        const auto fail = [&](const char* message) {
+            std::fprintf(stderr, "One-shot hook %s\n", message);
+            isValid = false;
+        };
+
+        if (OneShotDispatchHook::ActionCount.load() != 1)
+        {
+            fail("did not run its action exactly once");
+        }
+
+        if (wrongResults.load() != 0)
+        {
+            fail("did not call the original function");
+        }
+
+        if (!OneShotDispatchHook::IsDetached() ||
+            std::memcmp(page, function.data(), function.size()) != 0)
+        {
+            fail("did not restore the original bytes");
+        }
+
+        if (getProtection() != executable)
+        {
+            fail("did not restore the page protection");
+        }
+
+        // Call through a volatile pointer, as the game calls the target
+        // without knowing that it was detoured
+        volatile auto call = target;
+        benchmark_.Run("hook_dispatch/one_shot/1000000", 0, [&] {
+            uint64_t value = 0;
+            for (auto i = 0; i < 1000000; i++)
+            {
+                value = call(value);
+            }
+
+            Consume(value);
+        });
+
+#ifdef _WIN32
+        VirtualFree(page, 0, MEM_RELEASE);
+#else
+        munmap(page, size);
+#endif
+        return isValid;
+    }
+
+    /**
+     * Benchmarks recording trace events, which costs nothing unless the
+     * benchmark was built with DRAUTOS_TRACE.
+     */
+    void RunTracing() const
+    {
+        benchmark_.Run(
+            "trace/scope/1000", 0,
+            [] {
+                for (auto i = 0; i < 1000; i++)
+                {
+                    const TraceScope scope("DrautosBenchmark::RunTracing");
+                }
+            },
+            [] {
+                if constexpr (Trace::IS_ENABLED)
+                {
+                    Trace::GetInstance().Clear();
+                }
+            });
+
+        if constexpr (Trace::IS_ENABLED)
+        {
+            Trace::GetInstance().Clear();
+        }
+    }
+
+    /**
+     * Benchmarks unmasking the flags of a synthetic archive entry table, both
+     * in bulk and one entry at a time as UnmaskCompressedHook does, and checks
+     * that the bulk pass matches the per-entry one.
+     * @return True if the bulk pass unmasked every entry correctly.
+     */
+    bool RunArchiveFlags() const
+    {
+        constexpr size_t count = 65536;
+        constexpr size_t stride = 0x60;
+        constexpr size_t offset = 0x38;
+
+        // Random entries, with roughly a quarter of them masked
+        std::vector<uint8_t> pristine(count * stride);
+        std::mt19937 random(5);
+        size_t maskedCount = 0;
+        for (size_t i = 0; i < pristine.size(); i++)
+        {
+            pristine[i] = static_cast<uint8_t>(random());
+        }
+
+        for (size_t i = 0; i < count; i++)
+        {
+            auto flags = static_cast<int16_t>(random() & 0xFF);
+            if (random() % 4 == 0)
+            {
+                flags |= LmArcEntryFlags::MASK_COMPRESSED;
+                maskedCount++;
+            }
+
+            std::memcpy(&pristine[i * stride + offset], &flags, sizeof(flags));
+        }
+
+        auto expected = pristine;
+        for (size_t i = 0; i < count; i++)
+        {
+            const auto pFlags =
+                reinterpret_cast<int16_t*>(&expected[i * stride + offset]);
+            *pFlags = LmArcEntryFlags::Unmask(*pFlags);
+        }
+
+        auto entries = pristine;
+        const auto unmaskedCount =
+            LmArcEntryFlags::UnmaskAll(entries.data(), count, stride, offset);
+        if (unmaskedCount != maskedCount || entries != expected)
+        {
+            std::fprintf(stderr, "Unmasked %zu of %zu archive entries, or "
+                                 "changed the wrong bytes\n",
+                         unmaskedCount, maskedCount);
+            return false;
+        }
+
+        const auto name = std::to_string(count) + "_entries";
+        const auto reset = [&] { entries = pristine; };
+        benchmark_.Run(
+            "archive_flags/unmask_all/" + name, 0,
+            [&] {
+                Consume(LmArcEntryFlags::UnmaskAll(entries.data(), count,
+                                                   stride, offset));
+            },
+            reset);
+
+        benchmark_.Run(
+            "archive_flags/per_entry/" + name, 0,
+            [&] {
+                size_t unmasked = 0;
+                for (size_t i = 0; i < count; i++)
+                {
+                    const auto pFlags = reinterpret_cast<int16_t*>(
+                        &entries[i * stride + offset]);
+                    if ((*pFlags & LmArcEntryFlags::MASK_COMPRESSED) != 0)
+                    {
+                        *pFlags = LmArcEntryFlags::Unmask(*pFlags);
+                        unmasked++;
+                    }
+                }
+
+                Consume(unmasked);
+            },
+            reset);
+
+        return true;
+    }
+
+    /**
+     * Benchmarks writing patches to read-only code pages, both in a single
+     * transaction and with a transaction per write as patches used to be.
+     */
+    void RunPatchTransactions() const
+    {
+        constexpr size_t size = 4 << 20;
+        constexpr size_t count = 1024;
+        static constexpr auto patch = "90 90 90 90 90 90 90 90"_sig;
+
+#ifdef _WIN32
+        const auto data = static_cast<uint8_t*>(VirtualAlloc(
+            nullptr, size, MEM_COMMIT | MEM_RESERVE, PAGE_EXECUTE_READ));
+#else
+        const auto mapping = mmap(nullptr, size, PROT_READ | PROT_EXEC,
+                                  MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+        const auto data = mapping == MAP_FAILED
+                              ? nullptr
+                              : static_cast<uint8_t*>(mapping);
+#endif
+        if (!data)
+        {
+            std::fprintf(stderr, "Failed to allocate code pages\n");
+            return;
+        }
+
+        // Spread the writes so that several land on each page
+        std::vector<uint8_t*> targets;
+        for (size_t i = 0; i < count; i++)
+        {
+            targets.push_back(data + i * (size / count / 4) + i % 64);
+        }
+
+        const auto name = std::to_string(count) + "_writes";
+        benchmark_.Run("patch_transaction/commit/" + name, 0, [&] {
+            PatchTransaction transaction;
+            for (const auto target : targets)
+            {
+                transaction.Add(target, patch);
+            }
+
+            transaction.Commit();
+        });
+
+        benchmark_.Run("patch_transaction/per_write/" + name, 0, [&] {
+            for (const auto target : targets)
+            {
+                PatchTransaction transaction;
+                transaction.Add(target, patch);
+                transaction.Commit();
+            }
+        });
+
+#ifdef _WIN32
+        VirtualFree(data, 0, MEM_RELEASE);
+#else
+        munmap(data, size);
+#endif
+    }
+
+    /**
+     * Benchmarks applying every registered patch to an image, with and without
+     * signature locations cached on disk.
+     * @param image The image to patch.
+     */
+    void RunApplyPatches(BenchmarkImage& image) const
+    {
+        auto& patchManager = Patches::PatchManager::GetInstance();
+        image.MakeHost();
+
+        auto& configuration = Configuration::GetInstance();
+        configuration.EnableAnselPatch = true;
+        configuration.UnlockAdditionalDlc = true;
+
+        // Plant each target so that every patch finds exactly one match
+        const auto plant = [&] {
+            auto offset = image.GetSize() - image.GetSize() / 8;
+            for (const auto patch : patchManager.GetPatches())
+            {
+                image.Plant(patch->GetTargetSignature(), offset);
+                offset += 4096;
+            }
+        };
+
+        const PeImage peImage(image.GetData(), image.GetSize(),
+                              PeImage::MAPPED);
+        benchmark_.Run("fingerprint/compute/" + image.GetName(),
+                       image.GetSize(), [&] {
+                           Consume(
+                               ExecutableFingerprint::Compute(peImage).CodeHash);
+                       });
+
+        const auto cachePath = SignatureResolutionCache::GetDefaultPath();
+        std::error_code error;
+        benchmark_.Run(
+            "patch_manager/apply_patches/cold/" + image.GetName(),
+            image.GetSize(), [&] { patchManager.ApplyPatches(); },
+            [&] {
+                plant();
+                std::filesystem::remove(cachePath, error);
+            });
+
+        benchmark_.Run("patch_manager/apply_patches/warm/" + image.GetName(),
+                       image.GetSize(), [&] { patchManager.ApplyPatches(); },
+                       plant);
+    }
+
+    /**
+     * Benchmarks hashing asset URIs, and checks that every implementation of
+     * the hash matches the engine's.
+     * @param name The name to report the corpus under.
+     * @param corpus The asset URIs to hash.
+     * @return True if every implementation produced the same hashes.
+     */
+    bool RunHashing(const std::string& name,
+                    const std::vector<std::string>& corpus) const
+    {
+        using namespace SQEX::Luminous::Core;
+        constexpr auto basis = LmAssetID::NAME_HASH_OFFSET_BASIS;
+
+        // Cover every byte value and both sides of each SSE2 block
+        std::vector<std::string> checked = corpus;
+        std::string bytesUri;
+        for (auto value = 1; value < 256; value++)
+        {
+            bytesUri += static_cast<char>(value);
+        }
+
+        checked.push_back(bytesUri);
+        const std::string pattern = "data://AZ@[`az{\x80\xC3\x9C\xFF";
+        for (size_t size = 0; size <= 40; size++)
+        {
+            std::string uri;
+            while (uri.size() < size)
+            {
+                uri += pattern;
+            }
+
+            uri.resize(size);
+            checked.push_back(uri);
+        }
+
+        auto isValid = true;
+        for (const auto& uri : checked)
+        {
+            const auto expected = Fnv1a64Lower(uri.c_str(), basis);
+            if (Fnv1a64LowerFast(uri, basis) != expected ||
+                Fnv1a64LowerConstexpr(uri, basis) != expected)
+            {
+                std::fprintf(stderr, "Hash mismatch for %s\n", uri.c_str());
+                isValid = false;
+            }
+        }
+
+        uint64_t bytes = 0;
+        for (const auto& uri : corpus)
+        {
+            bytes += uri.size();
+        }
+
+        benchmark_.Run(
+            "hash/fnv1a64_lower/" + name, bytes,
+            [&] {
+                uint64_t hash = 0;
+                for (const auto& uri : corpus)
+                {
+                    hash ^= Fnv1a64Lower(uri.c_str(), basis);
+                }
+
+                Consume(hash);
+            },
+            {}, corpus.size());
+
+        benchmark_.Run(
+            "hash/fnv1a64_lower_fast/" + name, bytes,
+            [&] {
+                uint64_t hash = 0;
+                for (const auto& uri : corpus)
+                {
+                    hash ^= Fnv1a64LowerFast(uri, basis);
+                }
+
+                Consume(hash);
+            },
+            {}, corpus.size());
+
+        std::vector<LmAssetID> assets;
+        assets.reserve(corpus.size());
+        for (const auto& uri : corpus)
+        {
+            assets.push_back(LmAssetID::Create(uri.c_str()));
+        }
+
+        benchmark_.Run(
+            "hash/lm_asset_id_name_hash/" + name, bytes,
+            [&] {
+                uint64_t result;
+                for (auto& asset : assets)
+                {
+                    LmAssetID::GetNameHash(&asset, &result);
+                }
+            },
+            [&] {
+                for (auto& asset : assets)
+                {
+                    asset.fullHash_ = 0;
+                }
+            },
+            corpus.size());
+
+        LmAssetIDBatch batch;
+        batch.Reserve(corpus.size(), bytes);
+        for (const auto& uri : corpus)
+        {
+            batch.Add(uri);
+        }
+
+        std::vector<uint64_t> fullHashes(corpus.size());
+        batch.GenerateNameHashes(fullHashes);
+        for (size_t i = 0; i < corpus.size(); i++)
+        {
+            uint64_t result;
+            assets[i].fullHash_ = 0;
+            if (fullHashes[i] != LmAssetID::GetNameHash(&assets[i], &result))
+            {
+                std::fprintf(stderr, "Batch hash mismatch for %s\n",
+                             corpus[i].c_str());
+                isValid = false;
+                break;
+            }
+        }
+
+        benchmark_.Run(
+            "hash/lm_asset_id_batch/" + name, bytes,
+            [&] { batch.GenerateNameHashes(fullHashes); },
+            [&] { std::fill(fullHashes.begin(), fullHashes.end(), 0); },
+            corpus.size());
+
+        return isValid;
+    }
+
+    /**
+     * Benchmarks creating asset IDs that own their URI, and asset IDs whose
+     * URI is interned in an arena, and reports how much memory each uses.
+     * @param name The name to report the corpus under.
+     * @param corpus The asset URIs to create IDs for.
+     * @return True if both kinds of asset ID have the same hashes and URIs.
+     */
+    bool RunAssetIds(const std::string& name,
+                     const std::vector<std::string>& corpus) const
+    {
+        auto isValid = true;
+        LmUriArena checked;
+        for (const auto& uri : corpus)
+        {
+            auto expected = LmAssetID::Create(uri.c_str());
+            uint64_t hash;
+            LmAssetID::GetNameHash(&expected, &hash);
+
+            const auto reference = LmAssetRef::Create(uri, checked);
+            auto converted = reference.ToAssetID();
+            uint64_t convertedHash;
+            LmAssetID::GetNameHash(&converted, &convertedHash);
+            if (reference.GetNameHash() != hash || converted.m_path != uri ||
+                convertedHash != hash ||
+                LmAssetRef::Create(uri, checked).m_path.data() !=
+                    reference.m_path.data())
+            {
+                std::fprintf(stderr, "Asset reference mismatch for %s\n",
+                             uri.c_str());
+                isValid = false;
+            }
+        }
+
+        std::vector<LmAssetID> assets;
+        benchmark_.Run(
+            "asset_id/create/lm_asset_id/" + name, 0,
+            [&] {
+                uint64_t result;
+                for (const auto& uri : corpus)
+                {
+                    auto& asset = assets.emplace_back(
+                        LmAssetID::Create(uri.c_str()));
+                    LmAssetID::GetNameHash(&asset, &result);
+                }
+            },
+            [&] {
+                assets.clear();
+                assets.shrink_to_fit();
+                assets.reserve(corpus.size());
+            },
+            corpus.size());
+
+        // The arena lasts for the session, so most URIs are already interned
+        auto arena = std::make_unique<LmUriArena>();
+        std::vector<LmAssetRef> references;
+        benchmark_.Run(
+            "asset_id/create/lm_asset_ref/" + name, 0,
+            [&] {
+                for (const auto& uri : corpus)
+                {
+                    references.push_back(LmAssetRef::Create(uri, *arena));
+                }
+            },
+            [&] {
+                references.clear();
+                references.reserve(corpus.size());
+            },
+            corpus.size());
+
+        benchmark_.Run(
+            "asset_id/intern/" + name, 0,
+            [&] {
+                for (const auto& uri : corpus)
+                {
+                    references.push_back(LmAssetRef::Create(uri, *arena));
+                }
+            },
+            [&] {
+                arena = std::make_unique<LmUriArena>();
+                references.clear();
+                references.reserve(corpus.size());
+            },
+            corpus.size());
+
+        if (assets.empty() || references.empty())
+        {
+            return isValid;
+        }
+
+        size_t heapBytes = 0;
+        for (const auto& asset : assets)
+        {
+            const auto capacity = asset.m_path.capacity();
+            heapBytes += capacity > std::string().capacity() ? capacity + 1 : 0;
+        }
+
+        const auto statistics = arena->GetStatistics();
+        const auto count = static_cast<double>(corpus.size());
+        // Each further reference to an interned URI only costs the reference
+        std::printf("asset_id/memory/%s: LmAssetID %.1f B/ID, LmAssetRef "
+                    "%.1f B/ID and %zu B/reuse, %zu distinct URIs\n",
+                    name.c_str(), sizeof(LmAssetID) + heapBytes / count,
+                    sizeof(LmAssetRef) +
+                        (statistics.BlockBytes + statistics.TableBytes) / count,
+                    sizeof(LmAssetRef), statistics.Count);
+        return isValid;
+    }
+
+    /**
+     * Checks the EARC reader against a synthetic archive, including one whose
+     * entries are out of order and ones that are malformed, and benchmarks it.
+     * @return True if every entry was found with the right data.
+     */
+    bool RunSyntheticArchive() const
+    {
+        const auto corpus = CreateCorpus(65536, 3);
+        const auto sorted = CreateArchive(corpus, true);
+        const auto shuffled = CreateArchive(corpus, false);
+
+        auto isValid = true;
+        const auto check = [&](const bool condition, const char* message) {
+            if (!condition)
+            {
+                std::fprintf(stderr, "Synthetic archive: %s\n", message);
+                isValid = false;
+            }
+        };
+
+        EarcArchive archive(sorted);
+        EarcArchive unsorted(shuffled);
+        check(archive.GetEntries().size() == corpus.size(),
+              "wrong entry count");
+        for (const auto& uri : corpus)
+        {
+            std::string upper = uri;
+            for (auto& character : upper)
+            {
+                character = static_cast<char>(std::toupper(
+                    static_cast<unsigned char>(character)));
+            }
+
+            const auto entry = archive.FindUri(upper);
+            const auto other = unsorted.FindUri(uri);
+            if (!entry || !other)
+            {
+                check(false, "URI not found");
+                continue;
+            }
+
+            // Payloads are filled with the low byte of their URI's name hash
+            const auto data = archive.GetData(*entry);
+            const auto start = static_cast<size_t>(data.data() - sorted.data());
+            check(start <= sorted.size() &&
+                      data.size() <= sorted.size() - start,
+                  "data was copied");
+            check(archive.GetUri(*entry) == uri &&
+                      unsorted.GetUri(*other) == uri &&
+                      archive.GetRelativePath(*entry) == uri.substr(7),
+                  "wrong URI");
+            check(std::all_of(data.begin(), data.end(),
+                              [&](const uint8_t value) {
+                                  return value ==
+                                         static_cast<uint8_t>(entry->FullHash);
+                              }),
+                  "wrong data");
+
+            const auto byHash = unsorted.Find(entry->FullHash);
+            check(byHash && byHash->FullHash == entry->FullHash,
+                  "hash not found in unsorted archive");
+        }
+
+        check(!archive.Find(0) && !archive.FindUri("data://missing.gmdl"),
+              "found an asset that is not in the archive");
+
+        const auto isRejected = [](std::vector<uint8_t> bytes) {
+            try
+            {
+                EarcArchive invalid(bytes);
+                return false;
+            }
+            catch (const std::runtime_error&)
+            {
+                return true;
+            }
+        };
+
+        auto badMagic = sorted;
+        badMagic[0] ^= 0xFF;
+        check(isRejected(badMagic), "accepted a bad tag");
+        check(isRejected({sorted.begin(), sorted.begin() + sorted.size() / 2}),
+              "accepted a truncated archive");
+
+        benchmark_.Run("earc/open/synthetic_64k", 0, [&] {
+            const EarcArchive opened(sorted);
+            Consume(opened.GetEntries().size());
+        });
+
+        benchmark_.Run("earc/open/unsorted_64k", 0, [&] {
+            const EarcArchive opened(shuffled);
+            Consume(opened.GetEntries().size());
+        });
+
+        return RunArchive("synthetic_64k", archive) && isValid;
+    }
+
+    /**
+     * Benchmarks inflating a large compressed file one chunk at a time on the
+     * calling thread, and with its chunks spread across the thread pool.
+     * @return True if both produced the original file, and malformed files
+     * were rejected.
+     */
+    bool RunDecompression() const
+    {
+        constexpr size_t size = 32 << 20;
+        const auto original = CreateTexture(size, 11);
+        const auto payload = CompressChunks(original);
+
+        std::vector<uint8_t> output(size);
+        // Check the parallel path even on machines with a single core
+        ThreadPool serial(1);
+        ThreadPool parallel(4);
+        auto& pool = ThreadPool::GetInstance();
+        auto isValid = true;
+        for (const auto poolToCheck : {&serial, &parallel, &pool})
+        {
+            std::fill(output.begin(), output.end(), 0);
+            const auto file = EarcDecompressor::Decompress(payload, output,
+                                                           size, *poolToCheck);
+            if (!std::equal(file.begin(), file.end(), original.begin(),
+                            original.end()))
+            {
+                std::fprintf(stderr, "Inflated file does not match\n");
+                isValid = false;
+            }
+        }
+
+        const auto isRejected = [&](const std::vector<uint8_t>& malformed) {
+            try
+            {
+                EarcDecompressor::Decompress(malformed, output, size,
+                                             parallel);
+                return false;
+            }
+            catch (const std::runtime_error&)
+            {
+                return true;
+            }
+        };
+
+        const std::vector truncated(payload.begin(),
+                                    payload.begin() + payload.size() / 2);
+        auto corrupted = payload;
+        corrupted[EarcDecompressor::CHUNK_HEADER_SIZE] ^= 0xFF;
+        if (!isRejected(truncated) || !isRejected(corrupted))
+        {
+            std::fprintf(stderr, "Inflated a malformed file\n");
+            isValid = false;
+        }
+
+        const auto name = std::to_string(size >> 20) + "_mib";
+        benchmark_.Run("earc/inflate/serial/" + name, size, [&] {
+            EarcDecompressor::Decompress(payload, output, size, serial);
+        });
+
+        benchmark_.Run("earc/inflate/parallel/" + name, size, [&] {
+            EarcDecompressor::Decompress(payload, output, size, pool);
+        });
+
+        return isValid;
+    }
+
+    /**
+     * Checks the eviction order and budget of the payload cache, then
+     * benchmarks fetching compressed files from an archive with and without
+     * it.
+     * @return True if the cache evicted the expected files, never held more
+     * than its budget, and served files that match the originals.
+     */
+    bool RunPayloadCache() const
+    {
+        auto isValid = true;
+        const auto check = [&](const bool condition, const char* message) {
+            if (!condition)
+            {
+                std::fprintf(stderr, "Payload cache: %s\n", message);
+                isValid = false;
+            }
+        };
+
+        const auto isRejected = [](const size_t budget,
+                                   const size_t maxFileSize) {
+            try
+            {
+                PayloadCache invalid(budget, maxFileSize);
+                return false;
+            }
+            catch (const std::invalid_argument&)
+            {
+                return true;
+            }
+        };
+
+        constexpr auto pageSize = PayloadCache::PAGE_SIZE;
+        check(isRejected(1 << 20, 0) && isRejected(pageSize, pageSize + 1),
+              "accepted an invalid layout");
+
+        // Caches use as many shards as still hold the largest file
+        check(PayloadCache(64 << 20).GetMaxFileSize() ==
+                      PayloadCache::DEFAULT_MAX_FILE_SIZE &&
+                  PayloadCache(256 << 20, 1 << 20).GetMaxFileSize() ==
+                      16 << 20 &&
+                  PayloadCache(12 << 20, 5 << 20).GetMaxFileSize() == 6 << 20,
+              "wrong shard size");
+
+        // Three files of five pages fill all but one page, so a fourth evicts
+        // the first file that has not been read since it was cached
+        PayloadCache small(16 * pageSize, 16 * pageSize);
+        const auto file = [](const uint8_t value, const size_t size) {
+            return std::vector<uint8_t>(size, value);
+        };
+
+        std::vector<uint8_t> output(16 * pageSize);
+        const auto holds = [&](const uint64_t hash, const size_t size) {
+            const auto cached = small.Get(hash, output);
+            return cached && cached->size() == size &&
+                   std::all_of(cached->begin(), cached->end(),
+                               [&](const uint8_t value) {
+                                   return value == static_cast<uint8_t>(hash);
+                               });
+        };
+
+        for (uint8_t hash = 1; hash <= 3; hash++)
+        {
+            check(small.Put(hash, file(hash, 5 * pageSize - 100)),
+                  "did not cache a file");
+        }
+
+        check(holds(1, 5 * pageSize - 100), "wrong file");
+        check(small.Put(4, file(4, 5 * pageSize)), "did not cache a file");
+        check(holds(1, 5 * pageSize - 100) && !holds(2, 0) &&
+                  holds(3, 5 * pageSize - 100) && holds(4, 5 * pageSize),
+              "evicted the wrong file");
+        check(small.Put(3, file(3, 100)) && holds(3, 100),
+              "did not replace a file");
+        check(!small.Put(5, file(5, 16 * pageSize + 1)) &&
+                  !small.Put(6, {}),
+              "cached a file that does not fit");
+        check(!small.Get(4, std::span(output).first(pageSize)),
+              "overran the output");
+
+        const auto statistics = small.GetStatistics();
+        check(statistics.Insertions == 5 && statistics.Evictions == 1 &&
+                  statistics.BytesCached == 10 * pageSize &&
+                  statistics.Budget == 16 * pageSize,
+              "wrong statistics");
+        small.Clear();
+        check(!small.Get(1, output) && small.GetStatistics().BytesCached == 0,
+              "did not clear");
+
+        // An archive of compressed textures, as fast travel streams them
+        constexpr size_t fileSize = 1 << 20;
+        constexpr size_t fileCount = 16;
+        const auto corpus = CreateCorpus(fileCount, 13);
+        auto bytes = CreateArchive(corpus, true);
+        std::vector<std::vector<uint8_t>> originals;
+        for (size_t i = 0; i < fileCount; i++)
+        {
+            originals.push_back(
+                CreateTexture(fileSize, static_cast<uint32_t>(20 + i)));
+            const auto payload = CompressChunks(originals.back());
+            const auto entry =
+                EarcArchive::HEADER_SIZE + i * EarcArchive::ENTRY_SIZE;
+            const auto fields =
+                std::array{static_cast<uint32_t>(fileSize),
+                           static_cast<uint32_t>(payload.size()),
+                           static_cast<uint32_t>(LmArcEntryFlags::COMPRESSED)};
+            const uint64_t dataOffset = bytes.size();
+            std::memcpy(&bytes[entry + 0x08], fields.data(), sizeof(fields));
+            std::memcpy(&bytes[entry + 0x18], &dataOffset, 8);
+            bytes.insert(bytes.end(), payload.begin(), payload.end());
+        }
+
+        const EarcArchive archive(bytes);
+        std::vector<EarcArchive::Entry> entries;
+        for (const auto& entry : archive.GetEntries())
+        {
+            entries.push_back(entry);
+        }
+
+        ThreadPool serial(1);
+        PayloadCache cache(64 << 20);
+        std::vector<uint8_t> fetched(fileSize);
+        for (size_t i = 0; i < fileCount; i++)
+        {
+            for (auto pass = 0; pass < 2; pass++)
+            {
+                const auto result = EarcDecompressor::Decompress(
+                    archive, entries[i], fetched, cache, serial);
+                check(std::equal(result.begin(), result.end(),
+                                 originals[i].begin(), originals[i].end()),
+                      "fetched the wrong file");
+            }
+        }
+
+        const auto fetchStatistics = cache.GetStatistics();
+        check(fetchStatistics.Hits == fileCount &&
+                  fetchStatistics.Misses == fileCount &&
+                  fetchStatistics.BytesSaved == fileCount * fileSize,
+              "did not serve repeated fetches");
+
+        size_t next = 0;
+        benchmark_.Run("earc/fetch/uncached/1_mib", fileSize, [&] {
+            const auto& entry = entries[next++ % fileCount];
+            EarcDecompressor::Decompress(archive, entry, fetched, serial);
+        });
+
+        benchmark_.Run("earc/fetch/cached/1_mib", fileSize, [&] {
+            const auto& entry = entries[next++ % fileCount];
+            EarcDecompressor::Decompress(archive, entry, fetched, cache,
+                                         serial);
+        });
+
+        // Fast travel between two areas whose textures do not both fit, with
+        // a quarter of the fetches going to textures shared by both. Sizing
+        // the cache for larger files gives it fewer shards, which wastes less
+        // of a small budget on shards that a texture no longer fits in
+        PayloadCache churn(12 << 20, 4 * fileSize);
+        std::mt19937 random(14);
+        for (size_t i = 0; i < 4096; i++)
+        {
+            const auto area = (i / 64) % 2;
+            const auto index = random() % 4 == 0
+                                   ? random() % 4
+                                   : 4 + area * 6 + random() % 6;
+            EarcDecompressor::Decompress(archive, entries[index], fetched,
+                                         churn, serial);
+        }
+
+        const auto churnStatistics = churn.GetStatistics();
+        std::printf("payload_cache/churn: %.1f%% hit rate, %.2f evictions per "
+                    "insertion, %.0f MiB saved, %.1f of %.1f MiB cached\n",
+                    churnStatistics.GetHitRate() * 100,
+                    churnStatistics.GetEvictionRate(),
+                    static_cast<double>(churnStatistics.BytesSaved) / (1 << 20),
+                    static_cast<double>(churnStatistics.BytesCached) /
+                        (1 << 20),
+                    static_cast<double>(churnStatistics.Budget) / (1 << 20));
+        check(churnStatistics.BytesCached <= churnStatistics.Budget,
+              "exceeded the budget");
+
+        return isValid;
+    }
+
+    /**
+     * Benchmarks finding every entry of an archive, by full hash and by URI.
+     * @param name The name to report the archive under.
+     * @param archive The archive.
+     * @return True if every entry was found by its own hash and URI.
+     */
+    bool RunArchive(const std::string& name, EarcArchive& archive) const
+    {
+        const auto entries = archive.GetEntries();
+        std::vector<uint64_t> hashes;
+        std::vector<std::string_view> uris;
+        hashes.reserve(entries.size());
+        uris.reserve(entries.size());
+        for (const auto& entry : entries)
+        {
+            hashes.push_back(entry.FullHash);
+            uris.push_back(archive.GetUri(entry));
+        }
+
+        // Look entries up in a different order from the table
+        std::mt19937 random(7);
+        std::shuffle(hashes.begin(), hashes.end(), random);
+        std::shuffle(uris.begin(), uris.end(), random);
+
+        auto isValid = true;
+        for (size_t i = 0; i < hashes.size(); i++)
+        {
+            const auto byHash = archive.Find(hashes[i]);
+            const auto byUri = archive.FindUri(uris[i]);
+            if (!byHash || byHash->FullHash != hashes[i] || !byUri ||
+                archive.GetUri(*byUri).size() != uris[i].size())
+            {
+                std::fprintf(stderr, "Entry %zu of %s was not found\n", i,
+                             name.c_str());
+                isValid = false;
+                break;
+            }
+        }
+
+        benchmark_.Run(
+            "earc/scan/" + name, 0,
+            [&] {
+                uint64_t size = 0;
+                for (const auto& entry : archive.GetEntries())
+                {
+                    size += entry.IsCompressed() ? entry.ProcessedSize : 0;
+                }
+
+                Consume(size);
+            },
+            {}, entries.size());
+
+        benchmark_.Run(
+            "earc/find/" + name, 0,
+            [&] {
+                for (const auto hash : hashes)
+                {
+                    Consume(archive.Find(hash)->DataOffset);
+                }
+            },
+            {}, hashes.size());
+
+        benchmark_.Run(
+            "earc/find_uri/" + name, 0,
+            [&] {
+                for (const auto uri : uris)
+                {
+                    Consume(archive.FindUri(uri)->DataOffset);
+                }
+            },
+            {}, uris.size());
+
+        return isValid;
+    }
+
+    /**
+     * Benchmarks looking up assets in override tables of different sizes, for
+     * assets that are overridden and ones that are not.
+     * @return True if every override was found with its target, no other
+     * asset was, and archives were added with their offsets.
+     */
+    bool RunOverrides() const
+    {
+        const auto misses = CreateCorpus(100000, 9);
+        std::vector<uint64_t> missHashes;
+        for (const auto& uri : misses)
+        {
+            missHashes.push_back(LmAssetID::ComputeNameHash(uri));
+        }
+
+        auto isValid = true;
+        for (const size_t count : {1000, 100000})
+        {
+            auto corpus = CreateCorpus(count, 8);
+            std::sort(corpus.begin(), corpus.end());
+            corpus.erase(std::unique(corpus.begin(), corpus.end()),
+                         corpus.end());
+
+            AssetOverrideTable table;
+            std::vector<uint64_t> hitHashes;
+            for (size_t i = 0; i < corpus.size(); i++)
+            {
+                hitHashes.push_back(LmAssetID::ComputeNameHash(corpus[i]));
+                table.Add(hitHashes.back(), {corpus[i], i, i, i, false});
+            }
+
+            // Replacing an override keeps one entry for the asset
+            table.Add(hitHashes[0], {corpus[0], 0, 0, 0, true});
+            for (size_t i = 0; i < corpus.size(); i++)
+            {
+                const auto target = table.Find(hitHashes[i]);
+                if (!target || target->Offset != i ||
+                    target->IsCompressed != (i == 0))
+                {
+                    std::fprintf(stderr, "Override %zu was not found\n", i);
+                    isValid = false;
+                    break;
+                }
+            }
+
+            std::unordered_set<uint64_t> hitSet(hitHashes.begin(),
+                                                hitHashes.end());
+            std::vector<uint64_t> missing;
+            for (const auto hash : missHashes)
+            {
+                if (!hitSet.contains(hash))
+                {
+                    missing.push_back(hash);
+                }
+            }
+
+            if (table.GetSize() != corpus.size() ||
+                std::any_of(missing.begin(), missing.end(),
+                            [&](const uint64_t hash) {
+                                return table.Find(hash) != nullptr;
+                            }))
+            {
+                std::fprintf(stderr, "Found an asset that is not overridden\n");
+                isValid = false;
+            }
+
+            const auto statistics = table.GetStatistics();
+            const auto name = std::to_string(count / 1000) + "k";
+            std::printf("override/table/%s: %zu overrides, %zu buckets, %.3f "
+                        "mean and %zu max buckets per miss\n",
+                        name.c_str(), statistics.Count,
+                        statistics.BucketCount, statistics.MeanMissProbes,
+                        statistics.MaxMissProbes);
+
+            std::mt19937 random(10);
+            std::shuffle(hitHashes.begin(), hitHashes.end(), random);
+            benchmark_.Run(
+                "override/find_hit/" + name, 0,
+                [&] {
+                    for (const auto hash : hitHashes)
+                    {
+                        Consume(table.Find(hash)->Offset);
+                    }
+                },
+                {}, hitHashes.size());
+
+            benchmark_.Run(
+                "override/find_miss/" + name, 0,
+                [&] {
+                    size_t found = 0;
+                    for (const auto hash : missing)
+                    {
+                        found += table.Find(hash) != nullptr;
+                    }
+
+                    Consume(found);
+                },
+                {}, missing.size());
+        }
+
+        const auto corpus = CreateCorpus(4096, 3);
+        const auto bytes = CreateArchive(corpus, true);
+        const EarcArchive archive(bytes);
+        AssetOverrideTable table;
+        table.AddArchive(archive, "synthetic.earc");
+        for (const auto& entry : archive.GetEntries())
+        {
+            const auto target = table.Find(entry.FullHash);
+            if (!target || target->Offset != entry.DataOffset ||
+                target->Size != entry.ProcessedSize ||
+                target->IsCompressed != entry.IsCompressed())
+            {
+                std::fprintf(stderr, "Archive override was not found\n");
+                isValid = false;
+                break;
+            }
+        }
+
+        return isValid;
+    }
+
+    /**
+     * Benchmarks appending patch index archives to a patch index list in one
+     * batch, and one at a time as AddPatchIndexEarc does. Acquiring them needs
+     * the game, so it is not included.
+     * @return True if the batch appended every distinct archive once, in
+     * order.
+     */
+    bool RunPatchIndices() const
+    {
+        auto isValid = true;
+        for (const size_t count : {4, 500})
+        {
+            // Every tenth archive repeats an earlier one
+            std::vector<LmAssetID> pristine;
+            std::vector<uint64_t> expected;
+            for (size_t i = 0; i < count; i++)
+            {
+                const auto mod = i % 10 == 9 ? i / 2 : i;
+                const auto uri = "data://mods/mod_" + std::to_string(mod) +
+                                 "/patchindex.ebex@";
+                pristine.push_back(LmAssetID::Create(uri.c_str()));
+                const auto hash = LmAssetID::ComputeNameHash(uri);
+                if (std::find(expected.begin(), expected.end(), hash) ==
+                    expected.end())
+                {
+                    expected.push_back(hash);
+                }
+            }
+
+            const std::vector<uint64_t> initial = {1, 2};
+            auto ids = pristine;
+            auto list = initial;
+            LmFileList::AppendPatchIndices(list, ids);
+            if (!std::equal(list.begin() + 2, list.end(), expected.begin(),
+                            expected.end()))
+            {
+                std::fprintf(stderr, "Patch indices were not appended in "
+                                     "order without duplicates\n");
+                isValid = false;
+            }
+
+            const auto reset = [&] {
+                ids = pristine;
+                list = initial;
+                list.shrink_to_fit();
+            };
+
+            const auto name = std::to_string(count);
+            benchmark_.Run(
+                "mount/patch_indices/bulk/" + name, 0,
+                [&] {
+                    Consume(LmFileList::AppendPatchIndices(list, ids).size());
+                },
+                reset, count);
+
+            benchmark_.Run(
+                "mount/patch_indices/single/" + name, 0,
+                [&] {
+                    for (auto& id : ids)
+                    {
+                        uint64_t result;
+                        list.push_back(LmAssetID::GetNameHash(&id, &result));
+                    }
+                },
+                reset, count);
+        }
+
+        return isValid;
+    }
+
+    /**
+     * Checks that access traces keep the first lookup of each asset and
+     * survive a round trip through a file, then replays a synthetic trace
+     * against a mapped archive, and benchmarks recording and replaying.
+     * @return True if the trace was kept and the prefetcher counted the
+     * expected hits.
+     */
+    bool RunPrefetch() const
+    {
+        auto isValid = true;
+        const auto check = [&](const bool condition, const char* message) {
+            if (!condition)
+            {
+                std::fprintf(stderr, "Prefetch: %s\n", message);
+                isValid = false;
+            }
+        };
+
+        const auto directory =
+            std::filesystem::temp_directory_path() / "DrautosBenchmark";
+        std::filesystem::create_directories(directory);
+
+        // Only the first lookup of each asset is kept, up to the capacity
+        const auto corpus = CreateCorpus(4096, 11);
+        std::vector<uint64_t> hashes;
+        for (const auto& uri : corpus)
+        {
+            hashes.push_back(LmAssetID::ComputeNameHash(uri));
+        }
+
+        std::sort(hashes.begin(), hashes.end());
+        hashes.erase(std::unique(hashes.begin(), hashes.end()), hashes.end());
+        std::mt19937 random(12);
+        std::shuffle(hashes.begin(), hashes.end(), random);
+
+        AssetAccessTrace small(8);
+        for (size_t i = 0; i < 10; i++)
+        {
+            small.Record(hashes[i]);
+            small.Record(hashes[i / 2]);
+        }
+
+        // Lookups after recording stops are ignored
+        small.Stop();
+        small.Record(hashes[10]);
+        const auto accesses = small.GetAccesses();
+        check(accesses.size() == 8 && small.GetDroppedCount() == 2,
+              "repeated lookups were recorded");
+        for (size_t i = 0; i < accesses.size(); i++)
+        {
+            check(accesses[i].NameHash == hashes[i], "wrong access order");
+        }
+
+        const auto tracePath = directory / "access_trace.bin";
+        check(small.Save(tracePath) &&
+                  AssetAccessTrace::Load(tracePath) == accesses,
+              "trace did not survive a round trip");
+        std::filesystem::resize_file(tracePath,
+                                     std::filesystem::file_size(tracePath) - 1);
+        try
+        {
+            (void)AssetAccessTrace::Load(tracePath);
+            check(false, "accepted a truncated trace");
+        }
+        catch (const std::runtime_error&)
+        {
+        }
+
+        // The trace that is recording is saved as soon as the game exits,
+        // rather than after RECORDING_DURATION. It outlives this function in
+        // case the thread that saves it is late.
+        static AssetAccessTrace exitTrace(8);
+        exitTrace.Record(hashes[0]);
+        AssetAccessTrace::SetActive(&exitTrace);
+        const auto exitTracePath = directory / "access_trace_exit.bin";
+        std::filesystem::remove(exitTracePath);
+        AssetAccessTrace::SaveActiveLater(exitTracePath);
+        check(AssetAccessTrace::Finish(std::chrono::seconds(5)) &&
+                  !AssetAccessTrace::GetActive() &&
+                  std::filesystem::exists(exitTracePath) &&
+                  AssetAccessTrace::Load(exitTracePath).size() == 1,
+              "trace was not saved when the game exited");
+
+        // The trace asks for every asset in the archive in a random order,
+        // and for some that are not in it
+        const auto bytes = CreateArchive(corpus, true);
+        const auto archivePath = directory / "prefetch.earc";
+        {
+            std::ofstream stream(archivePath, std::ios::binary);
+            stream.write(reinterpret_cast<const char*>(bytes.data()),
+                         static_cast<std::streamsize>(bytes.size()));
+        }
+
+        EarcArchive archive(archivePath);
+        EarcArchive* archives[] = {&archive};
+        std::vector<AssetAccessTrace::Access> trace;
+        for (const auto hash : hashes)
+        {
+            trace.push_back({hash, 0});
+        }
+
+        trace.push_back({LmAssetID::ComputeNameHash("data://missing.gmdl"), 0});
+
+        // Asking for the first asset lets the next four be advised, so they
+        // hit and the one after them misses
+        {
+            ArchivePrefetcher prefetcher(archives, trace, 4);
+            check(!prefetcher.OnRequest(hashes[0]) &&
+                      prefetcher.PrefetchAhead() == 4,
+                  "advised the wrong assets");
+            for (size_t i = 1; i <= 5; i++)
+            {
+                check(prefetcher.OnRequest(hashes[i]) == (i <= 4),
+                      "wrong hit");
+            }
+
+            prefetcher.OnRequest(hashes[1]);
+            prefetcher.OnRequest(0);
+            const auto statistics = prefetcher.GetStatistics();
+            check(statistics.Planned == hashes.size() &&
+                      statistics.Prefetched == 4 &&
+                      statistics.Requests == 6 && statistics.Hits == 4 &&
+                      statistics.Unplanned == 1,
+                  "wrong statistics");
+        }
+
+        // Replay the trace with the worker, reading each asset as the game
+        // would
+        {
+            ArchivePrefetcher prefetcher(archives, trace);
+            prefetcher.Start();
+            uint64_t sum = 0;
+            for (const auto hash : hashes)
+            {
+                prefetcher.OnRequest(hash);
+                const auto data = archive.GetData(*archive.FindNameHash(hash));
+                sum += std::accumulate(data.begin(), data.end(), uint64_t{0});
+                std::this_thread::yield();
+            }
+
+            prefetcher.Stop();
+            Consume(sum);
+            const auto statistics = prefetcher.GetStatistics();
+            std::printf("prefetch/replay/4k: %zu planned, %zu advised, %.1f%% "
+                        "hit rate\n",
+                        statistics.Planned, statistics.Prefetched,
+                        statistics.GetHitRate() * 100);
+        }
+
+        std::unique_ptr<AssetAccessTrace> recording;
+        benchmark_.Run(
+            "access_trace/record/4k", 0,
+            [&] {
+                for (const auto hash : hashes)
+                {
+                    recording->Record(hash);
+                }
+            },
+            [&] { recording = std::make_unique<AssetAccessTrace>(); },
+            hashes.size());
+
+        benchmark_.Run(
+            "access_trace/record_repeat/4k", 0,
+            [&] {
+                for (const auto hash : hashes)
+                {
+                    recording->Record(hash);
+                }
+            },
+            {}, hashes.size());
+
+        benchmark_.Run(
+            "prefetch/plan/4k", 0,
+            [&] {
+                const ArchivePrefetcher prefetcher(archives, trace);
+                Consume(prefetcher.GetStatistics().Planned);
+            },
+            {}, trace.size());
+
+        ArchivePrefetcher replay(archives, trace);
+        benchmark_.Run(
+            "prefetch/on_request/4k", 0,
+            [&] {
+                size_t hits = 0;
+                for (const auto hash : hashes)
+                {
+                    hits += replay.OnRequest(hash);
+                }
+
+                Consume(hits);
+            },
+            {}, hashes.size());
+
+        return isValid;
+    }
+
+    /**
+     * Replays a recorded access trace against archives in the order it was
+     * recorded, reading each asset as the game would.
+     * @param name The name to report the trace under.
+     * @param archives The archives, in the order the game mounts them.
+     * @param trace The accesses that were recorded.
+     */
+    void RunTraceReplay(
+        const std::string& name, const std::span<EarcArchive* const> archives,
+        const std::vector<AssetAccessTrace::Access>& trace) const
+    {
+        ArchivePrefetcher prefetcher(archives, trace);
+        const auto start = std::chrono::steady_clock::now();
+        prefetcher.Start();
+        uint64_t sum = 0;
+        for (const auto& access : trace)
+        {
+            const auto hash = access.NameHash;
+            prefetcher.OnRequest(hash);
+            for (auto archive = archives.rbegin(); archive != archives.rend();
+                 ++archive)
+            {
+                if (const auto entry = (*archive)->FindNameHash(hash))
+                {
+                    const auto data = (*archive)->GetData(*entry);
+                    sum += std::accumulate(data.begin(), data.end(),
+                                           uint64_t{0});
+                    break;
+                }
+            }
+        }
+
+        prefetcher.Stop();
+        Consume(sum);
+        const auto seconds = std::chrono::duration<double>(
+                                 std::chrono::steady_clock::now() - start)
+                                 .count();
+        const auto statistics = prefetcher.GetStatistics();
+        std::printf("prefetch/replay/%s: %zu planned, %zu unplanned, %.1f MiB "
+                    "advised, %.1f%% hit rate, %.3f s\n",
+                    name.c_str(), statistics.Planned, statistics.Unplanned,
+                    static_cast<double>(statistics.PrefetchedBytes) / (1 << 20),
+                    statistics.GetHitRate() * 100, seconds);
+    }
+
+    /**
+     * Creates asset URIs that resemble those in the game's archives.
+     * @param count The number of URIs to create.
+     * @param seed The seed for the random choices.
+     */
+    static std::vector<std::string> CreateCorpus(const size_t count,
+                                                 uint64_t seed)
+    {
+        constexpr const char* roots[] = {
+            "data://character/", "data://environment/", "data://menu/",
+            "data://sound/",     "data://level/",       "data://shader/"};
+        constexpr const char* directories[] = {
+            "nh/nh00/",         "pc/pc01/",          "am/am00/",
+            "model_000/",       "sourceimages/",     "Common/",
+            "world/props/",     "Textures/Highres/", "animation/event/",
+            "autoexternal/",    "win/",              "ebex/"};
+        constexpr const char* extensions[] = {".gmdl", ".gmtl", ".btex",
+                                              ".ebex", ".amdl", ".anmgph",
+                                              ".sax",  ".gpubin"};
+
+        const auto next = [&] {
+            seed ^= seed << 13;
+            seed ^= seed >> 7;
+            seed ^= seed << 17;
+            return static_cast<size_t>(seed >> 33);
+        };
+
+        std::vector<std::string> corpus;
+        corpus.reserve(count);
+        for (size_t i = 0; i < count; i++)
+        {
+            std::string uri = roots[next() % std::size(roots)];
+            for (auto depth = 1 + next() % 4; depth > 0; depth--)
+            {
+                uri += directories[next() % std::size(directories)];
+            }
+
+            uri += next() % 2 ? "NH00_" : "pc01_";
+            uri += std::to_string(next() % 1000);
+            uri += "_Diffuse";
+            uri += extensions[next() % std::size(extensions)];
+            corpus.push_back(std::move(uri));
+        }
+
+        return corpus;
+    }
+
+    /**
+     * Creates a texture-like gradient with noise, which compresses about as
+     * well as the game's textures.
+     * @param size The size of the texture, in bytes.
+     * @param seed The seed for the noise.
+     */
+    static std::vector<uint8_t> CreateTexture(const size_t size,
+                                              const uint32_t seed)
+    {
+        std::vector<uint8_t> texture(size);
+        std::mt19937 random(seed);
+        for (size_t i = 0; i < size; i++)
+        {
+            const auto x = i % 4096;
+            const auto y = i / 4096;
+            texture[i] = static_cast<uint8_t>(x / 16 + y / 8 + random() % 8);
+        }
+
+        return texture;
+    }
+
+    /**
+     * Compresses a file into zlib chunks, as the game stores compressed files.
+     * @param original The file.
+     * @return The compressed file, as it would be stored in an archive.
+     */
+    static std::vector<uint8_t> CompressChunks(
+        const std::vector<uint8_t>& original)
+    {
+        constexpr size_t chunkSize = 128 << 10;
+        std::vector<uint8_t> payload;
+        for (size_t offset = 0; offset < original.size(); offset += chunkSize)
+        {
+            const auto chunk = std::min(chunkSize, original.size() - offset);
+            auto compressedSize = compressBound(chunk);
+            const auto start = payload.size();
+            payload.resize(start + EarcDecompressor::CHUNK_HEADER_SIZE +
+                           compressedSize);
+            compress2(&payload[start + EarcDecompressor::CHUNK_HEADER_SIZE],
+                      &compressedSize, &original[offset], chunk,
+                      Z_DEFAULT_COMPRESSION);
+
+            const auto header =
+                std::array{static_cast<uint32_t>(compressedSize),
+                           static_cast<uint32_t>(chunk)};
+            std::memcpy(&payload[start], header.data(), sizeof(header));
+            payload.resize((start + EarcDecompressor::CHUNK_HEADER_SIZE +
+                            compressedSize + 3) /
+                           4 * 4);
+        }
+
+        return payload;
+    }
+
+    /**
+     * Creates an EARC archive with one small file for each URI.
+     * @param corpus The URIs of the files, which must be distinct.
+     * @param isSorted Whether to sort the file headers by full hash, as the
+     * game does.
+     * @return The bytes of the archive.
+     */
+    static std::vector<uint8_t> CreateArchive(
+        const std::vector<std::string>& corpus, const bool isSorted)
+    {
+        using SQEX::Luminous::Core::Fnv1a64Lower;
+        constexpr size_t alignment = 16;
+        const auto align = [&](const size_t offset) {
+            return (offset + alignment - 1) / alignment * alignment;
+        };
+
+        struct File
+        {
+            uint64_t FullHash;
+            const std::string* Uri;
+        };
+
+        // Give each extension its own type hash in the high bits
+        std::vector<File> files;
+        files.reserve(corpus.size());
+        for (const auto& uri : corpus)
+        {
+            const auto extension = uri.substr(uri.rfind('.'));
+            files.push_back(
+                {LmAssetID::ComputeNameHash(uri) |
+                     Fnv1a64Lower(extension.c_str(), 0) << 44,
+                 &uri});
+        }
+
+        if (isSorted)
+        {
+            std::sort(files.begin(), files.end(),
+                      [](const File& left, const File& right) {
+                          return left.FullHash < right.FullHash;
+                      });
+        }
+
+        // Header, file headers, URIs and paths, then the data
+        const auto tableOffset = EarcArchive::HEADER_SIZE;
+        auto offset = tableOffset + files.size() * EarcArchive::ENTRY_SIZE;
+        const auto uriOffset = offset;
+        for (const auto& file : files)
+        {
+            offset += file.Uri->size() + 1 + file.Uri->size() - 7 + 1;
+        }
+
+        const auto dataOffset = align(offset);
+        offset = dataOffset;
+        std::vector<size_t> sizes;
+        for (const auto& file : files)
+        {
+            sizes.push_back(16 + file.FullHash % 2048);
+            offset = align(offset + sizes.back());
+        }
+
+        std::vector<uint8_t> bytes(offset);
+        const auto write = [&](const size_t at, const auto value) {
+            std::memcpy(&bytes[at], &value, sizeof(value));
+        };
+
+        write(0x00, EarcArchive::MAGIC);
+        write(0x04, uint32_t{0x00140004});
+        write(0x08, static_cast<uint32_t>(files.size()));
+        write(0x0C, uint32_t{alignment});
+        write(0x10, static_cast<uint32_t>(tableOffset));
+        write(0x14, static_cast<uint32_t>(uriOffset));
+        write(0x18, static_cast<uint32_t>(uriOffset));
+        write(0x1C, static_cast<uint32_t>(dataOffset));
+
+        auto stringOffset = uriOffset;
+        auto fileOffset = dataOffset;
+        for (size_t i = 0; i < files.size(); i++)
+        {
+            const auto& uri = *files[i].Uri;
+            const auto path = uri.substr(7);
+            const auto entry = tableOffset + i * EarcArchive::ENTRY_SIZE;
+            uint32_t flags = 0;
+            if (i % 4 == 0)
+            {
+                flags = i % 8 == 0 ? LmArcEntryFlags::MASK_COMPRESSED
+                                   : LmArcEntryFlags::COMPRESSED;
+            }
+
+            write(entry, files[i].FullHash);
+            write(entry + 0x08, static_cast<uint32_t>(sizes[i]));
+            write(entry + 0x0C, static_cast<uint32_t>(sizes[i]));
+            write(entry + 0x10, flags);
+            write(entry + 0x14, static_cast<uint32_t>(stringOffset));
+            std::memcpy(&bytes[stringOffset], uri.data(), uri.size());
+            stringOffset += uri.size() + 1;
+            write(entry + 0x18, static_cast<uint64_t>(fileOffset));
+            write(entry + 0x20, static_cast<uint32_t>(stringOffset));
+            std::memcpy(&bytes[stringOffset], path.data(), path.size());
+            stringOffset += path.size() + 1;
+
+            std::memset(&bytes[fileOffset],
+                        static_cast<uint8_t>(files[i].FullHash), sizes[i]);
+            fileOffset = align(fileOffset + sizes[i]);
+        }
+
+        return bytes;
+    }
+
+    static const char* GetEngineName(const SignatureScanner::Engine engine)
+    {
+        switch (engine)
+        {
+        case SignatureScanner::AVX2:
+            return "avx2";
+        case SignatureScanner::SSE2:
+            return "sse2";
+        default:
+            return "scalar";
+        }
+    }
+
+private:
+    static std::vector<NamedSignature> GetSignatures()
+    {
+        static constexpr auto shortRare = "0F 0B C4 E2 7D 5A"_sig;
+        static constexpr auto shortCommon = "48 8B 00 48 89 00"_sig;
+        static constexpr auto shortWildcards = "E8 ?? ?? ?? ?? 9A 5E D7 ??"_sig;
+        static constexpr auto longExact =
+            "48 89 5C 24 08 57 48 83 EC 20 48 8B D9 E8 3A 1F 00 00 "
+            "84 C0 74 0F 48 8B CB E8 9E 2B 00 00 48 8B"_sig;
+        static constexpr auto longWildcards =
+            "40 53 ?? ?? ?? ?? ?? ?? ?? ?? 0F B6 ?? ?? ?? ?? ?? ?? ?? ?? "
+            "?? ?? ?? ?? F3 0F ?? ?? ?? ?? ?? ?? ?? ?? ?? ?? ?? ?? ?? ?? "
+            "?? ?? 5B C3"_sig;
+
+        std::vector<NamedSignature> signatures = {
+            {"short_rare", shortRare},
+            {"short_common", shortCommon},
+            {"short_wildcards", shortWildcards},
+            {"long_exact", longExact},
+            {"long_wildcards", longWildcards}};
+
+        // Include the signatures that are actually used by the patches
+        const auto& patches = Patches::PatchManager::GetInstance().GetPatches();
+        for (size_t i = 0; i < patches.size(); i++)
+        {
+            signatures.push_back({"patch_" + std::to_string(i),
+                                  patches[i]->GetTargetSignature()});
+        }
+
+        return signatures;
+    }
+
+    /**
+     * Stands in for the function that a hook detours.
+     */
+#ifdef _MSC_VER
+    __declspec(noinline)
+#else
+    __attribute__((noinline))
+#endif
+    static uint64_t HookTarget(const uint64_t value)
+    {
+        return value ^ 0x5A;
+    }
+
+    /**
+     * Prevents the compiler from removing a computation whose result is
+     * otherwise unused.
+     */
+    static void Consume(const uint64_t value)
+    {
+#ifdef _MSC_VER
+        // MSVC has no inline assembly on x64, so store to and read back a
+        // volatile instead
+        static volatile uint64_t sink;
+        sink = value;
+        (void)sink;
+#else
+        asm volatile("" : : "r"(value) : "memory");
+#endif
+    }
+};
+
+/**
+ * Writes the trace of the run.
+ * @param path Path to the file to write.
+ * @return True if the trace was written.
+ */
+static bool WriteTrace(const std::string& path)
+{
+    if constexpr (!Trace::IS_ENABLED)
+    {
+        std::fprintf(stderr, "Tracing is not enabled in this build, configure "
+                             "with -DDRAUTOS_TRACE=ON\n");
+        return false;
+    }
+
+    auto& trace = Trace::GetInstance();
+    if (trace.GetDroppedCount() > 0)
+    {
+        std::fprintf(stderr, "Trace buffer was full, dropped %zu events\n",
+                     trace.GetDroppedCount());
+    }
+
+    if (!trace.WriteJson(path))
+    {
+        std::fprintf(stderr, "Failed to write %s\n", path.c_str());
+        return false;
+    }
+
+    return true;
+}
+
+static void PrintUsage()
+{
+    std::fprintf(
+        stderr,
+        "Usage: DrautosBenchmark [options]\n"
+        "  --filter <text>       Only run workloads containing the text\n"
+        "  --sizes <mb,...>      Synthetic image sizes (default 16,64)\n"
+        "  --image <exe>         Also benchmark a real executable\n"
+        "  --corpus <file>       Also hash the URIs in a file, one per line\n"
+        "  --archive <earc>      Also benchmark finding files in an archive\n"
+        "  --access-trace <file> Replay a recorded access trace against the "
+        "archives\n"
+        "  --min-time <seconds>  Minimum time per workload (default 0.5)\n"
+        "  --json <file>         Write the results as JSON\n"
+        "  --baseline <file>     Compare the results to a previous JSON file\n"
+        "  --threshold <pct>     Allowed slowdown against the baseline "
+        "(default 10)\n"
+        "  --trace <file>        Write a Chrome trace of the run, if built "
+        "with DRAUTOS_TRACE\n");
+}
+
+int main(const int argc, char** argv)
+{
+    std::string filter;
+    std::vector<size_t> sizes = {16, 64};
+    std::vector<std::string> images;
+    std::vector<std::string> corpora;
+    std::vector<std::string> archives;
+    std::vector<std::string> accessTraces;
+    std::string jsonPath;
+    std::string baselinePath;
+    std::string tracePath;
+    double minSeconds = 0.5;
+    double threshold = 10;
+
+    for (auto i = 1; i < argc; i++)
+    {
+        const std::string option = argv[i];
+        if (i + 1 >= argc)
+        {
+            PrintUsage();
+            return 2;
+        }
+
+        const std::string value = argv[++i];
+        if (option == "--filter")
+        {
+            filter = value;
+        }
+        else if (option == "--sizes")
+        {
+            sizes.clear();
+            std::stringstream stream(value);
+            for (std::string size; std::getline(stream, size, ',');)
+            {
+                sizes.push_back(std::stoul(size));
+            }
+        }
+        else if (option == "--image")
+        {
+            images.push_back(value);
+        }
+        else if (option == "--corpus")
+        {
+            corpora.push_back(value);
+        }
+        else if (option == "--archive")
+        {
+            archives.push_back(value);
+        }
+        else if (option == "--access-trace")
+        {
+            accessTraces.push_back(value);
+        }
+        else if (option == "--min-time")
+        {
+            minSeconds = std::stod(value);
+        }
+        else if (option == "--json")
+        {
+            jsonPath = value;
+        }
+        else if (option == "--baseline")
+        {
+            baselinePath = value;
+        }
+        else if (option == "--threshold")
+        {
+            threshold = std::stod(value);
+        }
+        else if (option == "--trace")
+        {
+            tracePath = value;
+        }
+        else
+        {
+            PrintUsage();
+            return 2;
+        }
+    }
+
+    // Keep the signature cache away from the real one
+    const auto cacheDirectory =
+        std::filesystem::temp_directory_path() / "DrautosBenchmark";
+#ifdef _WIN32
+    _putenv_s("LOCALAPPDATA", cacheDirectory.string().c_str());
+#else
+    setenv("LOCALAPPDATA", cacheDirectory.c_str(), 1);
+#endif
+
+    auto isValid = true;
+    try
+    {
+        Benchmark benchmark(filter, minSeconds);
+        const DrautosBenchmark suite(benchmark);
+        Patches::PatchRegistry::RegisterAll(
+            Patches::PatchManager::GetInstance());
+        suite.RunConstruction();
+        suite.RunPatchTransactions();
+        suite.RunTracing();
+        isValid &= suite.RunHookDispatch();
+        isValid &= suite.RunArchiveFlags();
+
+        for (const auto size : sizes)
+        {
+            // Each workload plants its own signatures, so they must not share
+            // an image
+            {
+                auto image = BenchmarkImage::CreateSynthetic(size << 20, size);
+                isValid &= suite.RunSignatures(image, true);
+            }
+
+            auto image = BenchmarkImage::CreateSynthetic(size << 20, size);
+            suite.RunApplyPatches(image);
+        }
+
+        for (const auto& path : images)
+        {
+            auto image = BenchmarkImage::CreateFromFile(path);
+            isValid &= suite.RunSignatures(image, false);
+        }
+
+        const auto synthetic = DrautosBenchmark::CreateCorpus(100000, 1);
+        isValid &= suite.RunHashing("synthetic_100k", synthetic);
+        isValid &= suite.RunAssetIds("synthetic_100k", synthetic);
+        for (const auto& path : corpora)
+        {
+            std::ifstream stream(path);
+            std::vector<std::string> corpus;
+            for (std::string line; std::getline(stream, line);)
+            {
+                if (!line.empty())
+                {
+                    corpus.push_back(line);
+                }
+            }
+
+            const auto name = std::filesystem::path(path).stem().string();
+            isValid &= suite.RunHashing(name, corpus);
+            isValid &= suite.RunAssetIds(name, corpus);
+        }
+
+        isValid &= suite.RunSyntheticArchive();
+        isValid &= suite.RunDecompression();
+        isValid &= suite.RunPayloadCache();
+        isValid &= suite.RunOverrides();
+        isValid &= suite.RunPatchIndices();
+        isValid &= suite.RunPrefetch();
+        std::vector<std::unique_ptr<EarcArchive>> opened;
+        std::vector<EarcArchive*> mounted;
+        for (const auto& path : archives)
+        {
+            opened.push_back(
+                std::make_unique<EarcArchive>(std::filesystem::path(path)));
+            mounted.push_back(opened.back().get());
+            isValid &= suite.RunArchive(
+                std::filesystem::path(path).stem().string(), *opened.back());
+        }
+
+        for (const auto& path : accessTraces)
+        {
+            suite.RunTraceReplay(std::filesystem::path(path).stem().string(),
+                                 mounted, AssetAccessTrace::Load(path));
+        }
+
+        if (!jsonPath.empty() && !benchmark.WriteJson(jsonPath))
+        {
+            std::fprintf(stderr, "Failed to write %s\n", jsonPath.c_str());
+            isValid = false;
+        }
+
+        if (!baselinePath.empty())
+        {
+            isValid &=
+                benchmark.CompareToBaseline(baselinePath, threshold / 100);
+        }
+
+        if (!tracePath.empty())
+        {
+            isValid &= WriteTrace(tracePath);
+        }
+    }
+    catch (const std::exception& exception)
+    {
+        std::fprintf(stderr, "%s\n", exception.what());
+        return 2;
+    }
+
+    std::filesystem::remove_all(cacheDirectory);
+    return isValid ? 0 : 1;
+}
@@ -0,0 +1,306 @@
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <exception>
+#include <string>
+#include <typeinfo>
+#include <vector>
+
+#if __has_include(<cxxabi.h>)
+#include <cxxabi.h>
+#endif
+
+#include "../IO/MappedFile.h"
+#include "../Patching/PatchRegistry.h"
+
+/**
+ * Verifies every registered patch against a game executable on disk, without
+ * launching the game.
+ * @remarks The executable is memory-mapped and each section is scanned where
+ * it lies in the file, so nothing is copied. Matches are reported as RVAs, as
+ * if the executable had been loaded by Windows.
+ */
+class DrautosVerify
+{
+private:
+    /**
+     * Represents the result of scanning for one signature.
+     */
+    struct ScanResult
+    {
+        std::vector<uint32_t> Rvas;
+        double Milliseconds;
+    };
+
+    const PeImage& image_;
+    SignatureScanner::Engine engine_;
+    size_t repeat_;
+
+public:
+    DrautosVerify(const PeImage& image, const SignatureScanner::Engine engine,
+                  const size_t repeat)
+        : image_(image), engine_(engine), repeat_(std::max<size_t>(repeat, 1))
+    {
+    }
+
+    /**
+     * Verifies every patch and prints the results.
+     * @return True if every target signature was found the expected number of
+     * times, or was already patched.
+     */
+    bool Run(const std::vector<Patches::IPatch*>& patches) const
+    {
+        auto isValid = true;
+        size_t bytesScanned = 0;
+        double totalMilliseconds = 0;
+
+        for (const auto patch : patches)
+        {
+            const TraceScope scope("DrautosVerify::Verify",
+                                   typeid(*patch).name());
+            const auto filter = patch->GetTargetSection();
+            const auto expected = patch->GetExpectedTargetCount();
+            const auto target = Scan(patch->GetTargetSignature(), filter);
+            const auto replacement = Scan(patch->GetPatchSignature(), filter);
+
+            const auto actual = static_cast<int>(target.Rvas.size());
+            const char* status;
+            if (expected < 0 ? actual > 0 : actual == expected)
+            {
+                status = "OK";
+            }
+            else if (actual == 0 && !replacement.Rvas.empty())
+            {
+                status = "ALREADY PATCHED";
+            }
+            else
+            {
+                status = "MISMATCH";
+                isValid = false;
+            }
+
+            std::printf("%s: %s\n", GetName(*patch).c_str(), status);
+            Print("target", patch->GetTargetSignature(), target, expected);
+            Print("patch", patch->GetPatchSignature(), replacement, -1);
+
+            for (const auto& [start, end] : filter.GetRegions(image_))
+            {
+                bytesScanned += 2 * static_cast<size_t>(end - start);
+            }
+
+            totalMilliseconds += target.Milliseconds + replacement.Milliseconds;
+        }
+
+        std::printf("\nScanned %.1f MiB in %.3f ms (%.2f GiB/s) with the %s "
+                    "engine on %zu threads\n",
+                    bytesScanned / 1048576.0, totalMilliseconds,
+                    totalMilliseconds > 0
+                        ? bytesScanned / 1073741824.0 /
+                              (totalMilliseconds / 1000)
+                        : 0.0,
+                    GetEngineName(engine_),
+                    ThreadPool::DefaultThreadCount
+                        ? ThreadPool::DefaultThreadCount
+                        : std::thread::hardware_concurrency());
+
+        return isValid;
+    }
+
+    static const char* GetEngineName(const SignatureScanner::Engine engine)
+    {
+        switch (engine)
+        {
+        case SignatureScanner::AVX2:
+            return "AVX2";
+        case SignatureScanner::SSE2:
+            return "SSE2";
+        default:
+            return "scalar";
+        }
+    }
+
+private:
+    /**
+     * Scans the image for a signature, keeping the fastest of each repeat.
+     */
+    [[nodiscard]] ScanResult Scan(const SignatureView& signature,
+                                  const PeSectionFilter& filter) const
+    {
+        const auto scanner = signature.CreateScanner(engine_);
+        const auto regions = filter.GetRegions(image_);
+        ScanResult result{{}, 0};
+
+        for (size_t i = 0; i < repeat_; i++)
+        {
+            const auto start = std::chrono::steady_clock::now();
+            const auto matches = ParallelScanner().Scan(scanner, regions);
+            const std::chrono::duration<double, std::milli> elapsed =
+                std::chrono::steady_clock::now() - start;
+
+            if (i == 0 || elapsed.count() < result.Milliseconds)
+            {
+                result.Milliseconds = elapsed.count();
+            }
+
+            result.Rvas.clear();
+            for (const auto match : matches)
+            {
+                result.Rvas.push_back(image_.ToRva(match));
+            }
+        }
+
+        return result;
+    }
+
+    static void Print(const char* label, const SignatureView& signature,
+                      const ScanResult& result, const int expected)
+    {
+        std::printf("  %-6s %-40s found %zu", label,
+                    Format(signature).c_str(), result.Rvas.size());
+        if (expected != -1)
+        {
+            std::printf(" (expected %d)", expected);
+        }
+
+        std::printf(" in %.3f ms\n", result.Milliseconds);
+        for (const auto rva : result.Rvas)
+        {
+            std::printf("         0x%08X\n", rva);
+        }
+    }
+
+    static std::string Format(const SignatureView& signature)
+    {
+        constexpr char digits[] = "0123456789ABCDEF";
+        std::string text;
+        for (size_t i = 0; i < signature.GetSize(); i++)
+        {
+            if (i > 0)
+            {
+                text += ' ';
+            }
+
+            if (signature.GetMasks()[i])
+            {
+                text += digits[signature.GetValues()[i] >> 4];
+                text += digits[signature.GetValues()[i] & 0x0F];
+            }
+            else
+            {
+                text += "??";
+            }
+        }
+
+        return text;
+    }
+
+    static std::string GetName(const Patches::IPatch& patch)
+    {
+        std::string name(typeid(patch).name());
+#if __has_include(<cxxabi.h>)
+        int status;
+        if (const auto demangled = abi::__cxa_demangle(name.c_str(), nullptr,
+                                                        nullptr, &status))
+        {
+            name = demangled;
+            std::free(demangled);
+        }
+#endif
+        return name;
+    }
+};
+
+static void PrintUsage()
+{
+    std::fprintf(stderr,
+                 "Usage: DrautosVerify <ffxv_s.exe> [options]\n"
+                 "  --engine <scalar|sse2|avx2>  Scanner engine to use\n"
+                 "  --threads <count>            Threads to scan with\n"
+                 "  --repeat <count>             Scans per signature, "
+                 "reporting the fastest\n"
+                 "  --trace <file>               Write a Chrome trace, if "
+                 "built with DRAUTOS_TRACE\n");
+}
+
+int main(const int argc, char** argv)
+{
+    if (argc < 2)
+    {
+        PrintUsage();
+        return 2;
+    }
+
+    auto engine = SignatureScanner::GetBestEngine();
+    size_t repeat = 1;
+    std::string tracePath;
+    for (auto i = 2; i < argc; i++)
+    {
+        const std::string option = argv[i];
+        if (i + 1 >= argc)
+        {
+            PrintUsage();
+            return 2;
+        }
+
+        const std::string value = argv[++i];
+        if (option == "--engine")
+        {
+            engine = value == "avx2"   ? SignatureScanner::AVX2
+                     : value == "sse2" ? SignatureScanner::SSE2
+                                       : SignatureScanner::SCALAR;
+        }
+        else if (option == "--threads")
+        {
+            ThreadPool::DefaultThreadCount = std::stoul(value);
+        }
+        else if (option == "--repeat")
+        {
+            repeat = std::stoul(value);
+        }
+        else if (option == "--trace")
+        {
+            if constexpr (!Trace::IS_ENABLED)
+            {
+                std::fprintf(stderr, "Tracing is not enabled in this build, "
+                                     "configure with -DDRAUTOS_TRACE=ON\n");
+                return 2;
+            }
+
+            tracePath = value;
+        }
+        else
+        {
+            PrintUsage();
+            return 2;
+        }
+    }
+
+    try
+    {
+        const MappedFile file(argv[1]);
+        const PeImage image(file.GetData(), file.GetSize(), PeImage::FILE);
+        std::printf("%s: TimeDateStamp 0x%08X, SizeOfImage 0x%08X\n\n",
+                    argv[1], image.GetTimeDateStamp(), image.GetSizeOfImage());
+
+        auto& patchManager = Patches::PatchManager::GetInstance();
+        Patches::PatchRegistry::RegisterAll(patchManager);
+
+        const DrautosVerify verify(
+            image, std::min(engine, SignatureScanner::GetBestEngine()),
+            repeat);
+        const auto isValid = verify.Run(patchManager.GetPatches());
+        if (!tracePath.empty() && !Trace::GetInstance().WriteJson(tracePath))
+        {
+            std::fprintf(stderr, "Failed to write %s\n", tracePath.c_str());
+            return 2;
+        }
+
+        return isValid ? 0 : 1;
+    }
+    catch (const std::exception& exception)
+    {
+        std::fprintf(stderr, "%s\n", exception.what());
+        return 2;
+    }
+}
@@ -23,6 +23,10 @@ bool APIENTRY DllMain(
             Exception::Fatal();
         }
     }
+    else if (ul_reason_for_call == DLL_PROCESS_DETACH)
+    {
+        Drautos::Shutdown();
+    }
 
     return true;
 }